@@ -0,0 +1,428 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-27.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <DemReader/DemReader.hpp>
+#include <DemReader/ReadDemGrid.hpp>
+#include "FortranReader.hpp"
+#include "ParseNumber.hpp"
+#include "SyntheticDem.hpp"
+
+namespace
+{
+    struct BenchmarkResult
+    {
+        std::string name;
+        size_t iterations = 0;
+        double mean_seconds = 0;
+        double min_seconds = 0;
+        /// The number of bytes processed in each iteration.
+        size_t bytes = 0;
+        /// The number of items processed in each iteration.
+        size_t items = 0;
+        std::string item_name;
+    };
+
+    struct Settings
+    {
+        std::string format = "json";
+        std::string filter;
+        double min_time = 0.5;
+        std::filesystem::path directory;
+    };
+
+    /// Results are added to this to keep the compiler from removing
+    /// the code that is being measured.
+    volatile int64_t sink = 0;
+
+    /**
+     * @brief Runs @a func until it has run for at least
+     *  @a settings.min_time seconds, and at least three times.
+     */
+    BenchmarkResult run_benchmark(const Settings& settings,
+                                  const std::string& name,
+                                  size_t bytes, size_t items,
+                                  const std::string& item_name,
+                                  const std::function<void ()>& func)
+    {
+        using Clock = std::chrono::steady_clock;
+        BenchmarkResult result;
+        result.name = name;
+        result.bytes = bytes;
+        result.items = items;
+        result.item_name = item_name;
+
+        double total = 0;
+        while (result.iterations < 3 || total < settings.min_time)
+        {
+            auto start = Clock::now();
+            func();
+            std::chrono::duration<double> elapsed = Clock::now() - start;
+            auto seconds = elapsed.count();
+            if (result.iterations == 0 || seconds < result.min_seconds)
+                result.min_seconds = seconds;
+            total += seconds;
+            ++result.iterations;
+        }
+        result.mean_seconds = total / double(result.iterations);
+        return result;
+    }
+
+    class BenchmarkSuite
+    {
+    public:
+        explicit BenchmarkSuite(Settings settings)
+            : m_Settings(std::move(settings))
+        {}
+
+        void add(const std::string& name, size_t bytes, size_t items,
+                 const std::string& item_name,
+                 const std::function<void ()>& func)
+        {
+            if (!is_selected(name))
+                return;
+            std::cerr << name << "\n";
+            m_Results.push_back(run_benchmark(m_Settings, name, bytes,
+                                              items, item_name, func));
+        }
+
+        [[nodiscard]]
+        bool is_selected(const std::string& name) const
+        {
+            return name.find(m_Settings.filter) != std::string::npos;
+        }
+
+        void write(std::ostream& os) const
+        {
+            if (m_Settings.format == "csv")
+                write_csv(os);
+            else
+                write_json(os);
+        }
+    private:
+        static double megabytes_per_second(const BenchmarkResult& r)
+        {
+            return double(r.bytes) / 1e6 / r.mean_seconds;
+        }
+
+        static double items_per_second(const BenchmarkResult& r)
+        {
+            return double(r.items) / r.mean_seconds;
+        }
+
+        void write_json(std::ostream& os) const
+        {
+            os << "{\n  \"benchmarks\": [";
+            for (size_t i = 0; i < m_Results.size(); ++i)
+            {
+                const auto& r = m_Results[i];
+                char buffer[512];
+                snprintf(buffer, sizeof(buffer),
+                         "%s\n    {\"name\": \"%s\", \"iterations\": %zu,"
+                         " \"mean_seconds\": %.9g, \"min_seconds\": %.9g,"
+                         " \"megabytes_per_second\": %.6g,"
+                         " \"items_per_second\": %.6g, \"item\": \"%s\"}",
+                         i == 0 ? "" : ",", r.name.c_str(), r.iterations,
+                         r.mean_seconds, r.min_seconds,
+                         megabytes_per_second(r), items_per_second(r),
+                         r.item_name.c_str());
+                os << buffer;
+            }
+            os << "\n  ]\n}\n";
+        }
+
+        void write_csv(std::ostream& os) const
+        {
+            os << "name,iterations,mean_seconds,min_seconds,"
+                  "megabytes_per_second,items_per_second,item\n";
+            for (const auto& r : m_Results)
+            {
+                char buffer[512];
+                snprintf(buffer, sizeof(buffer),
+                         "%s,%zu,%.9g,%.9g,%.6g,%.6g,%s\n",
+                         r.name.c_str(), r.iterations, r.mean_seconds,
+                         r.min_seconds, megabytes_per_second(r),
+                         items_per_second(r), r.item_name.c_str());
+                os << buffer;
+            }
+        }
+
+        Settings m_Settings;
+        std::vector<BenchmarkResult> m_Results;
+    };
+
+    void add_parse_benchmarks(BenchmarkSuite& suite)
+    {
+        constexpr size_t COUNT = 1000000;
+
+        // The elevations of a synthetic DEM file are realistic I6 values.
+        // Unlike real DEM files, they are never blank.
+        SyntheticDemOptions options;
+        options.columns = 100;
+        options.rows = int(COUNT / 100);
+        options.record_c = false;
+        auto dem_data = make_synthetic_dem(options);
+        std::string_view dem = dem_data;
+        std::vector<std::string_view> ints;
+        ints.reserve(COUNT);
+        auto record_size = Dem::get_record_b_size(int16_t(options.rows), 1);
+        for (int i = 0; i < options.columns; ++i)
+        {
+            // The first block of a record of type B starts with a
+            // 144-byte header, and all blocks end with padding.
+            auto record = dem.substr(Dem::DEM_BLOCK_SIZE + i * record_size,
+                                     record_size);
+            auto count = size_t(options.rows);
+            for (size_t pos = 144; count != 0; pos += 4)
+            {
+                auto end = pos + (pos < Dem::DEM_BLOCK_SIZE ? 146 : 170) * 6;
+                for (; pos < end && count != 0; pos += 6, --count)
+                {
+                    // FortranReader removes the blanks before parsing.
+                    auto field = record.substr(pos, 6);
+                    field.remove_prefix(field.find_first_not_of(' '));
+                    ints.push_back(field);
+                }
+            }
+        }
+
+        suite.add("parse/int16", ints.size() * 6, ints.size(), "values",
+                  [&]
+                  {
+                      int64_t sum = 0;
+                      for (auto str : ints)
+                      {
+                          int16_t value;
+                          if (Dem::parse(str, value))
+                              sum += value;
+                      }
+                      sink += sum;
+                  });
+
+        std::vector<std::string> doubles;
+        doubles.reserve(COUNT / 10);
+        for (size_t i = 0; i < COUNT / 10; ++i)
+        {
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.15E",
+                     500000.0 + double(i) * 30.0 + double(i % 7) / 8);
+            std::string str = buffer;
+            str[str.find('E')] = 'D';
+            doubles.push_back(str);
+        }
+
+        suite.add("parse/double", doubles.size() * 21, doubles.size(),
+                  "values",
+                  [&]
+                  {
+                      double sum = 0;
+                      for (const auto& str : doubles)
+                      {
+                          double value;
+                          if (Dem::parse(str, value))
+                              sum += value;
+                      }
+                      sink += int64_t(sum);
+                  });
+    }
+
+    struct DemVariant
+    {
+        std::string name;
+        SyntheticDemOptions options;
+    };
+
+    std::vector<DemVariant> get_dem_variants()
+    {
+        std::vector<DemVariant> result;
+        for (int size : {469, 1201, 3601})
+        {
+            auto prefix = std::to_string(size) + "x" + std::to_string(size);
+            SyntheticDemOptions options;
+            options.columns = size;
+            options.rows = size;
+            result.push_back({prefix + "/c", options});
+            if (size == 1201)
+            {
+                options.record_c = false;
+                result.push_back({prefix + "/noc", options});
+                options.record_c = true;
+                options.blank_fields = true;
+                result.push_back({prefix + "/blank", options});
+            }
+        }
+        return result;
+    }
+
+    void add_dem_benchmarks(BenchmarkSuite& suite, const DemVariant& variant,
+                            const std::filesystem::path& directory)
+    {
+        const char* names[] = {"read_record_b/", "dem_reader_stream/",
+                               "read_dem_grid/", "read_dem_grid_threads/",
+                               "read_compact_dem_grid_threads/"};
+        // Don't create files for benchmarks that won't run.
+        if (std::none_of(std::begin(names), std::end(names),
+                         [&](auto name)
+                         {return suite.is_selected(name + variant.name);}))
+        {
+            return;
+        }
+
+        auto dem = make_synthetic_dem(variant.options);
+        auto profiles = size_t(variant.options.columns);
+        auto records_b_size = dem.size() - Dem::DEM_BLOCK_SIZE
+                              - (variant.options.record_c
+                                 ? Dem::DEM_BLOCK_SIZE : 0);
+
+        suite.add("read_record_b/" + variant.name, records_b_size, profiles,
+                  "profiles",
+                  [&]
+                  {
+                      Dem::FortranReader reader(dem.data()
+                                                + Dem::DEM_BLOCK_SIZE,
+                                                records_b_size);
+                      Dem::RecordB b;
+                      for (size_t i = 0; i < profiles; ++i)
+                      {
+                          Dem::read_record_b(reader, b);
+                          sink += b.elevations.back();
+                      }
+                  });
+
+        auto file_name = (directory / ("DemReaderBench-"
+                                       + std::to_string(profiles) + "-"
+                                       + std::to_string(dem.size())
+                                       + ".dem")).string();
+        std::ofstream(file_name, std::ios::binary).write(
+            dem.data(), std::streamsize(dem.size()));
+
+        suite.add("dem_reader_stream/" + variant.name, dem.size(), profiles,
+                  "profiles",
+                  [&]
+                  {
+                      std::ifstream file(file_name, std::ios::binary);
+                      Dem::DemReader reader(file);
+                      Dem::RecordB b;
+                      while (reader.next_record_b(b))
+                          sink += b.elevations.back();
+                  });
+
+        suite.add("read_dem_grid/" + variant.name, dem.size(), profiles,
+                  "profiles",
+                  [&]
+                  {
+                      auto grid = Dem::read_dem_grid(file_name,
+                                                     GridLib::Unit::METERS);
+                      sink += int64_t(grid.elevations()(0, 0));
+                  });
+
+        suite.add("read_dem_grid_threads/" + variant.name, dem.size(),
+                  profiles, "profiles",
+                  [&]
+                  {
+                      auto grid = Dem::read_dem_grid(file_name,
+                                                     GridLib::Unit::METERS,
+                                                     0);
+                      sink += int64_t(grid.elevations()(0, 0));
+                  });
+
+        suite.add("read_compact_dem_grid_threads/" + variant.name,
+                  dem.size(), profiles, "profiles",
+                  [&]
+                  {
+                      auto grid = Dem::read_compact_dem_grid(
+                          file_name, GridLib::Unit::METERS, 0);
+                      sink += grid.values()(0, 0);
+                  });
+
+        std::error_code ec;
+        std::filesystem::remove(file_name, ec);
+    }
+
+    void print_help(const char* program)
+    {
+        std::cout << "Usage: " << program << " [options]\n"
+            "\n"
+            "Runs the DemReader benchmarks on synthetic DEM files and\n"
+            "writes the results to stdout.\n"
+            "\n"
+            "  --format json|csv  The output format. Default is json.\n"
+            "  --filter TEXT      Only run benchmarks whose names\n"
+            "                     contain TEXT.\n"
+            "  --min-time SECS    The minimum time spent on each\n"
+            "                     benchmark. Default is 0.5.\n"
+            "  --directory DIR    Where the DEM files are written.\n"
+            "                     Default is the temporary directory.\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Settings settings;
+    settings.directory = std::filesystem::temp_directory_path();
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help")
+        {
+            print_help(argv[0]);
+            return 0;
+        }
+
+        if (i + 1 == argc)
+        {
+            std::cerr << "Missing value or unknown option: " << arg << "\n";
+            return 1;
+        }
+
+        std::string value = argv[++i];
+        if (arg == "--format" && (value == "json" || value == "csv"))
+        {
+            settings.format = value;
+        }
+        else if (arg == "--filter")
+        {
+            settings.filter = value;
+        }
+        else if (arg == "--min-time")
+        {
+            settings.min_time = std::stod(value);
+        }
+        else if (arg == "--directory")
+        {
+            settings.directory = value;
+        }
+        else
+        {
+            std::cerr << "Invalid option: " << arg << " " << value << "\n";
+            return 1;
+        }
+    }
+
+    try
+    {
+        BenchmarkSuite suite(settings);
+        add_parse_benchmarks(suite);
+        for (const auto& variant : get_dem_variants())
+            add_dem_benchmarks(suite, variant, settings.directory);
+        suite.write(std::cout);
+    }
+    catch (std::exception& ex)
+    {
+        std::cerr << "Exception: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
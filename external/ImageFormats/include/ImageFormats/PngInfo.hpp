@@ -9,6 +9,7 @@
 #include <list>
 #include <optional>
 #include <string>
+#include <tuple>
 #include <vector>
 #include <png.h>
 
@@ -52,6 +53,40 @@ namespace ImageFormats
 
         PngInfo& filterMethod(int value);
 
+        /**
+         * @brief The zlib compression level, from 0 (none) to 9 (best).
+         *
+         * libpng's default is used if no value is set.
+         */
+        [[nodiscard]]
+        const std::optional<int>& compressionLevel() const;
+
+        PngInfo& compressionLevel(std::optional<int> value);
+
+        /**
+         * @brief The row filters libpng chooses from, a combination of
+         *  PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP, PNG_FILTER_AVG
+         *  and PNG_FILTER_PAETH, or PNG_ALL_FILTERS.
+         *
+         * A single filter is faster, more filters usually give smaller
+         * files. libpng's default is used if no value is set.
+         */
+        [[nodiscard]]
+        const std::optional<int>& filters() const;
+
+        PngInfo& filters(std::optional<int> value);
+
+        /**
+         * @brief The zlib compression strategy, e.g. Z_FILTERED, Z_RLE or
+         *  Z_DEFAULT_STRATEGY.
+         *
+         * libpng's default is used if no value is set.
+         */
+        [[nodiscard]]
+        const std::optional<int>& compressionStrategy() const;
+
+        PngInfo& compressionStrategy(std::optional<int> value);
+
         [[nodiscard]]
         const std::optional<double>& gamma() const;
 
@@ -80,6 +115,9 @@ namespace ImageFormats
         int m_InterlaceType = PNG_INTERLACE_NONE;
         int m_CompressionMethod = PNG_COMPRESSION_TYPE_DEFAULT;
         int m_FilterMethod = PNG_FILTER_TYPE_DEFAULT;
+        std::optional<int> m_CompressionLevel;
+        std::optional<int> m_Filters;
+        std::optional<int> m_CompressionStrategy;
         std::optional<double> m_Gamma;
         std::vector<png_text> m_Texts;
         std::list<std::string> m_Strings;
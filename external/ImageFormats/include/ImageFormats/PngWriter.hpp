@@ -7,6 +7,7 @@
 //****************************************************************************
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <iosfwd>
 #include "PngInfo.hpp"
@@ -31,8 +32,20 @@ namespace ImageFormats
 
         void writeInfo();
 
+        /**
+         * @brief Writes the entire image, @a size must be the image's
+         *  height times its row size.
+         */
         void write(const void* image, size_t size);
 
+        /**
+         * @brief Writes the next @a count rows.
+         *
+         * Together with writeRow, this makes it possible to write an
+         * image that is produced a few rows at a time, without ever
+         * having all of it in memory. Interlaced images must be written
+         * with write.
+         */
         void writeRows(const void* rows[], uint32_t count, size_t rowSize);
 
         void writeRow(const void* row, size_t size);
@@ -87,6 +87,41 @@ namespace ImageFormats
         return *this;
     }
 
+    const std::optional<int>& PngInfo::compressionLevel() const
+    {
+        return m_CompressionLevel;
+    }
+
+    PngInfo& PngInfo::compressionLevel(std::optional<int> value)
+    {
+        if (value && (*value < 0 || *value > 9))
+            IMGFMT_THROW("Invalid compression level.");
+        m_CompressionLevel = value;
+        return *this;
+    }
+
+    const std::optional<int>& PngInfo::filters() const
+    {
+        return m_Filters;
+    }
+
+    PngInfo& PngInfo::filters(std::optional<int> value)
+    {
+        m_Filters = value;
+        return *this;
+    }
+
+    const std::optional<int>& PngInfo::compressionStrategy() const
+    {
+        return m_CompressionStrategy;
+    }
+
+    PngInfo& PngInfo::compressionStrategy(std::optional<int> value)
+    {
+        m_CompressionStrategy = value;
+        return *this;
+    }
+
     const std::optional<double>& PngInfo::gamma() const
     {
         return m_Gamma;
@@ -111,8 +111,8 @@ namespace ImageFormats
     {
         if (m_PngPtr)
             png_destroy_write_struct(&m_PngPtr, &m_InfoPtr);
-        m_Info = std::move(m_Info);
-        m_Transform = std::move(m_Transform);
+        m_Info = std::move(obj.m_Info);
+        m_Transform = std::move(obj.m_Transform);
         std::swap(m_PngPtr, obj.m_PngPtr);
         std::swap(m_InfoPtr, obj.m_InfoPtr);
         return *this;
@@ -148,6 +148,16 @@ namespace ImageFormats
         if (m_Transform.invertAlpha())
             png_set_invert_alpha(m_PngPtr);
 
+        if (m_Info.compressionLevel())
+            png_set_compression_level(m_PngPtr, *m_Info.compressionLevel());
+        if (m_Info.filters())
+            png_set_filter(m_PngPtr, PNG_FILTER_TYPE_BASE, *m_Info.filters());
+        if (m_Info.compressionStrategy())
+        {
+            png_set_compression_strategy(m_PngPtr,
+                                         *m_Info.compressionStrategy());
+        }
+
         if (setjmp(png_jmpbuf(m_PngPtr)))
         {
             png_destroy_write_struct(&m_PngPtr, &m_InfoPtr);
@@ -162,12 +172,6 @@ namespace ImageFormats
         auto rowSize = getRowSize(m_Info, m_Transform);
         if (size != m_Info.height() * rowSize)
             IMGFMT_THROW("Incorrect image size.");
-        std::vector<unsigned char*> rows;
-        rows.reserve(m_Info.height());
-
-        auto ucImage = static_cast<unsigned char*>(const_cast<void*>(image));
-        for (size_t i = 0; i < m_Info.height(); ++i)
-            rows.push_back(ucImage + i * rowSize);
 
         assertIsValid();
         if (setjmp(png_jmpbuf(m_PngPtr)))
@@ -175,7 +179,16 @@ namespace ImageFormats
             png_destroy_write_struct(&m_PngPtr, &m_InfoPtr);
             IMGFMT_THROW("Error while writing PNG image data.");
         }
-        png_write_image(m_PngPtr, rows.data());
+
+        // Does the same as png_write_image, but without an array of
+        // row pointers.
+        auto ucImage = static_cast<unsigned char*>(const_cast<void*>(image));
+        auto passes = png_set_interlace_handling(m_PngPtr);
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            for (size_t i = 0; i < m_Info.height(); ++i)
+                png_write_row(m_PngPtr, ucImage + i * rowSize);
+        }
     }
 
     void PngWriter::writeRows(const void* rows[], uint32_t count,
@@ -238,7 +251,7 @@ namespace ImageFormats
                   const void* image, size_t imageSize,
                   PngInfo options, PngTransform transform)
     {
-        std::ofstream stream(fileName);
+        std::ofstream stream(fileName, std::ios::binary);
         if (!stream)
             IMGFMT_THROW("Can not create " + fileName);
         writePng(stream, image, imageSize,
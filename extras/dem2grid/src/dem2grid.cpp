@@ -6,8 +6,12 @@
 // License text is included with the source distribution.
 //****************************************************************************
 #include <iostream>
+#include <filesystem>
 #include <fstream>
+#include <memory>
 #include <Argos/Argos.hpp>
+#include <DemReader/DemReader.hpp>
+#include <DemReader/NorthUpGridWriter.hpp>
 #include <DemReader/ReadDemGrid.hpp>
 #include "GridLib/WriteGrid.hpp"
 
@@ -16,7 +20,8 @@ int main(int argc, char* argv[])
     using namespace Argos;
     auto args = ArgumentParser(argv[0], true)
         .allowAbbreviatedOptions(true)
-        .add(Argument("FILE").text("The name of the DEM file."))
+        .add(Argument("FILE").text("The name of the DEM file. Use '-' to"
+                                   " read the DEM file from stdin."))
         .add(Argument("OUTPUT").optional(true)
                  .text("The name of the output file. Output is written to"
                        " stdout if this is not given."))
@@ -27,10 +32,23 @@ int main(int argc, char* argv[])
                  .text("The number of rowCount and columnCount in the input file that"
                        " will be processed. Values that are too large are"
                        " adjusted automatically. Defaults to everything."))
+        .add(Option{"-j", "--threads"}.argument("N")
+                 .text("The number of threads used when reading the DEM"
+                       " file. Defaults to the number of hardware threads."))
         .add(Option{"-u", "--unit"}.argument("UNIT")
                  .text("Set the units used in the output: 'm' for meters,"
                        " 'f' for feet, and 'r' for 'raw', i.e. same as input."
                        " Default is meters."))
+        .add(Option{"--stream"}.argument("FORMAT")
+                 .text("Write a north-up grid without keeping the entire"
+                       " grid in memory. FORMAT is 'json' or 'binary'"
+                       " (a header with the dimensions and unknown"
+                       " elevation followed by rows of native doubles)."
+                       " --position and --size are ignored."))
+        .add(Option{"--memory"}.argument("MB")
+                 .text("The approximate amount of memory used for"
+                       " elevations with --stream. Profiles beyond this"
+                       " are moved to a temporary file. Default is 64."))
         .parse(argc, argv);
 
     auto size = args.value("--size").split(',', 2, 2).asUInts({UINT_MAX, UINT_MAX});
@@ -39,21 +57,76 @@ int main(int argc, char* argv[])
     if (unitStr != "m" && unitStr != "f" && unitStr != "r")
         args.value("--unit").error();
 
-    std::ifstream file(args.value("FILE").asString());
-    if (!file)
+    auto streamFormat = args.value("--stream").asString("json");
+    if (streamFormat != "json" && streamFormat != "binary")
+        args.value("--stream").error();
+
+    auto fileName = args.value("FILE").asString();
+    if (fileName != "-" && !std::filesystem::exists(fileName))
         args.value("FILE").error("no such file!");
 
     try
     {
-        auto demGrid = Dem::read_dem_grid(
-            file, GridLib::Unit::METERS,
-            [](size_t step, size_t steps)
+        auto progress = [](size_t step, size_t steps)
+        {
+            std::cerr << "\r" << step << " of " << steps;
+            return true;
+        };
+
+        if (args.has("--stream"))
+        {
+            Dem::NorthUpGridWriterOptions options;
+            options.memory_budget = size_t(args.value("--memory").asUInt(64))
+                                    << 20u;
+            std::unique_ptr<Dem::DemReader> reader;
+            if (fileName == "-")
+                reader = std::make_unique<Dem::DemReader>(
+                    std::cin, Dem::StreamAccess::SINGLE_PASS);
+            else
+                reader = std::make_unique<Dem::DemReader>(fileName);
+
+            std::ofstream file;
+            std::ostream* output = &std::cout;
+            if (args.has("OUTPUT"))
             {
-                std::cerr << "\r" << step << " of " << steps;
-                return true;
-            });
+                file.open(args.value("OUTPUT").asString(), std::ios::binary);
+                output = &file;
+            }
+            auto format = streamFormat == "json" ? Dem::GridFileFormat::JSON
+                                                 : Dem::GridFileFormat::BINARY;
+            Dem::write_north_up_grid(*reader, *output, format,
+                                     GridLib::Unit::METERS, options,
+                                     progress);
+            std::cerr << "\n";
+            return 0;
+        }
+
+        GridLib::Grid grid;
+        Dem::DemWindow window{position[0], position[1], size[0], size[1]};
+        bool hasWindow = args.has("--position") || args.has("--size");
+        if (fileName == "-")
+        {
+            // Pipes can't seek, read stdin from start to end.
+            Dem::DemReader reader(std::cin, Dem::StreamAccess::SINGLE_PASS);
+            if (hasWindow)
+                grid = Dem::read_dem_grid(reader, GridLib::Unit::METERS,
+                                          window, progress);
+            else
+                grid = Dem::read_dem_grid(reader, GridLib::Unit::METERS,
+                                          progress);
+        }
+        else if (hasWindow)
+        {
+            grid = Dem::read_dem_grid(fileName, GridLib::Unit::METERS,
+                                      window, progress);
+        }
+        else
+        {
+            grid = Dem::read_dem_grid(fileName, GridLib::Unit::METERS,
+                                      args.value("--threads").asUInt(0),
+                                      progress);
+        }
         std::cout << "\n";
-        auto grid = demGrid.subgrid(position[0], position[1], size[0], size[1]);
         if (args.has("OUTPUT"))
             GridLib::writeJsonGrid(args.value("OUTPUT").asString(), grid);
         else
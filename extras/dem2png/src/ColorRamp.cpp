@@ -0,0 +1,268 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-30.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "ColorRamp.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <fmt/format.h>
+
+#if defined(__AVX2__) || defined(DEM2PNG_USE_AVX2)
+    #include <immintrin.h>
+    #define DEM2PNG_AVX2
+    #if defined(__AVX2__)
+        #define DEM2PNG_AVX2_TARGET
+    #elif defined(_MSC_VER)
+        #include <intrin.h>
+        #define DEM2PNG_AVX2_TARGET
+    #else
+        #define DEM2PNG_AVX2_TARGET __attribute__((target("avx2")))
+    #endif
+#endif
+
+namespace
+{
+    uint8_t blend(uint8_t a, uint8_t b, double t)
+    {
+        return uint8_t(std::lround(a + (b - a) * t));
+    }
+
+    RGBA parseColor(std::istream& stream, const std::string& fileName,
+                    size_t lineNo)
+    {
+        int values[4] = {0, 0, 0, 255};
+        size_t count = 0;
+        while (count < 4 && stream >> values[count])
+            ++count;
+        if (count < 3 || !(stream >> std::ws).eof()
+            || std::any_of(values, values + 4,
+                           [](int v) {return v < 0 || v > 255;}))
+        {
+            throw std::runtime_error(fmt::format("{}:{}: invalid color.",
+                                                 fileName, lineNo));
+        }
+        return {uint8_t(values[0]), uint8_t(values[1]),
+                uint8_t(values[2]), uint8_t(values[3])};
+    }
+}
+
+Palette::Palette(std::vector<ColorStop> stops, bool interpolate)
+    : m_Stops(std::move(stops)),
+      m_Interpolate(interpolate)
+{
+    if (m_Stops.empty())
+        throw std::runtime_error("A palette must have at least one color.");
+}
+
+Palette Palette::defaultPalette()
+{
+    constexpr RGBA COLORS[] = {
+        {0xAE, 0xD1, 0xFC, 0xFF},
+
+        {0x7C, 0x90, 0x74, 0xFF},
+        {0x8A, 0xA0, 0x81, 0xFF},
+        {0x99, 0xB1, 0x90, 0xFF},
+        {0xAB, 0xC3, 0xA1, 0xFF},
+        {0xBF, 0xD6, 0xB6, 0xFF},
+        {0xD7, 0xE8, 0xD0, 0xFF},
+
+        {0xE4, 0xCF, 0xC6, 0xFF},
+        {0xD2, 0xB8, 0xAE, 0xFF},
+        {0xBF, 0xA5, 0x9A, 0xFF},
+        {0xAE, 0x94, 0x89, 0xFF},
+        {0x9D, 0x85, 0x7B, 0xFF},
+        {0x8C, 0x78, 0x6F, 0xFF},
+
+        {0x90, 0x80, 0x69, 0xFF},
+        {0xA1, 0x8E, 0x73, 0xFF},
+        {0xB3, 0x9E, 0x80, 0xFF},
+        {0xC5, 0xAF, 0x90, 0xFF},
+        {0xD7, 0xC2, 0xA4, 0xFF},
+        {0xE8, 0xD6, 0xBD, 0xFF}
+    };
+
+    // Band n covers the elevations whose integer part is in
+    // [25n - 24, 25n]. Everything below 1 meter is water.
+    std::vector<ColorStop> stops;
+    stops.push_back({-std::numeric_limits<double>::infinity(), COLORS[0]});
+    for (int i = 1; i < int(std::size(COLORS)); ++i)
+        stops.push_back({25.0 * i - 24, COLORS[i]});
+    stops.push_back({25.0 * int(std::size(COLORS)) - 24,
+                     {0xFF, 0xFF, 0xFF, 0xFF}});
+    return Palette(std::move(stops), false);
+}
+
+Palette Palette::load(const std::string& fileName, bool interpolate)
+{
+    std::ifstream file(fileName);
+    if (!file)
+        throw std::runtime_error("Can not open " + fileName);
+
+    std::vector<ColorStop> stops;
+    std::optional<RGBA> voidColor;
+    std::string line;
+    size_t lineNo = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNo;
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream stream(line);
+        std::string elevation;
+        if (!(stream >> elevation) || elevation[0] == '#')
+            continue;
+
+        if (elevation == "nv")
+        {
+            voidColor = parseColor(stream, fileName, lineNo);
+            continue;
+        }
+
+        char* end = nullptr;
+        auto value = std::strtod(elevation.c_str(), &end);
+        if (end != elevation.c_str() + elevation.size())
+        {
+            throw std::runtime_error(fmt::format(
+                "{}:{}: invalid elevation: {}", fileName, lineNo, elevation));
+        }
+        stops.push_back({value, parseColor(stream, fileName, lineNo)});
+    }
+
+    std::stable_sort(stops.begin(), stops.end(),
+                     [](auto& a, auto& b) {return a.elevation < b.elevation;});
+    Palette palette(std::move(stops), interpolate);
+    palette.setVoidColor(voidColor);
+    return palette;
+}
+
+RGBA Palette::color(double elevation) const
+{
+    auto it = std::upper_bound(m_Stops.begin(), m_Stops.end(), elevation,
+                               [](double e, auto& s) {return e < s.elevation;});
+    if (it == m_Stops.begin())
+        return it->color;
+    auto& lo = *std::prev(it);
+    if (!m_Interpolate || it == m_Stops.end())
+        return lo.color;
+
+    auto& hi = *it;
+    auto t = (elevation - lo.elevation) / (hi.elevation - lo.elevation);
+    return {blend(lo.color.r, hi.color.r, t),
+            blend(lo.color.g, hi.color.g, t),
+            blend(lo.color.b, hi.color.b, t),
+            blend(lo.color.a, hi.color.a, t)};
+}
+
+const std::optional<RGBA>& Palette::voidColor() const
+{
+    return m_VoidColor;
+}
+
+void Palette::setVoidColor(std::optional<RGBA> color)
+{
+    m_VoidColor = color;
+}
+
+namespace
+{
+    constexpr int32_t UNKNOWN_ELEVATION = -32767;
+    constexpr int32_t TABLE_OFFSET = 32768;
+
+#if defined(DEM2PNG_AVX2)
+
+    /*
+     * Unless dem2png itself is compiled for AVX2, only applyAvx2 uses
+     * AVX2 instructions, and it is only called if the CPU supports them.
+     */
+    bool detectAvx2()
+    {
+    #if defined(__AVX2__)
+        return true;
+    #elif defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        // The CPU must support AVX and the OS must save the AVX
+        // registers.
+        __cpuid(info, 1);
+        constexpr int OSXSAVE_AND_AVX = (1 << 27) | (1 << 28);
+        if ((info[2] & OSXSAVE_AND_AVX) != OSXSAVE_AND_AVX
+            || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    #else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    #endif
+    }
+
+    bool hasAvx2()
+    {
+        static const bool result = detectAvx2();
+        return result;
+    }
+
+    /**
+     * @brief Looks up the colors of the values eight at a time and
+     *  returns the number of values that were done.
+     */
+    DEM2PNG_AVX2_TARGET
+    size_t applyAvx2(const RGBA* table, const int16_t* values,
+                     size_t count, RGBA* colors)
+    {
+        const auto tableValues = reinterpret_cast<const int*>(table);
+        const auto offset = _mm256_set1_epi32(TABLE_OFFSET);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto v = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(values + i));
+            auto index = _mm256_add_epi32(_mm256_cvtepi16_epi32(v), offset);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(colors + i),
+                                _mm256_i32gather_epi32(tableValues, index, 4));
+        }
+        return i;
+    }
+
+#endif
+}
+
+ColorRamp::ColorRamp(const Palette& palette, double factor)
+    : m_Table(65536)
+{
+    for (int32_t i = 0; i < int32_t(m_Table.size()); ++i)
+        m_Table[i] = palette.color((i - TABLE_OFFSET) * factor);
+    if (palette.voidColor())
+        m_Table[UNKNOWN_ELEVATION + TABLE_OFFSET] = *palette.voidColor();
+}
+
+void ColorRamp::apply(const int16_t* values, size_t count,
+                      RGBA* colors) const
+{
+    static_assert(sizeof(RGBA) == sizeof(int32_t));
+    size_t i = 0;
+#if defined(DEM2PNG_AVX2)
+    if (hasAvx2())
+        i = applyAvx2(m_Table.data(), values, count, colors);
+#endif
+    for (; i < count; ++i)
+        colors[i] = m_Table[values[i] + TABLE_OFFSET];
+}
+
+RGBA ColorRamp::operator()(int16_t value) const
+{
+    return m_Table[value + TABLE_OFFSET];
+}
@@ -0,0 +1,97 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-30.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct RGBA
+{
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    uint8_t a = 0;
+};
+
+struct ColorStop
+{
+    double elevation;
+    RGBA color;
+};
+
+/**
+ * @brief Maps elevations in meters to colors.
+ */
+class Palette
+{
+public:
+    /**
+     * @param stops Must be sorted by elevation.
+     * @param interpolate If true, colors between two stops are blended
+     *  linearly. Otherwise an elevation gets the color of the highest
+     *  stop that isn't above it.
+     */
+    Palette(std::vector<ColorStop> stops, bool interpolate);
+
+    /**
+     * @brief The palette dem2png has always used, 25 meter bands from
+     *  green via brown to white.
+     */
+    static Palette defaultPalette();
+
+    /**
+     * @brief Reads a palette in the format used by gdaldem color-relief.
+     *
+     * Each line has an elevation followed by red, green, blue and
+     * optionally alpha values in the range 0-255. The elevation "nv"
+     * sets the color of unknown elevations. Empty lines and lines
+     * starting with '#' are ignored.
+     */
+    static Palette load(const std::string& fileName, bool interpolate);
+
+    [[nodiscard]]
+    RGBA color(double elevation) const;
+
+    /**
+     * @brief The color of unknown elevations, if it is different from
+     *  the color of their value.
+     */
+    [[nodiscard]]
+    const std::optional<RGBA>& voidColor() const;
+
+    void setVoidColor(std::optional<RGBA> color);
+private:
+    std::vector<ColorStop> m_Stops;
+    std::optional<RGBA> m_VoidColor;
+    bool m_Interpolate;
+};
+
+/**
+ * @brief A lookup table with the color of every raw DEM elevation.
+ *
+ * The table is computed once from a palette and the factor that
+ * converts raw values to meters. Coloring a grid is then a table lookup
+ * per value, done eight at a time with AVX2 if the CPU supports it.
+ */
+class ColorRamp
+{
+public:
+    ColorRamp(const Palette& palette, double factor);
+
+    /**
+     * @brief Writes the colors of the @a count raw elevations in
+     *  @a values to @a colors.
+     */
+    void apply(const int16_t* values, size_t count, RGBA* colors) const;
+
+    [[nodiscard]]
+    RGBA operator()(int16_t value) const;
+private:
+    std::vector<RGBA> m_Table;
+};
@@ -0,0 +1,58 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-31.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "Heightmap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+
+namespace
+{
+    constexpr int32_t UNKNOWN_ELEVATION = -32767;
+    constexpr int32_t TABLE_OFFSET = 32768;
+    constexpr unsigned NO_DATA = 0;
+    constexpr unsigned MAX_GRAY = 65535;
+}
+
+Heightmap::Heightmap(double min, double max, double factor)
+    : m_Table(65536),
+      m_Scale(max > min ? (max - min) / (MAX_GRAY - 1) : 1.0)
+{
+    // Gray level 1 is min, 0 is reserved for unknown elevations.
+    m_Offset = min - m_Scale;
+    // The gray levels are stored in big-endian byte order, which means
+    // the whole byte swap is done here rather than once per pixel.
+    for (int32_t i = 0; i < int32_t(m_Table.size()); ++i)
+    {
+        auto gray = (i - TABLE_OFFSET) * factor;
+        gray = std::clamp(std::round((gray - m_Offset) / m_Scale),
+                          1.0, double(MAX_GRAY));
+        if (i - TABLE_OFFSET == UNKNOWN_ELEVATION)
+            gray = NO_DATA;
+        auto bytes = reinterpret_cast<uint8_t*>(&m_Table[i]);
+        bytes[0] = uint8_t(unsigned(gray) >> 8u);
+        bytes[1] = uint8_t(unsigned(gray) & 0xFFu);
+    }
+}
+
+void Heightmap::apply(const int16_t* values, size_t count,
+                      uint16_t* grays) const
+{
+    for (size_t i = 0; i < count; ++i)
+        grays[i] = m_Table[values[i] + TABLE_OFFSET];
+}
+
+void Heightmap::setPngInfo(ImageFormats::PngInfo& info) const
+{
+    info.colorType(PNG_COLOR_TYPE_GRAY)
+        .bitDepth(16)
+        .addText("ElevationOffset", fmt::format("{}", m_Offset))
+        .addText("ElevationScale", fmt::format("{}", m_Scale))
+        .addText("ElevationNoData", fmt::format("{}", NO_DATA))
+        .addText("ElevationUnit", "meters");
+}
@@ -0,0 +1,47 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-31.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <ImageFormats/PngInfo.hpp>
+
+/**
+ * @brief Maps raw DEM elevations linearly to 16-bit gray levels.
+ *
+ * The lowest elevation becomes 1 and the highest 65535, 0 is reserved
+ * for unknown elevations. The mapping is stored in the PNG as the text
+ * chunks ElevationOffset, ElevationScale and ElevationNoData, an
+ * elevation in meters is ElevationOffset + ElevationScale * gray.
+ */
+class Heightmap
+{
+public:
+    /**
+     * @param min The elevation in meters that is mapped to 1.
+     * @param max The elevation in meters that is mapped to 65535.
+     * @param factor Converts raw elevations to meters.
+     */
+    Heightmap(double min, double max, double factor);
+
+    /**
+     * @brief Writes the gray levels of the @a count raw elevations in
+     *  @a values to @a grays in big-endian byte order, which is what
+     *  PNG requires.
+     */
+    void apply(const int16_t* values, size_t count, uint16_t* grays) const;
+
+    /**
+     * @brief Sets the PNG's color type and bit depth and adds the text
+     *  chunks with the mapping.
+     */
+    void setPngInfo(ImageFormats::PngInfo& info) const;
+private:
+    std::vector<uint16_t> m_Table;
+    double m_Offset;
+    double m_Scale;
+};
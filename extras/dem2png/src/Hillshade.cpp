@@ -0,0 +1,78 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-30.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "Hillshade.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr int16_t UNKNOWN_ELEVATION = -32767;
+
+    double toRadians(double degrees)
+    {
+        return degrees * 3.14159265358979323846 / 180.0;
+    }
+
+    uint8_t darken(uint8_t c, double f)
+    {
+        return uint8_t(c * f + 0.5);
+    }
+}
+
+Hillshade::Hillshade(const HillshadeOptions& options,
+                     double cellWidth, double cellHeight, double factor)
+    : m_Strength(std::clamp(options.strength, 0.0, 1.0))
+{
+    auto azimuth = toRadians(options.azimuth);
+    auto altitude = toRadians(options.altitude);
+    m_LightX = std::sin(azimuth) * std::cos(altitude);
+    m_LightY = std::cos(azimuth) * std::cos(altitude);
+    m_LightZ = std::sin(altitude);
+    // Horn's method weighs the differences 1, 2, 1 and divides by 8.
+    m_SlopeScaleX = factor / (8 * cellWidth);
+    m_SlopeScaleY = factor / (8 * cellHeight);
+}
+
+void Hillshade::apply(const Chorasmia::ArrayView2D<int16_t>& values,
+                      RGBA* colors) const
+{
+    if (m_Strength == 0 || values.rowCount() < 3 || values.columnCount() < 3)
+        return;
+
+    auto rows = values.rowCount() - 2;
+    auto cols = values.columnCount() - 2;
+    for (size_t i = 0; i < rows; ++i)
+    {
+        auto n = &values(i, 0);
+        auto m = &values(i + 1, 0);
+        auto s = &values(i + 2, 0);
+        auto dst = colors + i * cols;
+        for (size_t j = 0; j < cols; ++j)
+        {
+            if (std::min({n[j], n[j + 1], n[j + 2], m[j], m[j + 2],
+                          s[j], s[j + 1], s[j + 2]}) == UNKNOWN_ELEVATION
+                || m[j + 1] == UNKNOWN_ELEVATION)
+            {
+                continue;
+            }
+
+            // The slopes towards east and north.
+            auto dx = ((n[j + 2] + 2 * m[j + 2] + s[j + 2])
+                       - (n[j] + 2 * m[j] + s[j])) * m_SlopeScaleX;
+            auto dy = ((n[j] + 2 * n[j + 1] + n[j + 2])
+                       - (s[j] + 2 * s[j + 1] + s[j + 2])) * m_SlopeScaleY;
+            // The surface normal is (-dx, -dy, 1) / length.
+            auto light = (m_LightZ - dx * m_LightX - dy * m_LightY)
+                         / std::sqrt(1 + dx * dx + dy * dy);
+            auto f = 1 - m_Strength + m_Strength * std::max(light, 0.0);
+            auto& c = dst[j];
+            c = {darken(c.r, f), darken(c.g, f), darken(c.b, f), c.a};
+        }
+    }
+}
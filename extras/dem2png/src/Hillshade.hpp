@@ -0,0 +1,58 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-30.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <Chorasmia/ArrayView2D.hpp>
+#include "ColorRamp.hpp"
+
+struct HillshadeOptions
+{
+    /// The direction of the light in degrees clockwise from north.
+    double azimuth = 315;
+    /// The angle of the light in degrees above the horizon.
+    double altitude = 45;
+    /// How much the shade darkens the colors, from 0 to 1.
+    double strength = 0.5;
+};
+
+/**
+ * @brief Darkens colors according to how much the terrain faces away
+ *  from the light.
+ */
+class Hillshade
+{
+public:
+    /**
+     * @param cellWidth The east-west distance between elevations
+     *  in meters.
+     * @param cellHeight The north-south distance between elevations
+     *  in meters.
+     * @param factor Converts raw elevations to meters.
+     */
+    Hillshade(const HillshadeOptions& options,
+              double cellWidth, double cellHeight, double factor);
+
+    /**
+     * @brief Shades @a colors, which are the colors of @a values
+     *  without the outermost rows and columns.
+     *
+     * @a values are north-up raw elevations with a margin of one value
+     *  on each side, which are only used to compute the slopes.
+     *  Values next to unknown elevations aren't shaded.
+     */
+    void apply(const Chorasmia::ArrayView2D<int16_t>& values,
+               RGBA* colors) const;
+private:
+    double m_Strength;
+    // The light direction as a unit vector (east, north, up).
+    double m_LightX;
+    double m_LightY;
+    double m_LightZ;
+    // Convert Horn's weighted sums of raw values to slopes.
+    double m_SlopeScaleX;
+    double m_SlopeScaleY;
+};
@@ -5,90 +5,311 @@
 // This file is distributed under the BSD License.
 // License text is included with the source distribution.
 //****************************************************************************
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <Argos/Argos.hpp>
+#include <DemReader/ElevationStatistics.hpp>
+#include <DemReader/Overview.hpp>
+#include <DemReader/ProbeDem.hpp>
 #include <DemReader/ReadDemGrid.hpp>
 #include <fmt/format.h>
-#include "GridLib/WriteGrid.hpp"
 #include <ImageFormats/PngWriter.hpp>
+#include "ColorRamp.hpp"
+#include "Heightmap.hpp"
+#include "Hillshade.hpp"
 
-struct RGBA
+/**
+ * @brief Determines how tiles are written, either as heightmaps
+ *  or with colorRamp and optionally hillshade.
+ */
+struct TileStyle
 {
-    uint8_t r = 0;
-    uint8_t g = 0;
-    uint8_t b = 0;
-    uint8_t a = 0;
+    std::optional<ColorRamp> colorRamp;
+    std::optional<Hillshade> hillshade;
+    std::optional<Heightmap> heightmap;
+    std::optional<int> compressionLevel;
 };
 
-RGBA determineColor(double elevation)
+/**
+ * @brief A part of the grid, rows and columns are those of the grid,
+ *  i.e. the PNG is columnCount pixels high and rowCount pixels wide.
+ */
+struct Tile
 {
-    constexpr RGBA COLORS[] = {
-        {0xAE, 0xD1, 0xFC, 0xFF},
-
-        {0x7C, 0x90, 0x74, 0xFF},
-        {0x8A, 0xA0, 0x81, 0xFF},
-        {0x99, 0xB1, 0x90, 0xFF},
-        {0xAB, 0xC3, 0xA1, 0xFF},
-        {0xBF, 0xD6, 0xB6, 0xFF},
-        {0xD7, 0xE8, 0xD0, 0xFF},
-
-        {0xE4, 0xCF, 0xC6, 0xFF},
-        {0xD2, 0xB8, 0xAE, 0xFF},
-        {0xBF, 0xA5, 0x9A, 0xFF},
-        {0xAE, 0x94, 0x89, 0xFF},
-        {0x9D, 0x85, 0x7B, 0xFF},
-        {0x8C, 0x78, 0x6F, 0xFF},
-
-        {0x90, 0x80, 0x69, 0xFF},
-        {0xA1, 0x8E, 0x73, 0xFF},
-        {0xB3, 0x9E, 0x80, 0xFF},
-        {0xC5, 0xAF, 0x90, 0xFF},
-        {0xD7, 0xC2, 0xA4, 0xFF},
-        {0xE8, 0xD6, 0xBD, 0xFF}
+    std::string fileName;
+    size_t row;
+    size_t column;
+    size_t rowCount;
+    size_t columnCount;
+};
+
+/**
+ * @brief The number of PNG rows that are colorized before they are
+ *  passed on to the PNG writer.
+ */
+constexpr size_t BAND_HEIGHT = 64;
+
+/**
+ * @brief Copies the values of @a bandHeight PNG rows of @a tile,
+ *  starting at @a firstRow, to @a buffer in north-up order with a margin
+ *  of one value on each side.
+ *
+ * The margin is taken from the neighboring rows and tiles, which makes
+ * the hillshade seamless, and at the edges of the grid the outermost
+ * values are repeated. The grid is traversed in square blocks, which
+ * keeps both the rows of the grid and the rows of the buffer in the
+ * cache.
+ */
+Chorasmia::ArrayView2D<int16_t>
+copyNorthUp(const Chorasmia::ArrayView2D<int16_t>& grid, const Tile& tile,
+            size_t firstRow, size_t bandHeight,
+            std::vector<int16_t>& buffer)
+{
+    constexpr size_t BLOCK_SIZE = 64;
+    auto rows = bandHeight + 2;
+    auto cols = tile.rowCount + 2;
+    buffer.resize(rows * cols);
+
+    // The grid rows and columns of the buffer's columns and rows.
+    auto gridRow = [&](size_t j)
+    {
+        return std::clamp<ptrdiff_t>(ptrdiff_t(tile.row + j) - 1,
+                                     0, ptrdiff_t(grid.rowCount()) - 1);
+    };
+    auto lastColumn = tile.column + tile.columnCount - firstRow;
+    auto gridColumn = [&](size_t i)
+    {
+        return std::clamp<ptrdiff_t>(ptrdiff_t(lastColumn) - ptrdiff_t(i),
+                                     0, ptrdiff_t(grid.columnCount()) - 1);
     };
 
-    auto index = std::max(0, (int(elevation) + 24) / 25);
-    if (index < std::size(COLORS))
-        return COLORS[index];
-    return {0xFF, 0xFF, 0xFF, 0xFF};
+    for (size_t i0 = 0; i0 < rows; i0 += BLOCK_SIZE)
+    {
+        auto i1 = std::min(i0 + BLOCK_SIZE, rows);
+        for (size_t j0 = 0; j0 < cols; j0 += BLOCK_SIZE)
+        {
+            auto j1 = std::min(j0 + BLOCK_SIZE, cols);
+            for (size_t i = i0; i < i1; ++i)
+            {
+                auto c = gridColumn(i);
+                auto dst = buffer.data() + i * cols;
+                for (size_t j = j0; j < j1; ++j)
+                    dst[j] = grid(gridRow(j), c);
+            }
+        }
+    }
+    return {buffer.data(), rows, cols};
 }
 
-void makePng(const std::string& fileName,
-             const Chorasmia::ArrayView2D<double>& grid)
+struct TileBuffers
+{
+    std::vector<int16_t> values;
+    std::vector<RGBA> bmp;
+    std::vector<uint16_t> grays;
+};
+
+template <typename T>
+void writeRows(ImageFormats::PngWriter& writer, const std::vector<T>& rows,
+               size_t width)
 {
-    std::cout << fileName << "\n";
-    Chorasmia::Array2D<RGBA> bmp(grid.columnCount(), grid.rowCount());
-    for (auto i = 0; i < grid.rowCount(); ++i)
+    for (size_t i = 0; i < rows.size(); i += width)
+        writer.writeRow(&rows[i], width * sizeof(T));
+}
+
+/**
+ * @brief Colorizes @a tile and writes it to a PNG file.
+ *
+ * The tile is colorized and compressed BAND_HEIGHT rows at a time, the
+ * buffers never hold more than one band regardless of the tile size.
+ */
+void writeTile(const Tile& tile,
+               const Chorasmia::ArrayView2D<int16_t>& grid,
+               const TileStyle& style,
+               TileBuffers& buffers)
+{
+    std::ofstream stream(tile.fileName, std::ios::binary);
+    if (!stream)
+        throw std::runtime_error("Can not create " + tile.fileName);
+
+    auto width = tile.rowCount;
+    auto height = tile.columnCount;
+    ImageFormats::PngInfo info;
+    info.width(unsigned(width))
+        .height(unsigned(height))
+        .compressionLevel(style.compressionLevel);
+    if (style.heightmap)
+        style.heightmap->setPngInfo(info);
+    ImageFormats::PngWriter writer(stream, std::move(info), {});
+    writer.writeInfo();
+
+    auto& bmp = buffers.bmp;
+    auto& grays = buffers.grays;
+    for (size_t row = 0; row < height; row += BAND_HEIGHT)
     {
-        for (auto j = 0; j < grid.columnCount(); ++j)
+        auto bandHeight = std::min(BAND_HEIGHT, height - row);
+        auto values = copyNorthUp(grid, tile, row, bandHeight,
+                                  buffers.values);
+        if (style.heightmap)
+        {
+            grays.resize(width * bandHeight);
+            for (size_t i = 0; i < bandHeight; ++i)
+            {
+                style.heightmap->apply(&values(i + 1, 1), width,
+                                       &grays[i * width]);
+            }
+            writeRows(writer, grays, width);
+        }
+        else
         {
-            auto ii = grid.columnCount() - j - 1;
-            bmp(ii, i) = determineColor(grid(i, j));
+            bmp.resize(width * bandHeight);
+            for (size_t i = 0; i < bandHeight; ++i)
+            {
+                style.colorRamp->apply(&values(i + 1, 1), width,
+                                       &bmp[i * width]);
+            }
+            if (style.hillshade)
+                style.hillshade->apply(values, bmp.data());
+            writeRows(writer, bmp, width);
         }
     }
-    ImageFormats::writePng(fileName, bmp.data(), bmp.valueCount() * sizeof(RGBA),
-                           ImageFormats::PngInfo()
-                               .width(bmp.columnCount())
-                               .height(bmp.rowCount()), {});
+    writer.writeEnd();
 }
 
-void makeTiles(const GridLib::GridView& grid,
-               unsigned rows, unsigned cols,
-               const std::string& fileName)
+std::vector<Tile> makeTiles(size_t gridRows, size_t gridColumns,
+                            size_t rows, size_t cols,
+                            const std::string& fileName)
 {
     std::filesystem::path path(fileName);
     auto extension = path.extension().string();
     auto prefix = path.replace_extension().string();
-    for (size_t i = 0; i < grid.rowCount(); i += rows)
+    std::vector<Tile> tiles;
+    for (size_t i = 0; i < gridRows; i += rows)
+    {
+        for (size_t j = 0; j < gridColumns; j += cols)
+        {
+            tiles.push_back({fmt::format("{}_{:04}_{:04}{}",
+                                         prefix, i, j, extension),
+                             i, j,
+                             std::min(rows, gridRows - i),
+                             std::min(cols, gridColumns - j)});
+        }
+    }
+    return tiles;
+}
+
+/**
+ * @brief Inserts _2x, _4x etc. before the extension of @a fileName.
+ */
+std::string getOverviewFileName(const std::string& fileName, unsigned level)
+{
+    std::filesystem::path path(fileName);
+    auto extension = path.extension().string();
+    return fmt::format("{}_{}x{}", path.replace_extension().string(),
+                       1u << level, extension);
+}
+
+/**
+ * @brief Colorizes and compresses the tiles with @a threadCount threads.
+ *
+ * Each thread has its own buffers that are reused for all the tiles
+ * it writes. The files are identical to those written by a single
+ * thread, only the order of the file names in the output differs.
+ */
+void writeTiles(const std::vector<Tile>& tiles,
+                const Chorasmia::ArrayView2D<int16_t>& grid,
+                const TileStyle& style,
+                unsigned threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    threadCount = unsigned(std::min<size_t>(threadCount, tiles.size()));
+
+    std::atomic<size_t> nextTile(0);
+    std::atomic<bool> stop(false);
+    std::mutex mutex;
+    std::exception_ptr error;
+
+    auto worker = [&]
+    {
+        TileBuffers buffers;
+        while (!stop)
+        {
+            auto i = nextTile++;
+            if (i >= tiles.size())
+                break;
+
+            try
+            {
+                writeTile(tiles[i], grid, style, buffers);
+            }
+            catch (...)
+            {
+                std::lock_guard lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+                stop = true;
+                break;
+            }
+
+            std::lock_guard lock(mutex);
+            std::cout << tiles[i].fileName << "\n";
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+/**
+ * @brief Returns the east-west and north-south distances in meters
+ *  between the elevations in the DEM file.
+ */
+std::pair<double, double> getCellSize(const Dem::RecordA& recordA)
+{
+    if (!recordA.x_resolution || !recordA.y_resolution)
+        throw std::runtime_error("The DEM file lacks a resolution.");
+
+    double x = *recordA.x_resolution;
+    double y = *recordA.y_resolution;
+    switch (recordA.horizontal_unit.value_or(2))
+    {
+    case 1:
+        return {x * 0.3048, y * 0.3048};
+    case 3:
     {
-        for (size_t j = 0; j < grid.columnCount(); j += cols)
+        // Arc-seconds. The distance between meridians depends on the
+        // latitude, use the one at the middle of the western edge.
+        constexpr double METERS_PER_ARC_SECOND = 30.87;
+        double latitude = 0;
+        if (recordA.quadrangle_corners[0] && recordA.quadrangle_corners[1])
         {
-            makePng(fmt::format("{}_{:04}_{:04}{}",
-                                prefix, i, j, extension),
-                    grid.elevations().subarray(i, j, rows, cols));
+            latitude = (recordA.quadrangle_corners[0]->northing
+                        + recordA.quadrangle_corners[1]->northing) / 7200;
         }
+        else if (recordA.latitude)
+        {
+            latitude = Dem::to_degrees(*recordA.latitude);
+        }
+        return {x * METERS_PER_ARC_SECOND
+                * std::cos(latitude * 3.14159265358979323846 / 180),
+                y * METERS_PER_ARC_SECOND};
+    }
+    default:
+        return {x, y};
     }
 }
 
@@ -106,35 +327,205 @@ int main(int argc, char* argv[])
         .add(Option{"-s", "--size"}.argument("ROWS,COLS")
                  .text("The tile size. Defaults to whichever is smaller of"
                        " the size of the grid and 1024x1024."))
+        .add(Option{"-j", "--threads"}.argument("N")
+                 .text("The number of threads used when reading the DEM"
+                       " file and writing the tiles. Defaults to the number"
+                       " of hardware threads."))
+        .add(Option{"--palette"}.argument("FILE")
+                 .text("Read the colors from FILE. Each line has an"
+                       " elevation in meters followed by red, green, blue"
+                       " and optionally alpha values from 0 to 255, as in"
+                       " gdaldem color-relief. An elevation of \"nv\" sets"
+                       " the color of unknown elevations. The colors are"
+                       " blended between elevations unless --bands is"
+                       " given."))
+        .add(Option{"--bands"}
+                 .text("Don't blend the colors in the palette file, each"
+                       " color is used from its elevation up to the next."))
+        .add(Option{"-c", "--compression"}.argument("LEVEL")
+                 .text("The PNG compression level, from 0 (fastest) to 9"
+                       " (smallest files). Defaults to zlib's default,"
+                       " which is 6."))
+        .add(Option{"--hillshade"}.argument("STRENGTH")
+                 .text("Darken slopes facing away from a light in the"
+                       " north-west. STRENGTH is a value from 0 to 1,"
+                       " 0.5 is a reasonable choice."))
+        .add(Option{"--heightmap"}
+                 .text("Write 16-bit grayscale PNGs where the gray level"
+                       " is proportional to the elevation. The mapping is"
+                       " stored in the text chunks ElevationOffset and"
+                       " ElevationScale: elevation = ElevationOffset +"
+                       " ElevationScale * gray. Unknown elevations are 0,"
+                       " which is also stored in the text chunk"
+                       " ElevationNoData, the elevations are 1-65535."))
+        .add(Option{"--range"}.argument("MIN,MAX")
+                 .text("The elevations in meters that are mapped to 1 and"
+                       " 65535 in heightmaps. Defaults to the lowest and"
+                       " highest elevation in the DEM file, or in the tile"
+                       " with --position."))
+        .add(Option{"-l", "--levels"}.argument("N")
+                 .text("Also write N overviews at 2x, 4x, 8x etc. of the"
+                       " original size, each computed from the previous"
+                       " one. The overviews are tiled like the original,"
+                       " with _2x, _4x etc. inserted before the extension"
+                       " of OUTPUT."))
+        .add(Option{"--reducer"}.argument("NAME")
+                 .text("How each 2x2 block of elevations is reduced in"
+                       " overviews: mean, min, max or nearest. Unknown"
+                       " elevations are ignored. Defaults to mean."))
         .parse(argc, argv);
 
     auto size = args.value("--size").split(',', 2, 2).asUInts({1024, 1024});
 
     auto inFileName = args.value("FILE").asString();
-    std::ifstream file(inFileName);
-    if (!file)
+    if (!std::filesystem::exists(inFileName))
         args.value("FILE").error("no such file!");
 
     auto outFileName = args.value("OUTPUT").asString();
 
+    auto levels = args.value("--levels").asUInt(0);
+    auto reducerName = args.value("--reducer").asString("mean");
+    auto reducer = Dem::OverviewReducer::MEAN;
+    if (reducerName == "min")
+        reducer = Dem::OverviewReducer::MIN;
+    else if (reducerName == "max")
+        reducer = Dem::OverviewReducer::MAX;
+    else if (reducerName == "nearest")
+        reducer = Dem::OverviewReducer::NEAREST;
+    else if (reducerName != "mean")
+        args.value("--reducer").error("unknown reducer: " + reducerName);
+
     try
     {
-        auto grid = Dem::read_dem_grid(
-            file, GridLib::Unit::METERS,
-            [](size_t step, size_t steps)
-            {
-                std::cerr << "\r" << step << " of " << steps;
-                return true;
-            });
-        std::cout << "\n";
+        auto progress = [](size_t step, size_t steps)
+        {
+            std::cerr << "\r" << step << " of " << steps;
+            return true;
+        };
+
+        auto threads = args.value("--threads").asUInt(0);
+        Dem::ElevationStatistics statistics;
+        Dem::CompactGrid grid;
+        std::vector<Tile> tiles;
         if (args.has("-p"))
         {
+            // Only the tile and a margin of one value, which gives the
+            // hillshade the same neighbors at the tile's edges as when
+            // the whole grid is read, are decoded.
             auto pos = args.value("--position").split(',', 2, 2).asUInts();
-            makePng(outFileName, grid.elevations().subarray(pos[0], pos[1], size[0], size[1]));
+            Dem::DemWindow window;
+            window.row = pos[0] == 0 ? 0 : pos[0] - 1;
+            window.column = pos[1] == 0 ? 0 : pos[1] - 1;
+            window.row_count = size_t(size[0]) + (pos[0] - window.row) + 1;
+            window.column_count = size_t(size[1]) + (pos[1] - window.column)
+                                  + 1;
+            grid = Dem::read_compact_dem_grid(inFileName,
+                                              GridLib::Unit::METERS,
+                                              window, progress);
+
+            auto values = grid.values();
+            auto row = std::min<size_t>(pos[0] - window.row,
+                                        values.rowCount());
+            auto col = std::min<size_t>(pos[1] - window.column,
+                                        values.columnCount());
+            tiles.push_back({outFileName, row, col,
+                             std::min<size_t>(size[0], values.rowCount() - row),
+                             std::min<size_t>(size[1],
+                                              values.columnCount() - col)});
+            for (size_t i = 0; i < tiles[0].rowCount; ++i)
+                statistics.add(&values(row + i, col), tiles[0].columnCount);
+        }
+        else
+        {
+            grid = Dem::read_compact_dem_grid(inFileName,
+                                              GridLib::Unit::METERS,
+                                              threads, statistics,
+                                              progress);
+        }
+        std::cout << "\n";
+
+        TileStyle style;
+        if (args.has("--compression"))
+            style.compressionLevel = args.value("--compression").asInt();
+
+        if (args.has("--heightmap"))
+        {
+            double min = statistics.min().value_or(0) * grid.factor();
+            double max = statistics.max().value_or(0) * grid.factor();
+            if (args.has("--range"))
+            {
+                auto range = args.value("--range").split(',', 2, 2)
+                    .asDoubles();
+                min = range[0];
+                max = range[1];
+            }
+            style.heightmap = Heightmap(min, max, grid.factor());
         }
         else
         {
-            makeTiles(grid, size[0], size[1], outFileName);
+            auto palette = Palette::defaultPalette();
+            if (args.has("--palette"))
+            {
+                palette = Palette::load(args.value("--palette").asString(),
+                                        !args.has("--bands"));
+            }
+            style.colorRamp = ColorRamp(palette, grid.factor());
+        }
+
+        HillshadeOptions hillshadeOptions;
+        std::pair<double, double> cellSize;
+        if (args.has("--hillshade") && !style.heightmap)
+        {
+            cellSize = getCellSize(Dem::probe_dem(inFileName).record_a);
+            hillshadeOptions.strength = args.value("--hillshade").asDouble();
+            style.hillshade = Hillshade(hillshadeOptions,
+                                        cellSize.first, cellSize.second,
+                                        grid.factor());
+        }
+
+        Chorasmia::ArrayView2D<int16_t> values = grid.values();
+        if (!args.has("-p"))
+        {
+            tiles = makeTiles(values.rowCount(), values.columnCount(),
+                              size[0], size[1], outFileName);
+        }
+        writeTiles(tiles, values, style, threads);
+
+        // With --position, the overviews are made from the tile.
+        if (args.has("-p"))
+        {
+            values = values.subarray(tiles[0].row, tiles[0].column,
+                                     tiles[0].rowCount, tiles[0].columnCount);
+        }
+
+        Chorasmia::Array2D<int16_t> overview;
+        for (unsigned level = 1; level <= levels; ++level)
+        {
+            overview = Dem::make_overview(values, reducer);
+            values = Chorasmia::ArrayView2D<int16_t>(
+                overview.data(), overview.rowCount(), overview.columnCount());
+
+            if (style.hillshade)
+            {
+                auto scale = double(1u << level);
+                style.hillshade = Hillshade(hillshadeOptions,
+                                            cellSize.first * scale,
+                                            cellSize.second * scale,
+                                            grid.factor());
+            }
+
+            auto fileName = getOverviewFileName(outFileName, level);
+            if (args.has("-p"))
+            {
+                tiles = {{fileName, 0, 0,
+                          values.rowCount(), values.columnCount()}};
+            }
+            else
+            {
+                tiles = makeTiles(values.rowCount(), values.columnCount(),
+                                  size[0], size[1], fileName);
+            }
+            writeTiles(tiles, values, style, threads);
         }
     }
     catch (std::exception& ex)
@@ -5,55 +5,155 @@
 // This file is distributed under the BSD License.
 // License text is included with the source distribution.
 //****************************************************************************
+#include <algorithm>
+#include <climits>
 #include <iostream>
-#include <fstream>
+#include <filesystem>
 #include <Argos/Argos.hpp>
 #include <DemReader/DemReader.hpp>
+#include <DemReader/ElevationStatistics.hpp>
+#include <DemReader/ProbeDem.hpp>
 
 struct RecordBStats
 {
     unsigned count = 0;
     unsigned max_row = 0;
     unsigned max_column = 0;
-    unsigned missing = 0;
 };
 
+void print_statistics(const Dem::ElevationStatistics& statistics)
+{
+    std::cout << "number of missing elevations: "
+              << statistics.void_count() << '\n';
+    if (statistics.count() == 0)
+        return;
+
+    std::cout << "minimum raw elevation: " << *statistics.min() << '\n'
+              << "maximum raw elevation: " << *statistics.max() << '\n'
+              << "mean raw elevation: " << *statistics.mean() << '\n';
+
+    const auto& histogram = statistics.histogram();
+    if (histogram.empty())
+        return;
+
+    std::cout << "histogram:\n";
+    auto binSize = int(statistics.histogram_bin_size());
+    for (size_t i = 0; i < histogram.size(); ++i)
+    {
+        if (histogram[i] == 0)
+            continue;
+        auto low = INT16_MIN + int(i) * binSize;
+        std::cout << "    " << low << ".." << low + binSize - 1
+                  << ": " << histogram[i] << '\n';
+    }
+}
+
+void print_full_info(const std::string& fileName, unsigned binSize)
+{
+    Dem::DemReader reader(fileName);
+    const auto& a = reader.record_a();
+    print(a, std::cout);
+    RecordBStats stats;
+    Dem::ElevationStatistics statistics(binSize);
+    reader.set_statistics(&statistics);
+    Dem::RecordB b;
+    std::vector<int16_t> elevations;
+    while (reader.next_record_b(b, elevations))
+    {
+        stats.count++;
+        stats.max_row = std::max(stats.max_row, unsigned(b.row + b.rows - 1));
+        stats.max_column = std::max(stats.max_column, unsigned(b.column + b.columns - 1));
+        std::cout << "\r" << stats.count << std::flush;
+    }
+    std::cout << '\r'
+              << "instances of record B: " << stats.count << '\n'
+              << "rowCount: " << stats.max_row << '\n'
+              << "columnCount: " << stats.max_column << '\n';
+    print_statistics(statistics);
+}
+
+void print_fast_info(const std::string& fileName, const Dem::DemProbe& probe)
+{
+    std::cout << "file: " << fileName << '\n';
+    print(probe.record_a, std::cout);
+    if (probe.record_c)
+        print(*probe.record_c, std::cout);
+    std::cout << "file size: " << probe.file_size << '\n'
+              << "instances of record B: " << probe.profile_count << '\n';
+    if (probe.profile_length != 0)
+        std::cout << "rowCount: " << probe.profile_length << '\n';
+    else
+        std::cout << "rowCount: varies\n";
+    std::cout << "columnCount: " << probe.profile_count << '\n';
+}
+
 int main(int argc, char* argv[])
 {
     using namespace Argos;
     auto args = ArgumentParser(argv[0], true)
-        .add(Argument("FILE"))
+        .add(Argument("FILE").count(1, UINT_MAX)
+                 .text("The DEM file or files."))
+        .add(Option{"--fast"}
+                 .text("Only read records A and C and the start of the first"
+                       " record of type B, and read several files in"
+                       " parallel. The number of missing elevations is not"
+                       " shown."))
+        .add(Option{"--histogram"}.argument("SIZE")
+                 .text("Also show a histogram of the raw elevations with"
+                       " SIZE values in each bin. Not available with"
+                       " --fast."))
+        .add(Option{"-j", "--threads"}.argument("N")
+                 .text("The number of threads used with --fast. Defaults to"
+                       " the number of hardware threads."))
         .parse(argc, argv);
 
-    std::ifstream file(args.value("FILE").asString());
-    if (!file)
-        args.value("FILE").error("no such file!");
+    auto fileNames = args.values("FILE").asStrings();
 
     std::ios::sync_with_stdio(false);
 
-    try
+    if (args.has("--fast"))
     {
-        Dem::DemReader reader(file);
-        const auto& a = reader.record_a();
-        print(a, std::cout);
-        RecordBStats stats;
-        for (auto b = reader.next_record_b(); b; b = reader.next_record_b())
+        auto threads = args.value("--threads").asUInt(0);
+        try
+        {
+            Dem::probe_dems(fileNames, threads,
+                            [&](size_t i, Dem::DemProbeResult&& result)
+                            {
+                                if (result.probe)
+                                    print_fast_info(fileNames[i], *result.probe);
+                                else
+                                    std::cout << "Exception: " << result.error << "\n";
+                                std::cout << '\n';
+                                return true;
+                            });
+        }
+        catch (std::exception& ex)
         {
-            stats.count++;
-            stats.max_row = std::max(stats.max_row, unsigned(b->row + b->rows - 1));
-            stats.max_column = std::max(stats.max_column, unsigned(b->column + b->columns - 1));
-            stats.missing = std::count(b->elevations.begin(), b->elevations.end(), -32767);
-            std::cout << "\r" << stats.count << std::flush;
+            std::cout << "Exception: " << ex.what() << "\n";
         }
-        std::cout << '\r'
-                  << "instances of record B: " << stats.count << '\n'
-                  << "rowCount: " << stats.max_row << '\n'
-                  << "columnCount: " << stats.max_column << '\n'
-                  << "number of missing elevations: " << stats.missing << '\n';
+        return 0;
     }
-    catch (std::exception& ex)
+
+    auto binSize = args.value("--histogram").asUInt(0);
+
+    for (const auto& fileName : fileNames)
     {
-        std::cout << "Exception: " << ex.what() << "\n";
+        if (!std::filesystem::exists(fileName))
+            args.values("FILE").error(fileName + ": no such file!");
+    }
+
+    for (const auto& fileName : fileNames)
+    {
+        try
+        {
+            if (fileNames.size() > 1)
+                std::cout << "file: " << fileName << '\n';
+            print_full_info(fileName, binSize);
+        }
+        catch (std::exception& ex)
+        {
+            std::cout << "Exception: " << ex.what() << "\n";
+        }
     }
     return 0;
 }
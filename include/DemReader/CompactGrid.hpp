@@ -0,0 +1,85 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-02-27.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <GridLib/Grid.hpp>
+
+namespace Dem
+{
+    /**
+     * @brief A grid that stores the raw elevations from a DEM file
+     *  as int16_t together with the factor that converts them to the
+     *  grid's vertical unit.
+     *
+     * A CompactGrid uses a quarter of the memory of a GridLib::Grid
+     * with the same size. Elevations are converted to double only when
+     * they are requested, either one at a time with elevation() or for
+     * the entire grid with to_grid().
+     */
+    class CompactGrid
+    {
+    public:
+        CompactGrid();
+
+        CompactGrid(size_t rows, size_t columns);
+
+        [[nodiscard]]
+        size_t row_count() const;
+
+        [[nodiscard]]
+        size_t column_count() const;
+
+        void resize(size_t rows, size_t columns);
+
+        /**
+         * @brief The factor that converts the raw values to elevations.
+         */
+        [[nodiscard]]
+        double factor() const;
+
+        void set_factor(double factor);
+
+        [[nodiscard]]
+        Chorasmia::ArrayView2D<int16_t> values() const;
+
+        [[nodiscard]]
+        Chorasmia::MutableArrayView2D<int16_t> values();
+
+        /**
+         * @brief Returns the elevation at @a row, @a column in the
+         *  grid's vertical unit.
+         */
+        [[nodiscard]]
+        double elevation(size_t row, size_t column) const;
+
+        /**
+         * @brief A grid without elevations that holds the coordinates,
+         *  axes, reference system etc. of this grid.
+         */
+        [[nodiscard]]
+        const GridLib::Grid& metadata() const;
+
+        [[nodiscard]]
+        GridLib::Grid& metadata();
+
+        /**
+         * @brief Returns a GridLib::Grid with the same metadata as this
+         *  grid and elevations of type double.
+         */
+        [[nodiscard]]
+        GridLib::Grid to_grid() const;
+    private:
+        GridLib::Grid m_Metadata;
+        std::vector<int16_t> m_Values;
+        size_t m_Rows = 0;
+        size_t m_Columns = 0;
+        double m_Factor = 1.0;
+    };
+}
@@ -0,0 +1,129 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-24.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <Chorasmia/ArrayView2D.hpp>
+#include "CompactGrid.hpp"
+#include "RecordA.hpp"
+
+namespace Dem
+{
+    /**
+     * @brief Identifies the version of the DEM file a cache was
+     *  made from.
+     */
+    struct DemCacheSource
+    {
+        uint64_t size = 0;
+        /// The file's modification time in nanoseconds.
+        int64_t modification_time = 0;
+    };
+
+    bool operator==(const DemCacheSource& a, const DemCacheSource& b);
+
+    bool operator!=(const DemCacheSource& a, const DemCacheSource& b);
+
+    [[nodiscard]]
+    DemCacheSource get_dem_cache_source(const std::string& dem_file_name);
+
+    /**
+     * @brief Writes the raw elevations in @a values and the parts of
+     *  @a a that are used by read_dem_grid to @a cache_file_name.
+     *
+     * The file is written under a temporary name and then renamed, so
+     * readers never see a partially written cache.
+     */
+    void write_dem_cache(const std::string& cache_file_name,
+                         const RecordA& a,
+                         const Chorasmia::ArrayView2D<int16_t>& values,
+                         const DemCacheSource& source);
+
+    /**
+     * @brief Writes a cache with the grid in @a dem_file_name.
+     */
+    void write_dem_cache(const std::string& cache_file_name,
+                         const std::string& dem_file_name);
+
+    class DemReader;
+
+    /**
+     * @brief Writes a cache with the remaining records in @a reader.
+     */
+    void write_dem_cache(const std::string& cache_file_name,
+                         DemReader& reader,
+                         const DemCacheSource& source);
+
+    /**
+     * @brief A memory-mapped cache file written by write_dem_cache.
+     *
+     * Opening a cache only validates its header, the elevations are
+     * returned as a view of the mapped memory.
+     */
+    class DemCache
+    {
+    public:
+        DemCache();
+
+        explicit DemCache(const std::string& file_name);
+
+        DemCache(DemCache&& rhs) noexcept;
+
+        ~DemCache();
+
+        DemCache& operator=(DemCache&& rhs) noexcept;
+
+        [[nodiscard]]
+        const DemCacheSource& source() const;
+
+        /**
+         * @brief Returns true if @a dem_file_name has the same size and
+         *  modification time as the file the cache was made from.
+         */
+        [[nodiscard]]
+        bool is_current(const std::string& dem_file_name) const;
+
+        /**
+         * @brief Returns the fields of record A that are stored in the
+         *  cache. The remaining fields are empty.
+         */
+        [[nodiscard]]
+        const RecordA& record_a() const;
+
+        /**
+         * @brief Returns the raw elevations, with one row per profile.
+         *
+         * The view is valid as long as the DemCache is.
+         */
+        [[nodiscard]]
+        Chorasmia::ArrayView2D<int16_t> values() const;
+
+        [[nodiscard]]
+        CompactGrid to_compact_grid(GridLib::Unit vertical_unit) const;
+
+        [[nodiscard]]
+        GridLib::Grid to_grid(GridLib::Unit vertical_unit) const;
+    private:
+        struct Data;
+        std::unique_ptr<Data> m_Data;
+    };
+
+    /**
+     * @brief Returns the grid in @a dem_file_name, reading it from
+     *  @a cache_file_name if the cache is up to date.
+     *
+     * The cache is written if it doesn't exist or is stale. Failing to
+     * write it doesn't prevent the grid from being returned.
+     */
+    [[nodiscard]]
+    CompactGrid
+    read_cached_compact_dem_grid(const std::string& dem_file_name,
+                                 const std::string& cache_file_name,
+                                 GridLib::Unit vertical_unit);
+}
@@ -0,0 +1,144 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-02-20.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Dem
+{
+    /**
+     * @brief The location and header values of a record of type B.
+     */
+    struct RecordBInfo
+    {
+        /// The record's byte offset from the start of the file.
+        size_t offset = 0;
+        /// The number of bytes the record occupies, including padding.
+        size_t size = 0;
+        int16_t row = 0;
+        int16_t column = 0;
+        int16_t rows = 0;
+        int16_t columns = 0;
+    };
+
+    /**
+     * @brief Identifies the DEM data an index was built from.
+     */
+    struct DemIndexSource
+    {
+        /// The size of the DEM file or stream, compressed or not, 0 if
+        /// it is unknown.
+        uint64_t size = 0;
+        /// The file's modification time in nanoseconds, 0 if it is
+        /// unknown, e.g. for streams and memory buffers.
+        int64_t modification_time = 0;
+    };
+
+    bool operator==(const DemIndexSource& a, const DemIndexSource& b);
+
+    bool operator!=(const DemIndexSource& a, const DemIndexSource& b);
+
+    /**
+     * @brief Returns the size and modification time of @a dem_file_name.
+     */
+    [[nodiscard]]
+    DemIndexSource get_dem_index_source(const std::string& dem_file_name);
+
+    /**
+     * @brief An index of all the records of type B in a DEM file.
+     */
+    class DemIndex
+    {
+    public:
+        DemIndex();
+
+        explicit DemIndex(std::vector<RecordBInfo> records,
+                          const DemIndexSource& source = {});
+
+        [[nodiscard]]
+        const DemIndexSource& source() const;
+
+        void set_source(const DemIndexSource& source);
+
+        [[nodiscard]]
+        const std::vector<RecordBInfo>& records() const;
+
+        [[nodiscard]]
+        size_t size() const;
+
+        [[nodiscard]]
+        bool empty() const;
+
+        [[nodiscard]]
+        const RecordBInfo& operator[](size_t index) const;
+
+        /**
+         * @brief Returns the index of the first record of type B that
+         *  contains @a column.
+         */
+        [[nodiscard]]
+        std::optional<size_t> find_column(int column) const;
+    private:
+        std::vector<RecordBInfo> m_Records;
+        DemIndexSource m_Source;
+    };
+
+    class FortranReader;
+
+    /**
+     * @brief Scans the records of type B, starting at the reader's
+     *  current position.
+     *
+     * Only the first four fields of each record are parsed, the
+     * elevations are skipped. The reader is left at the end of the last
+     * record of type B.
+     *
+     * @param has_record_c Whether the final block in the file is a
+     *  record of type C.
+     */
+    [[nodiscard]]
+    DemIndex build_dem_index(FortranReader& reader, bool has_record_c);
+
+    /**
+     * @brief Writes @a index, including its source, as text.
+     */
+    void save_dem_index(const DemIndex& index, std::ostream& stream);
+
+    void save_dem_index(const DemIndex& index, const std::string& file_name);
+
+    /**
+     * @brief Reads an index that was written by save_dem_index.
+     */
+    [[nodiscard]]
+    DemIndex load_dem_index(std::istream& stream);
+
+    [[nodiscard]]
+    DemIndex load_dem_index(const std::string& file_name);
+
+    /**
+     * @brief Reads an index that was written by save_dem_index and
+     *  throws DemException unless it was built from
+     *  @a expected_source.
+     */
+    [[nodiscard]]
+    DemIndex load_dem_index(std::istream& stream,
+                            const DemIndexSource& expected_source);
+
+    /**
+     * @brief Reads the index in @a file_name and throws DemException
+     *  unless it was built from the current version of
+     *  @a dem_file_name.
+     */
+    [[nodiscard]]
+    DemIndex load_dem_index(const std::string& file_name,
+                            const std::string& dem_file_name);
+}
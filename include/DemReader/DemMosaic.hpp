@@ -0,0 +1,54 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-21.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <string>
+#include <vector>
+#include "ReadDemGrid.hpp"
+
+namespace Dem
+{
+    /**
+     * @brief Decides which file provides the elevations where the grids
+     *  of two or more files overlap.
+     */
+    enum class MosaicOverlap
+    {
+        /// The elevations of the file that comes first in the list
+        /// are kept.
+        FIRST,
+        /// The elevations of the file that comes last in the list
+        /// are kept.
+        LAST
+    };
+
+    struct MosaicOptions
+    {
+        GridLib::Unit vertical_unit = GridLib::Unit::METERS;
+        MosaicOverlap overlap = MosaicOverlap::FIRST;
+    };
+
+    /**
+     * @brief Reads the DEM files in @a file_names into a single grid.
+     *
+     * Each profile is placed by its coordinates in record B, and all the
+     * files must have the same reference system, zone, horizontal unit
+     * and resolution, with profiles that lie on the same lattice. The
+     * extent of the result is the lattice points inside the files'
+     * quadrangles. Cells that aren't covered by any profile, or only by
+     * unknown elevations, are unknown in the result. Unknown elevations
+     * never replace known ones, regardless of @a options.overlap.
+     *
+     * The profiles are written directly to their place in the result,
+     * one file at a time, so the memory used is little more than the
+     * size of the result.
+     */
+    GridLib::Grid
+    build_dem_mosaic(const std::vector<std::string>& file_names,
+                     const MosaicOptions& options = {},
+                     const ProgressCallback& progress_callback = {});
+}
@@ -7,18 +7,97 @@
 //****************************************************************************
 #pragma once
 #include <iosfwd>
-#include <vector>
+#include <memory>
 #include <optional>
+#include <string>
+#include <vector>
+#include "DemIndex.hpp"
 #include "RecordA.hpp"
 #include "RecordC.hpp"
 #include "RecordB.hpp"
 
 namespace Dem
 {
+    class ElevationStatistics;
+
+    /**
+     * @brief Settings for reading DEM files through a background thread.
+     */
+    struct ReadAheadOptions
+    {
+        /// The number of bytes read in each read operation.
+        size_t buffer_size = 1024 * 1024;
+        /// The number of buffers that are filled ahead of the one being
+        /// parsed.
+        size_t depth = 2;
+    };
+
+    /**
+     * @brief Tells DemReader whether it may move around in its input
+     *  stream.
+     */
+    enum class StreamAccess
+    {
+        /// The reader may seek, e.g. to read record C before the
+        /// records of type B.
+        SEEKABLE,
+        /// The input is read from start to end without any seeking.
+        /// Record C becomes available when the last record of type B
+        /// has been read. Use this for pipes and for storage where
+        /// seeking is expensive.
+        SINGLE_PASS
+    };
+
     class DemReader
     {
     public:
-        DemReader(std::istream& stream);
+        /**
+         * @brief Reads the DEM records in @a stream.
+         *
+         * gzip- and zstd-compressed streams are detected and
+         * decompressed in a background thread while the records are
+         * being parsed.
+         */
+        DemReader(std::istream& stream,
+                  StreamAccess access = StreamAccess::SEEKABLE);
+
+        /**
+         * @brief Reads @a stream in a background thread that fills
+         *  buffers while the previous ones are being parsed.
+         *
+         * The stream is only accessed from the background thread until
+         * the DemReader is destroyed.
+         */
+        DemReader(std::istream& stream, const ReadAheadOptions& options,
+                  StreamAccess access = StreamAccess::SEEKABLE);
+
+        /**
+         * @brief Reads the DEM file @a file_name via a memory map.
+         *
+         * The records are parsed directly from the mapped memory, nothing
+         * is copied into intermediate buffers.
+         *
+         * Files that are compressed with gzip or zstd are instead read
+         * as streams and decompressed in a background thread.
+         */
+        explicit DemReader(const std::string& file_name);
+
+        /**
+         * @brief Reads the DEM file @a file_name with a background
+         *  read-ahead thread rather than via a memory map.
+         *
+         * This is faster than the memory map on network storage and
+         * spinning disks, where each page fault stalls the parser.
+         */
+        DemReader(const std::string& file_name,
+                  const ReadAheadOptions& options);
+
+        /**
+         * @brief Reads the DEM records in the @a size bytes at @a data.
+         *
+         * The memory must remain valid for the lifetime of the DemReader.
+         */
+        DemReader(const char* data, size_t size);
 
         DemReader(DemReader&& rhs) noexcept;
 
@@ -29,19 +108,144 @@ namespace Dem
         [[nodiscard]]
         const RecordA& record_a() const;
 
+        /**
+         * @brief Returns the record of type C, if the file has one.
+         *
+         * Streams that can't seek, e.g. pipes and compressed files, and
+         * streams opened with StreamAccess::SINGLE_PASS are read front
+         * to back. Their record of type C is only available after the
+         * last record of type B has been read.
+         */
         [[nodiscard]]
         const std::optional<RecordC>& record_c() const;
 
         [[nodiscard]]
         std::optional<RecordB> next_record_b();
+
+        /**
+         * @brief Reads the next record of type B into @a record.
+         *
+         * The memory allocated for record.elevations is reused, so
+         * reading all the records in a file into the same RecordB
+         * only allocates memory when a record is larger than all the
+         * previous ones.
+         *
+         * @return false if there are no more records of type B.
+         */
+        bool next_record_b(RecordB& record);
+
+        /**
+         * @brief Reads the next record of type B into @a record, but
+         *  decodes its elevations to @a elevations as int16_t.
+         *
+         * record.elevations is cleared. DEM elevations are always in
+         * the range of int16_t, so this halves the size of the decoded
+         * values. Both vectors keep their capacity between calls.
+         *
+         * @return false if there are no more records of type B.
+         */
+        bool next_record_b(RecordB& record, std::vector<int16_t>& elevations);
+
+        /**
+         * @brief Reads the next record of type B, but only decodes the
+         *  elevations in rows [first_row, first_row + row_count).
+         *
+         * Rows are numbered from 1, as in RecordB::row. The row and rows
+         * members of the result are adjusted to the rows that were
+         * actually read. Blocks outside the range are skipped.
+         */
+        [[nodiscard]]
+        std::optional<RecordB> next_record_b(int first_row, int row_count);
+
+        /**
+         * @brief Returns the position and header values of the next
+         *  record of type B without reading it.
+         */
+        [[nodiscard]]
+        std::optional<RecordBInfo> peek_record_b();
+
+        /**
+         * @brief Moves past the next record of type B without decoding it.
+         *
+         * @return false if there are no more records of type B.
+         */
+        bool skip_record_b();
+
+        /**
+         * @brief Returns the index of the records of type B.
+         *
+         * The index is built the first time this function is called,
+         * unless it has been assigned with set_index. Building it
+         * doesn't change which record next_record_b returns.
+         *
+         * Building the index requires seeking. Readers opened with
+         * StreamAccess::SINGLE_PASS throw DemException unless the
+         * index has been assigned with set_index.
+         */
+        const DemIndex& index();
+
+        /**
+         * @brief Use @a index rather than scanning the file, e.g. an
+         *  index that was previously saved with save_dem_index.
+         *
+         * Throws DemException if the index's source doesn't match the
+         * reader's input, i.e. the size differs, or both have
+         * modification times and they differ. Inputs of unknown size,
+         * e.g. pipes, accept any index.
+         */
+        void set_index(DemIndex index);
+
+        /**
+         * @brief Reads the record of type B at position @a index in
+         *  the file.
+         *
+         * Subsequent calls to next_record_b continue with the record
+         * after this one.
+         *
+         * Throws DemException if the reader was opened with
+         * StreamAccess::SINGLE_PASS.
+         */
+        [[nodiscard]]
+        RecordB read_record_b(size_t index);
+
+        /**
+         * @brief Moves to the record of type B containing @a column.
+         *
+         * The next call to next_record_b returns this record.
+         *
+         * Throws DemException if the reader was opened with
+         * StreamAccess::SINGLE_PASS.
+         *
+         * @return false if there is no such record.
+         */
+        bool seek_to_column(int column);
+
+        /**
+         * @brief Adds the elevations of the records of type B that are
+         *  read from now on to @a statistics.
+         *
+         * The elevations are added as they are decoded. Only the
+         * elevations that are returned are added, i.e. skipped records
+         * and rows outside the range given to next_record_b are not.
+         * Pass nullptr to stop adding elevations. The caller must keep
+         * @a statistics alive while it is in use.
+         */
+        void set_statistics(ElevationStatistics* statistics);
     private:
         void read_record_a();
 
+        [[nodiscard]]
+        bool has_more_record_b();
+
         [[nodiscard]]
         std::optional<RecordB> read_record_b();
 
         void read_record_c();
 
+        void parse_record_c();
+
+        void require_seekable() const;
+
         void move_to_first_record_b();
 
         struct Data;
@@ -0,0 +1,96 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-26.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <memory>
+#include <string>
+#include "ReadDemGrid.hpp"
+
+namespace Dem
+{
+    struct DemTileCacheStatistics
+    {
+        /// The number of requests for tiles that were in the cache,
+        /// including those that waited for another thread to read
+        /// the tile.
+        size_t hits = 0;
+        /// The number of requests that read a tile.
+        size_t misses = 0;
+        /// The number of tiles that have been removed to stay within
+        /// the memory budget.
+        size_t evictions = 0;
+        /// The number of tiles in the cache.
+        size_t tile_count = 0;
+        /// The number of bytes used by the tiles in the cache.
+        size_t memory_usage = 0;
+    };
+
+    /**
+     * @brief A thread-safe cache of grids read from DEM files, identified
+     *  by file name and window.
+     *
+     * File names are made absolute and canonical, and windows are
+     * clamped to the grid, so different requests for the same grid
+     * share a tile. The grid size of each file is read once, the first
+     * time a window other than the default is requested.
+     *
+     * When the tiles use more memory than the budget, the least recently
+     * used tiles are removed. Tiles are shared with shared_ptr, so tiles
+     * that are removed from the cache remain valid for as long as they
+     * are used elsewhere.
+     *
+     * If several threads request a tile that isn't in the cache, only
+     * one of them reads it while the others wait for the result.
+     */
+    class DemTileCache
+    {
+    public:
+        explicit DemTileCache(size_t memory_budget,
+                              GridLib::Unit vertical_unit
+                                  = GridLib::Unit::METERS);
+
+        DemTileCache(const DemTileCache&) = delete;
+
+        ~DemTileCache();
+
+        DemTileCache& operator=(const DemTileCache&) = delete;
+
+        /**
+         * @brief Returns the grid in @a window of @a file_name, reading
+         *  it if it isn't in the cache.
+         *
+         * Exceptions from reading the file are passed on to all the
+         * threads waiting for the tile, and nothing is added to the
+         * cache.
+         */
+        [[nodiscard]]
+        std::shared_ptr<const GridLib::Grid>
+        get(const std::string& file_name, const DemWindow& window = {});
+
+        /**
+         * @brief Removes all tiles from the cache.
+         *
+         * Tiles that are being read are added when they are done.
+         */
+        void clear();
+
+        [[nodiscard]]
+        size_t memory_budget() const;
+
+        /**
+         * @brief Sets the memory budget and removes tiles until the
+         *  cache is within it.
+         */
+        void set_memory_budget(size_t memory_budget);
+
+        [[nodiscard]]
+        DemTileCacheStatistics statistics() const;
+    private:
+        struct Data;
+        std::unique_ptr<Data> m_Data;
+    };
+}
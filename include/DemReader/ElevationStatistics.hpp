@@ -0,0 +1,91 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-29.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace Dem
+{
+    /**
+     * @brief Accumulates the number of voids, the minimum, maximum and
+     *  sum, and optionally a histogram of raw DEM elevations.
+     *
+     * Elevations equal to -32767 are voids and are only counted.
+     */
+    class ElevationStatistics
+    {
+    public:
+        /**
+         * @param histogram_bin_size The number of raw elevation values
+         *  in each bin of the histogram. 0 means no histogram.
+         */
+        explicit ElevationStatistics(unsigned histogram_bin_size = 0);
+
+        void add(const int16_t* values, size_t count);
+
+        /**
+         * @brief Adds @a values, which must be in the range of int16_t.
+         */
+        void add(const int32_t* values, size_t count);
+
+        /**
+         * @brief Adds the values that have been added to @a other.
+         *
+         * The histograms must have the same bin size.
+         */
+        void add(const ElevationStatistics& other);
+
+        void clear();
+
+        /**
+         * @brief Returns the number of elevations that aren't voids.
+         */
+        [[nodiscard]]
+        uint64_t count() const;
+
+        [[nodiscard]]
+        uint64_t void_count() const;
+
+        [[nodiscard]]
+        std::optional<int16_t> min() const;
+
+        [[nodiscard]]
+        std::optional<int16_t> max() const;
+
+        [[nodiscard]]
+        int64_t sum() const;
+
+        [[nodiscard]]
+        std::optional<double> mean() const;
+
+        [[nodiscard]]
+        unsigned histogram_bin_size() const;
+
+        /**
+         * @brief Returns the number of elevations in each bin.
+         *
+         * Bin i counts the values in [-32768 + i * histogram_bin_size(),
+         * -32768 + (i + 1) * histogram_bin_size()). The vector is empty
+         * if the bin size is 0.
+         */
+        [[nodiscard]]
+        const std::vector<uint64_t>& histogram() const;
+    private:
+        template <typename T>
+        void add_values(const T* values, size_t count);
+
+        uint64_t m_Count = 0;
+        uint64_t m_VoidCount = 0;
+        int32_t m_Min = INT32_MAX;
+        int32_t m_Max = INT32_MIN;
+        int64_t m_Sum = 0;
+        unsigned m_HistogramBinSize = 0;
+        std::vector<uint64_t> m_Histogram;
+    };
+}
@@ -0,0 +1,33 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-06.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstdint>
+#include <Chorasmia/Array2D.hpp>
+#include <Chorasmia/ArrayView2D.hpp>
+
+namespace Dem
+{
+    /**
+     * @brief Returns a copy of @a values where the rows go from north to
+     *  south and the columns from west to east.
+     *
+     * The grids read from DEM files have one row per profile, which
+     * means their rows go from west to east and their columns from
+     * south to north. Image formats and most raster code expect the
+     * north-up layout returned by this function.
+     *
+     * The copy is done in square blocks that fit in the CPU cache.
+     */
+    [[nodiscard]]
+    Chorasmia::Array2D<double>
+    to_north_up(const Chorasmia::ArrayView2D<double>& values);
+
+    [[nodiscard]]
+    Chorasmia::Array2D<int16_t>
+    to_north_up(const Chorasmia::ArrayView2D<int16_t>& values);
+}
@@ -0,0 +1,131 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-22.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ReadDemGrid.hpp"
+#include "RecordA.hpp"
+#include "RecordB.hpp"
+
+namespace Dem
+{
+    /**
+     * @brief The first eight bytes of grids written in
+     *  GridFileFormat::BINARY.
+     */
+    constexpr char BINARY_GRID_MAGIC[8] = {'D', 'E', 'M', 'G',
+                                           'R', 'I', 'D', '1'};
+
+    enum class GridFileFormat
+    {
+        /// A 32-byte header followed by the elevations as native-endian
+        /// doubles, one row after the other. The header is
+        /// BINARY_GRID_MAGIC followed by the row count and column count
+        /// as native-endian uint64_t and the unknown elevation as a
+        /// double.
+        BINARY,
+        /// A JSON object with the same members as GridLib's JSON grids:
+        /// "row_count", "column_count", "row_axis", "column_axis" and
+        /// "vertical_axis" with "resolution" and "unit",
+        /// "spherical_coords", "planar_coords" and "reference_system" if
+        /// record A has them, "rotation_angle", "unknown_elevation" and
+        /// "elevations", where the latter is an array with one array per
+        /// row. The planar coordinates are those of the south-west
+        /// corner, i.e. the first value in the last row.
+        JSON
+    };
+
+    struct NorthUpGridWriterOptions
+    {
+        /// The approximate number of bytes used for elevations. Profiles
+        /// beyond this are moved to a scratch file.
+        size_t memory_budget = 64 * 1024 * 1024;
+        /// The directory of the scratch file. The system's temporary
+        /// directory is used if it is empty.
+        std::string scratch_directory;
+    };
+
+    /**
+     * @brief Writes the profiles of a DEM file as a north-up grid, i.e.
+     *  with rows from north to south and columns from west to east,
+     *  without keeping the entire grid in memory.
+     *
+     * The profiles are the columns of the output, which means none of
+     * the rows are complete until the last profile has been added.
+     * The profiles are therefore collected in bands of consecutive
+     * profiles, and bands that don't fit within the memory budget are
+     * written to a scratch file. finish writes the output from the
+     * bands a few rows at a time.
+     *
+     * Profiles must be added in order from west to east. Elevations
+     * that aren't covered by any profile are unknown in the output.
+     */
+    class NorthUpGridWriter
+    {
+    public:
+        /**
+         * @param record_a The grid's metadata, which is written in the
+         *  header.
+         * @param vertical_unit The unit of the elevations that are
+         *  written.
+         * @param profile_count The number of profiles, i.e. columns in
+         *  the output.
+         * @param profile_length The number of elevations in each
+         *  profile, i.e. rows in the output.
+         */
+        NorthUpGridWriter(std::ostream& stream, GridFileFormat format,
+                          const RecordA& record_a,
+                          GridLib::Unit vertical_unit,
+                          size_t profile_count, size_t profile_length,
+                          const NorthUpGridWriterOptions& options = {});
+
+        NorthUpGridWriter(const NorthUpGridWriter&) = delete;
+
+        NorthUpGridWriter(NorthUpGridWriter&& rhs) noexcept;
+
+        /**
+         * @brief Removes the scratch file, if there is one.
+         */
+        ~NorthUpGridWriter();
+
+        NorthUpGridWriter& operator=(const NorthUpGridWriter&) = delete;
+
+        NorthUpGridWriter& operator=(NorthUpGridWriter&& rhs) noexcept;
+
+        /**
+         * @brief Adds the profiles in @a record, where @a elevations
+         *  are the elevations as returned by DemReader::next_record_b.
+         */
+        void add_record_b(const RecordB& record,
+                          const std::vector<int16_t>& elevations);
+
+        /**
+         * @brief Writes the grid to the stream.
+         */
+        void finish();
+    private:
+        struct Data;
+        std::unique_ptr<Data> m_Data;
+    };
+
+    class DemReader;
+
+    /**
+     * @brief Reads the grid in @a reader and writes it to @a stream as
+     *  a north-up grid in @a format, using a NorthUpGridWriter.
+     *
+     * @return false if @a progress_callback stopped the reading.
+     */
+    bool write_north_up_grid(DemReader& reader, std::ostream& stream,
+                             GridFileFormat format,
+                             GridLib::Unit vertical_unit,
+                             const NorthUpGridWriterOptions& options = {},
+                             const ProgressCallback& progress_callback = {});
+}
@@ -0,0 +1,49 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-01.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstdint>
+#include <Chorasmia/Array2D.hpp>
+#include <Chorasmia/ArrayView2D.hpp>
+
+namespace Dem
+{
+    /**
+     * @brief Decides how make_overview combines each 2x2 block of raw
+     *  elevations into one.
+     *
+     * Unknown elevations are ignored by all reducers except NEAREST, and
+     * a block where all the elevations are unknown becomes unknown.
+     */
+    enum class OverviewReducer
+    {
+        /// The mean of the known elevations, rounded to the nearest
+        /// integer (ties to even).
+        MEAN,
+        /// The lowest known elevation.
+        MIN,
+        /// The highest known elevation.
+        MAX,
+        /// The first elevation in the block, i.e. the south-west one.
+        NEAREST
+    };
+
+    /**
+     * @brief Returns a grid with half as many rows and columns as
+     *  @a values, rounded up, where each value is the reduction of a 2x2
+     *  block in @a values.
+     *
+     * If the number of rows or columns is odd, the blocks at the end
+     * only have the values in the last row or column. Repeated calls
+     * produce overviews at 2x, 4x, 8x etc. of the original resolution,
+     * each computed from the previous one.
+     */
+    [[nodiscard]]
+    Chorasmia::Array2D<int16_t>
+    make_overview(const Chorasmia::ArrayView2D<int16_t>& values,
+                  OverviewReducer reducer);
+}
@@ -0,0 +1,88 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-28.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include "RecordA.hpp"
+#include "RecordC.hpp"
+
+namespace Dem
+{
+    /**
+     * @brief The metadata of a DEM file, as returned by probe_dem.
+     */
+    struct DemProbe
+    {
+        RecordA record_a;
+        std::optional<RecordC> record_c;
+        uint64_t file_size = 0;
+        /// The number of profiles (records of type B), i.e. the number
+        /// of rows in the grid returned by read_dem_grid.
+        size_t profile_count = 0;
+        /// The number of elevations in each profile, i.e. the number of
+        /// columns in the grid returned by read_dem_grid. It is 0 if the
+        /// file size shows that the profiles have different lengths,
+        /// which is common in files with UTM coordinates.
+        size_t profile_length = 0;
+    };
+
+    /**
+     * @brief Reads the metadata of @a file_name without reading the
+     *  elevations.
+     *
+     * Only record A, the header of the first record of type B and
+     * record C are read. The profile length is taken from the first
+     * profile and checked against the file size.
+     *
+     * Compressed files are read from the start, and as reaching record
+     * C would mean decompressing the entire file, it is left out.
+     */
+    [[nodiscard]]
+    DemProbe probe_dem(const std::string& file_name);
+
+    /**
+     * @brief The result of probing one of the files given to probe_dems.
+     */
+    struct DemProbeResult
+    {
+        std::optional<DemProbe> probe;
+        /// The error message if the file couldn't be probed.
+        std::string error;
+    };
+
+    using DemProbeCallback = std::function<bool (size_t file_index,
+                                                 DemProbeResult&& result)>;
+
+    /**
+     * @brief Probes @a file_names with @a thread_count threads.
+     *
+     * @a callback is called once for every file, in the order the files
+     * are completed, but never by more than one thread at a time. Files
+     * that can't be probed don't stop the others, their errors are
+     * passed to @a callback instead.
+     *
+     * @param thread_count The number of threads. 0 means the number of
+     *  hardware threads.
+     * @return false if @a callback stopped the probing.
+     */
+    bool probe_dems(const std::vector<std::string>& file_names,
+                    unsigned thread_count,
+                    const DemProbeCallback& callback);
+
+    /**
+     * @brief Probes @a file_names with @a thread_count threads and
+     *  returns the results in the same order as the files.
+     */
+    [[nodiscard]]
+    std::vector<DemProbeResult>
+    probe_dems(const std::vector<std::string>& file_names,
+               unsigned thread_count = 0);
+}
@@ -6,16 +6,222 @@
 // License text is included with the source distribution.
 //****************************************************************************
 #pragma once
+#include <cstdint>
 #include <functional>
+#include <string>
 #include <vector>
 #include <GridLib/Grid.hpp>
+#include "CompactGrid.hpp"
 
 namespace Dem
 {
     using ProgressCallback = std::function<bool (size_t, size_t)>;
 
+    /**
+     * @brief A rectangular part of the grid in a DEM file.
+     *
+     * Rows and columns have the same meaning as in the grids returned by
+     * read_dem_grid and GridLib::Grid::subgrid, i.e. each row in the
+     * grid is a profile (a record of type B) in the DEM file. Counts
+     * that extend beyond the grid are adjusted automatically.
+     */
+    struct DemWindow
+    {
+        size_t row = 0;
+        size_t column = 0;
+        size_t row_count = SIZE_MAX;
+        size_t column_count = SIZE_MAX;
+    };
+
+    class DemReader;
+    class ElevationStatistics;
+
     GridLib::Grid
     read_dem_grid(std::istream& stream,
                   GridLib::Unit vertical_unit,
                   const ProgressCallback& progress_callback = {});
+
+    /**
+     * @brief Reads the grid in the DEM file @a file_name.
+     *
+     * The file is memory mapped, which avoids copying its contents into
+     * intermediate buffers.
+     */
+    GridLib::Grid
+    read_dem_grid(const std::string& file_name,
+                  GridLib::Unit vertical_unit,
+                  const ProgressCallback& progress_callback = {});
+
+    /**
+     * @brief Reads the grid in the DEM file @a file_name using
+     *  @a thread_count threads.
+     *
+     * The offsets of the records of type B are determined first, then
+     * the records are decoded in parallel directly into the grid. The
+     * result is identical to what the other overloads produce.
+     *
+     * @param thread_count The number of threads, including the calling
+     *  thread. If it is 0, the number of hardware threads is used.
+     * @param progress_callback Is called with the number of decoded
+     *  records and the total number of records. It can be called from
+     *  any of the threads, but never from more than one at a time.
+     */
+    GridLib::Grid
+    read_dem_grid(const std::string& file_name,
+                  GridLib::Unit vertical_unit,
+                  unsigned thread_count,
+                  const ProgressCallback& progress_callback = {});
+
+    /**
+     * @brief Same as the previous function, but also adds the raw
+     *  elevations to @a statistics as they are decoded.
+     *
+     * Each thread accumulates its own statistics, they are added to
+     * @a statistics as the threads finish.
+     */
+    GridLib::Grid
+    read_dem_grid(const std::string& file_name,
+                  GridLib::Unit vertical_unit,
+                  unsigned thread_count,
+                  ElevationStatistics& statistics,
+                  const ProgressCallback& progress_callback = {});
+
+    GridLib::Grid
+    read_dem_grid(DemReader& reader,
+                  GridLib::Unit vertical_unit,
+                  const ProgressCallback& progress_callback = {});
+
+    /**
+     * @brief Reads the part of the grid in @a file_name that is inside
+     *  @a window.
+     *
+     * Profiles outside the window are skipped without being decoded, and
+     * inside each profile only the blocks with elevations in the window
+     * are decoded. The planar coordinates of the grid are moved to the
+     * window's corner.
+     */
+    GridLib::Grid
+    read_dem_grid(const std::string& file_name,
+                  GridLib::Unit vertical_unit,
+                  const DemWindow& window,
+                  const ProgressCallback& progress_callback = {});
+
+    GridLib::Grid
+    read_dem_grid(DemReader& reader,
+                  GridLib::Unit vertical_unit,
+                  const DemWindow& window,
+                  const ProgressCallback& progress_callback = {});
+
+    /**
+     * @brief Reads the grid in @a file_name without converting the
+     *  elevations to double.
+     *
+     * The factor of the result converts the raw values to
+     * @a vertical_unit. Apart from the type of the elevations, the
+     * result is the same as read_dem_grid would produce.
+     *
+     * @param thread_count The number of threads, including the calling
+     *  thread. If it is 0, the number of hardware threads is used.
+     */
+    CompactGrid
+    read_compact_dem_grid(const std::string& file_name,
+                          GridLib::Unit vertical_unit,
+                          unsigned thread_count = 1,
+                          const ProgressCallback& progress_callback = {});
+
+    /**
+     * @brief Same as the previous function, but also adds the raw
+     *  elevations to @a statistics as they are decoded.
+     */
+    CompactGrid
+    read_compact_dem_grid(const std::string& file_name,
+                          GridLib::Unit vertical_unit,
+                          unsigned thread_count,
+                          ElevationStatistics& statistics,
+                          const ProgressCallback& progress_callback = {});
+
+    CompactGrid
+    read_compact_dem_grid(DemReader& reader,
+                          GridLib::Unit vertical_unit,
+                          const ProgressCallback& progress_callback = {});
+
+    /**
+     * @brief Reads the part of the grid in @a file_name that is inside
+     *  @a window without converting the elevations to double.
+     *
+     * Only the profiles and blocks with elevations in the window are
+     * decoded, as with read_dem_grid.
+     */
+    CompactGrid
+    read_compact_dem_grid(const std::string& file_name,
+                          GridLib::Unit vertical_unit,
+                          const DemWindow& window,
+                          const ProgressCallback& progress_callback = {});
+
+    CompactGrid
+    read_compact_dem_grid(DemReader& reader,
+                          GridLib::Unit vertical_unit,
+                          const DemWindow& window,
+                          const ProgressCallback& progress_callback = {});
+
+    struct ReadDemGridsOptions
+    {
+        GridLib::Unit vertical_unit = GridLib::Unit::METERS;
+        /// The number of threads, including the calling thread. If it
+        /// is 0, the number of hardware threads is used.
+        unsigned thread_count = 0;
+        /// The maximum number of bytes used by the grids that are being
+        /// read at the same time. A file is only opened when its grid
+        /// fits within the budget, or when no other file is being read.
+        /// 0 means there is no limit.
+        size_t memory_budget = 0;
+    };
+
+    /**
+     * @brief Receives the progress of file number @a file_index, the
+     *  arguments are otherwise the same as for ProgressCallback.
+     */
+    using FileProgressCallback = std::function<bool (size_t file_index,
+                                                     size_t step,
+                                                     size_t steps)>;
+
+    /**
+     * @brief Receives the grid of file number @a file_index when it
+     *  has been read. Returning false stops the reading.
+     */
+    using GridCallback = std::function<bool (size_t file_index,
+                                             GridLib::Grid&& grid)>;
+
+    /**
+     * @brief Reads the grids in @a file_names with a single pool of
+     *  threads.
+     *
+     * Several files are read at the same time, and the profiles of each
+     * file are divided between the threads. @a grid_callback is called
+     * once for every file, in the order the files are completed, and the
+     * memory of the grid is no longer counted against the budget when
+     * it returns. Neither callback is called by more than one thread at
+     * a time.
+     *
+     * If a file can't be read, the reading stops and the error is
+     * thrown after all the threads have finished.
+     *
+     * @return false if one of the callbacks stopped the reading.
+     */
+    bool read_dem_grids(const std::vector<std::string>& file_names,
+                        const ReadDemGridsOptions& options,
+                        const GridCallback& grid_callback,
+                        const FileProgressCallback& progress_callback = {});
+
+    /**
+     * @brief Reads the grids in @a file_names with a single pool of
+     *  threads and returns them in the same order as the files.
+     *
+     * The memory budget in @a options only limits the number of files
+     * that are read at the same time as all the grids are kept.
+     */
+    std::vector<GridLib::Grid>
+    read_dem_grids(const std::vector<std::string>& file_names,
+                   const ReadDemGridsOptions& options = {},
+                   const FileProgressCallback& progress_callback = {});
 }
@@ -7,12 +7,25 @@
 //****************************************************************************
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <vector>
 
 namespace Dem
 {
+    /**
+     * @brief All records in DEM files are padded to a multiple of
+     *  this size.
+     */
+    constexpr size_t DEM_BLOCK_SIZE = 1024;
+
+    /**
+     * @brief The size of the fields that precede the elevations in a
+     *  record of type B.
+     */
+    constexpr size_t RECORD_B_HEADER_SIZE = 4 * 6 + 5 * 24;
+
     struct RecordB
     {
         int16_t row;
@@ -27,8 +40,71 @@ namespace Dem
         std::vector<int32_t> elevations;
     };
 
+    class ElevationStatistics;
     class FortranReader;
 
     [[nodiscard]]
     RecordB read_record_b(FortranReader& reader);
+
+    /**
+     * @brief Reads a record of type B into @a result.
+     *
+     * The memory already allocated for result.elevations is reused, which
+     * means that reading a sequence of records into the same RecordB
+     * doesn't allocate memory once the largest record has been read.
+     *
+     * If @a statistics isn't null, the elevations are added to it as
+     * they are decoded.
+     */
+    void read_record_b(FortranReader& reader, RecordB& result,
+                       ElevationStatistics* statistics = nullptr);
+
+    /**
+     * @brief Reads the fields that precede the elevations in a record of
+     *  type B. The elevations vector in the result is empty.
+     *
+     * Must be followed by a call to read_record_b_elevations.
+     */
+    [[nodiscard]]
+    RecordB read_record_b_header(FortranReader& reader);
+
+    /**
+     * @brief Reads the fields that precede the elevations into
+     *  @a result, leaving result.elevations unchanged.
+     */
+    void read_record_b_header(FortranReader& reader, RecordB& result);
+
+    /**
+     * @brief Decodes the elevations [first, first + count) of the record
+     *  whose header has just been read, and moves the reader to the end
+     *  of the record.
+     *
+     * Blocks that don't contain any of the requested elevations are
+     * skipped without being parsed. If @a statistics isn't null, the
+     * decoded elevations are added to it block by block, while they are
+     * still in the cache.
+     */
+    void read_record_b_elevations(FortranReader& reader,
+                                  const RecordB& header,
+                                  size_t first, size_t count,
+                                  int32_t* values,
+                                  ElevationStatistics* statistics = nullptr);
+
+    /**
+     * @brief Same as the other read_record_b_elevations, but decodes the
+     *  elevations to int16_t, which is the range DEM elevations are
+     *  required to have.
+     */
+    void read_record_b_elevations(FortranReader& reader,
+                                  const RecordB& header,
+                                  size_t first, size_t count,
+                                  int16_t* values,
+                                  ElevationStatistics* statistics = nullptr);
+
+    /**
+     * @brief Returns the number of bytes occupied by a record of type B
+     *  with @a rows x @a columns elevations.
+     */
+    [[nodiscard]]
+    size_t get_record_b_size(int16_t rows, int16_t columns);
 }
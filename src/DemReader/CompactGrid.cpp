@@ -0,0 +1,82 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-02-27.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DemReader/CompactGrid.hpp"
+
+#include "ScaleElevations.hpp"
+
+namespace Dem
+{
+    CompactGrid::CompactGrid() = default;
+
+    CompactGrid::CompactGrid(size_t rows, size_t columns)
+        : m_Values(rows * columns),
+          m_Rows(rows),
+          m_Columns(columns)
+    {}
+
+    size_t CompactGrid::row_count() const
+    {
+        return m_Rows;
+    }
+
+    size_t CompactGrid::column_count() const
+    {
+        return m_Columns;
+    }
+
+    void CompactGrid::resize(size_t rows, size_t columns)
+    {
+        m_Values.resize(rows * columns);
+        m_Rows = rows;
+        m_Columns = columns;
+    }
+
+    double CompactGrid::factor() const
+    {
+        return m_Factor;
+    }
+
+    void CompactGrid::set_factor(double factor)
+    {
+        m_Factor = factor;
+    }
+
+    Chorasmia::ArrayView2D<int16_t> CompactGrid::values() const
+    {
+        return {m_Values.data(), m_Rows, m_Columns};
+    }
+
+    Chorasmia::MutableArrayView2D<int16_t> CompactGrid::values()
+    {
+        return {m_Values.data(), m_Rows, m_Columns};
+    }
+
+    double CompactGrid::elevation(size_t row, size_t column) const
+    {
+        return m_Values[row * m_Columns + column] * m_Factor;
+    }
+
+    const GridLib::Grid& CompactGrid::metadata() const
+    {
+        return m_Metadata;
+    }
+
+    GridLib::Grid& CompactGrid::metadata()
+    {
+        return m_Metadata;
+    }
+
+    GridLib::Grid CompactGrid::to_grid() const
+    {
+        auto grid = m_Metadata;
+        grid.resize(m_Rows, m_Columns);
+        scale_elevations(m_Values.data(), m_Values.size(), m_Factor,
+                         grid.elevations().data());
+        return grid;
+    }
+}
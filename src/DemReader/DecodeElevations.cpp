@@ -0,0 +1,348 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-02-13.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DecodeElevations.hpp"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSSE3__) || defined(DEMREADER_USE_SSSE3)
+    #include <tmmintrin.h>
+    #define DEMREADER_SSSE3
+    #if defined(__SSSE3__)
+        #define DEMREADER_SSSE3_TARGET
+    #elif defined(_MSC_VER)
+        #include <intrin.h>
+        #define DEMREADER_SSSE3_TARGET
+    #else
+        #define DEMREADER_SSSE3_TARGET __attribute__((target("ssse3")))
+    #endif
+#endif
+
+namespace Dem
+{
+    namespace
+    {
+        constexpr size_t FS = ELEVATION_FIELD_SIZE;
+
+        template <typename T>
+        bool decode_field(const char* field, T& value)
+        {
+            size_t i = 0;
+            while (i < FS && field[i] == ' ')
+                ++i;
+
+            bool negative = false;
+            if (i < FS && (field[i] == '-' || field[i] == '+'))
+                negative = field[i++] == '-';
+
+            auto first = i;
+            int32_t n = 0;
+            for (; i < FS; ++i)
+            {
+                auto digit = unsigned(uint8_t(field[i]) - uint8_t('0'));
+                if (digit > 9)
+                    break;
+                n = n * 10 + int32_t(digit);
+            }
+
+            if (i == first)
+                return false;
+
+            for (; i < FS; ++i)
+            {
+                if (field[i] != ' ')
+                    return false;
+            }
+
+            if (n > 32767 + int32_t(negative))
+                return false;
+
+            value = T(negative ? -n : n);
+            return true;
+        }
+
+        template <typename T>
+        size_t decode_fields(const char* str, T* values,
+                             size_t first, size_t count)
+        {
+            for (size_t i = first; i < count; ++i)
+            {
+                if (!decode_field(str + i * FS, values[i]))
+                    return i;
+            }
+            return count;
+        }
+
+    #if defined(__AVX2__) || defined(DEMREADER_SSSE3)
+
+        /*
+         * The SIMD code below places each six character field in the
+         * upper six bytes of an eight byte lane. Digits are converted to
+         * their values while spaces, minus signs and the two padding bytes
+         * become zeros. The value of each field is then computed with
+         * pmaddubsw, pmaddwd, packssdw and a final pmaddwd.
+         *
+         * Validation is done on bit masks with one bit per character:
+         * the digits must be a contiguous run at the end of the field,
+         * optionally preceded by a minus, with only spaces before that.
+         * Fields that fail this test are passed to decode_field, which
+         * accepts the less common formats and reports actual errors.
+         */
+        inline bool is_valid(unsigned digits, unsigned spaces,
+                             unsigned minuses)
+        {
+            auto lowest = digits & (0u - digits);
+            return digits != 0
+                   && digits + lowest == 0x40u
+                   && (minuses == 0 || minuses == lowest >> 1u)
+                   && (digits | spaces | minuses) == 0x3Fu;
+        }
+
+        template <typename T>
+        bool finish_field(const char* str, T* values,
+                          size_t index, int32_t value,
+                          unsigned digits, unsigned spaces,
+                          unsigned minuses)
+        {
+            if (is_valid(digits, spaces, minuses)
+                && value <= 32767 + int32_t(minuses != 0))
+            {
+                values[index] = T(minuses ? -value : value);
+                return true;
+            }
+            return decode_field(str + index * FS, values[index]);
+        }
+
+    #endif
+
+    #if defined(__AVX2__)
+
+        template <typename T>
+        bool decode_elevations_simd(const char* str, size_t size,
+                                    T* values, size_t count,
+                                    size_t& index)
+        {
+            const auto shuffle = _mm256_setr_epi8(
+                -1, -1, 0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11,
+                -1, -1, 0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11);
+            const auto zero = _mm256_set1_epi8('0');
+            const auto nine = _mm256_set1_epi8(9);
+            const auto space = _mm256_set1_epi8(' ');
+            const auto minus = _mm256_set1_epi8('-');
+            const auto mul10 = _mm256_set1_epi16(0x010A);
+            const auto mul100 = _mm256_set1_epi32(0x00010064);
+            const auto mul10000 = _mm256_set1_epi32(0x00012710);
+
+            constexpr size_t FIELDS = 8;
+            // The last of the four loads reads 16 bytes from field 6.
+            constexpr size_t BYTES_READ = 6 * FS + 16;
+
+            size_t i = 0;
+            for (; i + FIELDS <= count && i * FS + BYTES_READ <= size;
+                   i += FIELDS)
+            {
+                auto p = str + i * FS;
+                auto load = [&](size_t offset)
+                {
+                    auto lo = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(p + offset));
+                    auto hi = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(p + offset + 2 * FS));
+                    auto v = _mm256_inserti128_si256(
+                        _mm256_castsi128_si256(lo), hi, 1);
+                    return _mm256_shuffle_epi8(v, shuffle);
+                };
+
+                __m256i chars[2] = {load(0), load(4 * FS)};
+                __m256i numbers[2];
+                unsigned masks[2][3];
+                for (int k = 0; k < 2; ++k)
+                {
+                    auto c = chars[k];
+                    auto d = _mm256_sub_epi8(c, zero);
+                    auto isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, nine),
+                                                     d);
+                    d = _mm256_and_si256(d, isDigit);
+                    d = _mm256_maddubs_epi16(d, mul10);
+                    numbers[k] = _mm256_madd_epi16(d, mul100);
+                    masks[k][0] = unsigned(_mm256_movemask_epi8(isDigit));
+                    masks[k][1] = unsigned(_mm256_movemask_epi8(
+                        _mm256_cmpeq_epi8(c, space)));
+                    masks[k][2] = unsigned(_mm256_movemask_epi8(
+                        _mm256_cmpeq_epi8(c, minus)));
+                }
+
+                auto packed = _mm256_packs_epi32(numbers[0], numbers[1]);
+                auto result = _mm256_madd_epi16(packed, mul10000);
+                result = _mm256_permute4x64_epi64(result, 0xD8);
+                alignas(32) int32_t n[FIELDS];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(n), result);
+
+                for (size_t j = 0; j < FIELDS; ++j)
+                {
+                    auto& m = masks[j / 4];
+                    auto shift = unsigned(2 + 8 * (j % 4));
+                    if (!finish_field(str, values, i + j, n[j],
+                                      (m[0] >> shift) & 0x3Fu,
+                                      (m[1] >> shift) & 0x3Fu,
+                                      (m[2] >> shift) & 0x3Fu))
+                    {
+                        index = i + j;
+                        return false;
+                    }
+                }
+            }
+            index = i;
+            return true;
+        }
+
+    #elif defined(DEMREADER_SSSE3)
+
+        /*
+         * Unless the library itself is compiled for SSSE3, only
+         * decode_elevations_ssse3 uses SSSE3 instructions, and it is
+         * only called if the CPU supports them.
+         */
+        bool detect_ssse3()
+        {
+        #if defined(__SSSE3__)
+            return true;
+        #elif defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 9)) != 0;
+        #else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("ssse3") != 0;
+        #endif
+        }
+
+        bool has_ssse3()
+        {
+            static const bool result = detect_ssse3();
+            return result;
+        }
+
+        template <typename T>
+        DEMREADER_SSSE3_TARGET
+        bool decode_elevations_ssse3(const char* str, size_t size,
+                                     T* values, size_t count,
+                                     size_t& index)
+        {
+            const auto shuffle = _mm_setr_epi8(
+                -1, -1, 0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11);
+            const auto zero = _mm_set1_epi8('0');
+            const auto nine = _mm_set1_epi8(9);
+            const auto space = _mm_set1_epi8(' ');
+            const auto minus = _mm_set1_epi8('-');
+            const auto mul10 = _mm_set1_epi16(0x010A);
+            const auto mul100 = _mm_set1_epi32(0x00010064);
+            const auto mul10000 = _mm_set1_epi32(0x00012710);
+
+            constexpr size_t FIELDS = 4;
+            // The second load reads 16 bytes from field 2.
+            constexpr size_t BYTES_READ = 2 * FS + 16;
+
+            size_t i = 0;
+            for (; i + FIELDS <= count && i * FS + BYTES_READ <= size;
+                   i += FIELDS)
+            {
+                auto p = str + i * FS;
+                __m128i numbers[2];
+                unsigned masks[2][3];
+                for (int k = 0; k < 2; ++k)
+                {
+                    auto c = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(p + k * 2 * FS));
+                    c = _mm_shuffle_epi8(c, shuffle);
+                    auto d = _mm_sub_epi8(c, zero);
+                    auto isDigit = _mm_cmpeq_epi8(_mm_min_epu8(d, nine), d);
+                    d = _mm_and_si128(d, isDigit);
+                    d = _mm_maddubs_epi16(d, mul10);
+                    numbers[k] = _mm_madd_epi16(d, mul100);
+                    masks[k][0] = unsigned(_mm_movemask_epi8(isDigit));
+                    masks[k][1] = unsigned(_mm_movemask_epi8(
+                        _mm_cmpeq_epi8(c, space)));
+                    masks[k][2] = unsigned(_mm_movemask_epi8(
+                        _mm_cmpeq_epi8(c, minus)));
+                }
+
+                auto packed = _mm_packs_epi32(numbers[0], numbers[1]);
+                auto result = _mm_madd_epi16(packed, mul10000);
+                alignas(16) int32_t n[FIELDS];
+                _mm_store_si128(reinterpret_cast<__m128i*>(n), result);
+
+                for (size_t j = 0; j < FIELDS; ++j)
+                {
+                    auto& m = masks[j / 2];
+                    auto shift = unsigned(2 + 8 * (j % 2));
+                    if (!finish_field(str, values, i + j, n[j],
+                                      (m[0] >> shift) & 0x3Fu,
+                                      (m[1] >> shift) & 0x3Fu,
+                                      (m[2] >> shift) & 0x3Fu))
+                    {
+                        index = i + j;
+                        return false;
+                    }
+                }
+            }
+            index = i;
+            return true;
+        }
+
+        template <typename T>
+        bool decode_elevations_simd(const char* str, size_t size,
+                                    T* values, size_t count,
+                                    size_t& index)
+        {
+            if (has_ssse3())
+                return decode_elevations_ssse3(str, size, values, count, index);
+            index = 0;
+            return true;
+        }
+
+    #else
+
+        template <typename T>
+        bool decode_elevations_simd(const char*, size_t,
+                                    T*, size_t, size_t& index)
+        {
+            index = 0;
+            return true;
+        }
+
+    #endif
+
+        template <typename T>
+        size_t decode_elevations_impl(std::string_view str,
+                                      T* values, size_t count)
+        {
+            if (str.size() < count * FS)
+                count = str.size() / FS;
+
+            size_t i;
+            if (!decode_elevations_simd(str.data(), str.size(),
+                                        values, count, i))
+            {
+                return i;
+            }
+            return decode_fields(str.data(), values, i, count);
+        }
+    }
+
+    size_t decode_elevations(std::string_view str,
+                             int32_t* values, size_t count)
+    {
+        return decode_elevations_impl(str, values, count);
+    }
+
+    size_t decode_elevations(std::string_view str,
+                             int16_t* values, size_t count)
+    {
+        return decode_elevations_impl(str, values, count);
+    }
+}
@@ -0,0 +1,32 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-02-13.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+namespace Dem
+{
+    constexpr size_t ELEVATION_FIELD_SIZE = 6;
+
+    /**
+     * @brief Decodes @a count consecutive six character integer fields
+     *  (Fortran I6) in @a str and writes them to @a values.
+     *
+     * Fields are normally right-justified, but leading and trailing
+     * spaces are accepted, as is a leading + or -. The values must be
+     * within the range of int16_t.
+     *
+     * @return The number of fields that were decoded. A value less than
+     *  @a count is the index of the first malformed field.
+     */
+    size_t decode_elevations(std::string_view str,
+                             int32_t* values, size_t count);
+
+    size_t decode_elevations(std::string_view str,
+                             int16_t* values, size_t count);
+}
@@ -0,0 +1,181 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-20.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DecompressStreamBuf.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <zlib.h>
+#ifdef DEMREADER_USE_ZSTD
+    #include <zstd.h>
+#endif
+#include "DemReader/DemException.hpp"
+
+namespace Dem
+{
+    Compression detect_compression(const char* data, size_t size)
+    {
+        if (size >= 2 && std::memcmp(data, "\x1F\x8B", 2) == 0)
+            return Compression::GZIP;
+        if (size >= 4 && std::memcmp(data, "\x28\xB5\x2F\xFD", 4) == 0)
+            return Compression::ZSTD;
+        return Compression::NONE;
+    }
+
+    bool is_supported(Compression compression)
+    {
+    #ifdef DEMREADER_USE_ZSTD
+        return true;
+    #else
+        return compression != Compression::ZSTD;
+    #endif
+    }
+
+    /**
+     * @brief The state of the gzip or zstd decompressor.
+     *
+     * decode consumes input from [in, in_end) and writes output to
+     * [out, out_end), advancing all pointers it uses. It returns true
+     * when the end of the compressed data has been reached.
+     */
+    struct DecompressStreamBuf::Decoder
+    {
+        explicit Decoder(Compression compression)
+            : compression(compression)
+        {
+            if (compression == Compression::GZIP)
+            {
+                // 32 makes zlib detect the gzip header.
+                if (inflateInit2(&zstream, 15 + 32) != Z_OK)
+                    DEM_THROW("Unable to initialize zlib.");
+            }
+        #ifdef DEMREADER_USE_ZSTD
+            else if (compression == Compression::ZSTD)
+            {
+                dstream = ZSTD_createDStream();
+                if (!dstream)
+                    DEM_THROW("Unable to initialize zstd.");
+            }
+        #endif
+            else
+            {
+                DEM_THROW("Unsupported compression format.");
+            }
+        }
+
+        ~Decoder()
+        {
+            if (compression == Compression::GZIP)
+                inflateEnd(&zstream);
+        #ifdef DEMREADER_USE_ZSTD
+            else if (dstream)
+                ZSTD_freeDStream(dstream);
+        #endif
+        }
+
+        bool decode(const char*& in, const char* in_end,
+                    char*& out, char* out_end)
+        {
+        #ifdef DEMREADER_USE_ZSTD
+            if (compression == Compression::ZSTD)
+            {
+                ZSTD_inBuffer input = {in, size_t(in_end - in), 0};
+                ZSTD_outBuffer output = {out, size_t(out_end - out), 0};
+                auto result = ZSTD_decompressStream(dstream, &output, &input);
+                if (ZSTD_isError(result))
+                {
+                    DEM_THROW_STRING(std::string("zstd: ")
+                                     + ZSTD_getErrorName(result));
+                }
+                in += input.pos;
+                out += output.pos;
+                return result == 0;
+            }
+        #endif
+
+            zstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+            zstream.avail_in = uInt(in_end - in);
+            zstream.next_out = reinterpret_cast<Bytef*>(out);
+            zstream.avail_out = uInt(out_end - out);
+            auto result = inflate(&zstream, Z_NO_FLUSH);
+            in = in_end - zstream.avail_in;
+            out = out_end - zstream.avail_out;
+            if (result == Z_STREAM_END)
+            {
+                // Concatenated gzip members form a single file.
+                inflateReset(&zstream);
+                return true;
+            }
+            if (result != Z_OK && result != Z_BUF_ERROR)
+            {
+                DEM_THROW_STRING(std::string("zlib: ")
+                                 + (zstream.msg ? zstream.msg
+                                                : "invalid data"));
+            }
+            return false;
+        }
+
+        Compression compression;
+        z_stream zstream = {};
+    #ifdef DEMREADER_USE_ZSTD
+        ZSTD_DStream* dstream = nullptr;
+    #endif
+    };
+
+    DecompressStreamBuf::DecompressStreamBuf(std::istream& source,
+                                             Compression compression,
+                                             std::string_view prefix,
+                                             size_t buffer_size)
+        : m_Source(source),
+          m_Decoder(std::make_unique<Decoder>(compression)),
+          m_Input(std::max({buffer_size, prefix.size(), size_t(1024)})),
+          m_Output(std::max<size_t>(buffer_size, 1024))
+    {
+        std::copy(prefix.begin(), prefix.end(), m_Input.begin());
+        m_InputBegin = m_Input.data();
+        m_InputEnd = m_InputBegin + prefix.size();
+    }
+
+    DecompressStreamBuf::~DecompressStreamBuf() = default;
+
+    DecompressStreamBuf::int_type DecompressStreamBuf::underflow()
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+
+        auto out = m_Output.data();
+        auto out_end = out + m_Output.size();
+        // Decompressed data can lag far behind the input, keep going
+        // until at least one byte has been produced.
+        while (out == m_Output.data())
+        {
+            if (m_InputBegin == m_InputEnd && !fill_input())
+            {
+                if (!m_Finished)
+                    DEM_THROW("Compressed data ends prematurely.");
+                return traits_type::eof();
+            }
+            m_Finished = m_Decoder->decode(m_InputBegin, m_InputEnd,
+                                           out, out_end);
+        }
+
+        setg(m_Output.data(), m_Output.data(), out);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    bool DecompressStreamBuf::fill_input()
+    {
+        if (!m_Source)
+            return false;
+        m_Source.read(m_Input.data(), std::streamsize(m_Input.size()));
+        auto size = size_t(m_Source.gcount());
+        m_InputBegin = m_Input.data();
+        m_InputEnd = m_InputBegin + size;
+        return size != 0;
+    }
+}
@@ -0,0 +1,79 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-20.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string_view>
+#include <vector>
+
+namespace Dem
+{
+    enum class Compression
+    {
+        NONE,
+        GZIP,
+        ZSTD
+    };
+
+    /**
+     * @brief Determines the compression format from the first bytes
+     *  of a file.
+     */
+    [[nodiscard]]
+    Compression detect_compression(const char* data, size_t size);
+
+    /**
+     * @brief Returns whether the library was built with support for
+     *  @a compression.
+     */
+    [[nodiscard]]
+    bool is_supported(Compression compression);
+
+    /**
+     * @brief A stream buffer that decompresses the data it reads from
+     *  another stream.
+     *
+     * The stream can't seek, and tellg returns -1 like it does for
+     * pipes.
+     */
+    class DecompressStreamBuf : public std::streambuf
+    {
+    public:
+        /**
+         * @param prefix The compressed data that has already been read
+         *  from @a source, e.g. to detect the compression format. It is
+         *  decompressed before the data in @a source.
+         */
+        DecompressStreamBuf(std::istream& source, Compression compression,
+                            std::string_view prefix = {},
+                            size_t buffer_size = 256 * 1024);
+
+        DecompressStreamBuf(const DecompressStreamBuf&) = delete;
+
+        ~DecompressStreamBuf() override;
+
+        DecompressStreamBuf&
+        operator=(const DecompressStreamBuf&) = delete;
+    protected:
+        int_type underflow() override;
+    private:
+        struct Decoder;
+
+        bool fill_input();
+
+        std::istream& m_Source;
+        std::unique_ptr<Decoder> m_Decoder;
+        std::vector<char> m_Input;
+        std::vector<char> m_Output;
+        /// The unconsumed part of m_Input.
+        const char* m_InputBegin = nullptr;
+        const char* m_InputEnd = nullptr;
+        bool m_Finished = false;
+    };
+}
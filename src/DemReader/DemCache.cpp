@@ -0,0 +1,480 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-24.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DemReader/DemCache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include "DemReader/DemException.hpp"
+#include "DemReader/DemReader.hpp"
+#include "DemReader/ReadDemGrid.hpp"
+#include "GridMetadata.hpp"
+#include "MemoryMappedFile.hpp"
+#include "ScaleElevations.hpp"
+
+namespace Dem
+{
+    namespace
+    {
+        constexpr char CACHE_MAGIC[8] = {'D', 'E', 'M', 'C',
+                                         'A', 'C', 'H', 'E'};
+        constexpr uint32_t CACHE_BYTE_ORDER = 0x01020304;
+        constexpr uint32_t CACHE_VERSION = 1;
+        /// The elevations start at a multiple of this offset.
+        constexpr uint64_t CACHE_ALIGNMENT = 64;
+
+        enum CacheField : uint32_t
+        {
+            LONGITUDE = 1u << 0u,
+            LATITUDE = 1u << 1u,
+            CORNER = 1u << 2u,
+            REF_SYS = 1u << 3u,
+            REF_SYS_ZONE = 1u << 4u,
+            HORIZONTAL_UNIT = 1u << 5u,
+            VERTICAL_UNIT = 1u << 6u,
+            HORIZONTAL_DATUM = 1u << 7u,
+            VERTICAL_DATUM = 1u << 8u,
+            X_RESOLUTION = 1u << 9u,
+            Y_RESOLUTION = 1u << 10u,
+            Z_RESOLUTION = 1u << 11u,
+            ROTATION_ANGLE = 1u << 12u
+        };
+
+        /**
+         * @brief The first bytes of a cache file. All values are in
+         *  the byte order of the machine that wrote the file.
+         */
+        struct CacheHeader
+        {
+            char magic[8];
+            uint32_t byte_order;
+            uint32_t version;
+            uint64_t source_size;
+            int64_t source_time;
+            uint64_t values_offset;
+            uint32_t row_count;
+            uint32_t column_count;
+            double easting;
+            double northing;
+            double rotation_angle;
+            float longitude_second;
+            float latitude_second;
+            float x_resolution;
+            float y_resolution;
+            float z_resolution;
+            uint32_t fields;
+            int16_t longitude_degree;
+            int16_t longitude_minute;
+            int16_t latitude_degree;
+            int16_t latitude_minute;
+            int16_t ref_sys;
+            int16_t ref_sys_zone;
+            int16_t horizontal_unit;
+            int16_t vertical_unit;
+            int8_t horizontal_datum;
+            int8_t vertical_datum;
+            int8_t padding[6];
+        };
+
+        static_assert(sizeof(CacheHeader) == 120);
+
+        template <typename T, typename U>
+        void set_field(uint32_t& fields, CacheField field, T& dst,
+                       const std::optional<U>& src)
+        {
+            if (src)
+            {
+                fields |= field;
+                dst = T(*src);
+            }
+        }
+
+        template <typename T, typename U>
+        void get_field(uint32_t fields, CacheField field,
+                       std::optional<T>& dst, U src)
+        {
+            if (fields & field)
+                dst = T(src);
+        }
+
+        /**
+         * @brief Returns a unique name in the same directory as
+         *  @a cache_file_name, which means concurrent writers of the
+         *  same cache never share a temporary file, and the rename
+         *  never crosses file systems.
+         */
+        std::string make_temp_file_name(const std::string& cache_file_name)
+        {
+            std::random_device device;
+            std::uniform_int_distribution<uint64_t> distribution;
+            char suffix[32];
+            snprintf(suffix, sizeof(suffix), ".%016llx.tmp",
+                     static_cast<unsigned long long>(distribution(device)));
+            return cache_file_name + suffix;
+        }
+
+        CacheHeader make_header(const RecordA& a,
+                                const Chorasmia::ArrayView2D<int16_t>& values,
+                                const DemCacheSource& source)
+        {
+            CacheHeader header = {};
+            std::copy(std::begin(CACHE_MAGIC), std::end(CACHE_MAGIC),
+                      header.magic);
+            header.byte_order = CACHE_BYTE_ORDER;
+            header.version = CACHE_VERSION;
+            header.source_size = source.size;
+            header.source_time = source.modification_time;
+            header.values_offset = (sizeof(CacheHeader) + CACHE_ALIGNMENT - 1)
+                                   / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+            header.row_count = uint32_t(values.rowCount());
+            header.column_count = uint32_t(values.columnCount());
+
+            auto& fields = header.fields;
+            if (a.longitude)
+            {
+                fields |= LONGITUDE;
+                header.longitude_degree = a.longitude->degree;
+                header.longitude_minute = a.longitude->minute;
+                header.longitude_second = a.longitude->second;
+            }
+            if (a.latitude)
+            {
+                fields |= LATITUDE;
+                header.latitude_degree = a.latitude->degree;
+                header.latitude_minute = a.latitude->minute;
+                header.latitude_second = a.latitude->second;
+            }
+            if (const auto& corner = a.quadrangle_corners[0])
+            {
+                fields |= CORNER;
+                header.easting = corner->easting;
+                header.northing = corner->northing;
+            }
+            set_field(fields, REF_SYS, header.ref_sys, a.ref_sys);
+            set_field(fields, REF_SYS_ZONE, header.ref_sys_zone,
+                      a.ref_sys_zone);
+            set_field(fields, HORIZONTAL_UNIT, header.horizontal_unit,
+                      a.horizontal_unit);
+            set_field(fields, VERTICAL_UNIT, header.vertical_unit,
+                      a.vertical_unit);
+            set_field(fields, HORIZONTAL_DATUM, header.horizontal_datum,
+                      a.horizontal_datum);
+            set_field(fields, VERTICAL_DATUM, header.vertical_datum,
+                      a.vertical_datum);
+            set_field(fields, X_RESOLUTION, header.x_resolution,
+                      a.x_resolution);
+            set_field(fields, Y_RESOLUTION, header.y_resolution,
+                      a.y_resolution);
+            set_field(fields, Z_RESOLUTION, header.z_resolution,
+                      a.z_resolution);
+            set_field(fields, ROTATION_ANGLE, header.rotation_angle,
+                      a.rotation_angle);
+            return header;
+        }
+
+        RecordA make_record_a(const CacheHeader& header)
+        {
+            RecordA a;
+            auto fields = header.fields;
+            if (fields & LONGITUDE)
+            {
+                a.longitude = DegMinSec{header.longitude_degree,
+                                        header.longitude_minute,
+                                        header.longitude_second};
+            }
+            if (fields & LATITUDE)
+            {
+                a.latitude = DegMinSec{header.latitude_degree,
+                                       header.latitude_minute,
+                                       header.latitude_second};
+            }
+            if (fields & CORNER)
+            {
+                a.quadrangle_corners[0] = CartesianCoordinates{
+                    header.easting, header.northing};
+            }
+            get_field(fields, REF_SYS, a.ref_sys, header.ref_sys);
+            get_field(fields, REF_SYS_ZONE, a.ref_sys_zone,
+                      header.ref_sys_zone);
+            get_field(fields, HORIZONTAL_UNIT, a.horizontal_unit,
+                      header.horizontal_unit);
+            get_field(fields, VERTICAL_UNIT, a.vertical_unit,
+                      header.vertical_unit);
+            get_field(fields, HORIZONTAL_DATUM, a.horizontal_datum,
+                      header.horizontal_datum);
+            get_field(fields, VERTICAL_DATUM, a.vertical_datum,
+                      header.vertical_datum);
+            get_field(fields, X_RESOLUTION, a.x_resolution,
+                      header.x_resolution);
+            get_field(fields, Y_RESOLUTION, a.y_resolution,
+                      header.y_resolution);
+            get_field(fields, Z_RESOLUTION, a.z_resolution,
+                      header.z_resolution);
+            get_field(fields, ROTATION_ANGLE, a.rotation_angle,
+                      header.rotation_angle);
+            // Grid rows are DEM columns.
+            a.columns = int16_t(header.row_count);
+            a.rows = int16_t(header.column_count);
+            return a;
+        }
+    }
+
+    bool operator==(const DemCacheSource& a, const DemCacheSource& b)
+    {
+        return a.size == b.size
+               && a.modification_time == b.modification_time;
+    }
+
+    bool operator!=(const DemCacheSource& a, const DemCacheSource& b)
+    {
+        return !(a == b);
+    }
+
+    DemCacheSource get_dem_cache_source(const std::string& dem_file_name)
+    {
+        try
+        {
+            DemCacheSource result;
+            result.size = std::filesystem::file_size(dem_file_name);
+            auto time = std::filesystem::last_write_time(dem_file_name);
+            result.modification_time = std::chrono::duration_cast<
+                std::chrono::nanoseconds>(time.time_since_epoch()).count();
+            return result;
+        }
+        catch (std::exception& ex)
+        {
+            DEM_THROW_STRING(std::string("Can not get the size and time of ")
+                             + dem_file_name + ": " + ex.what());
+        }
+    }
+
+    void write_dem_cache(const std::string& cache_file_name,
+                         const RecordA& a,
+                         const Chorasmia::ArrayView2D<int16_t>& values,
+                         const DemCacheSource& source)
+    {
+        auto header = make_header(a, values, source);
+        auto tmp_file_name = make_temp_file_name(cache_file_name);
+        try
+        {
+            std::ofstream file(tmp_file_name, std::ios::binary);
+            if (!file)
+            {
+                DEM_THROW_STRING(std::string("Can not create ")
+                                 + tmp_file_name);
+            }
+
+            file.write(reinterpret_cast<const char*>(&header),
+                       sizeof(header));
+            char padding[CACHE_ALIGNMENT] = {};
+            file.write(padding, std::streamsize(header.values_offset
+                                                - sizeof(header)));
+            for (size_t i = 0; i < values.rowCount(); ++i)
+            {
+                file.write(reinterpret_cast<const char*>(&values(i, 0)),
+                           std::streamsize(values.columnCount()
+                                           * sizeof(int16_t)));
+            }
+            file.close();
+            if (!file)
+            {
+                DEM_THROW_STRING(std::string("Unable to write ")
+                                 + tmp_file_name);
+            }
+        }
+        catch (...)
+        {
+            std::error_code ec;
+            std::filesystem::remove(tmp_file_name, ec);
+            throw;
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmp_file_name, cache_file_name, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tmp_file_name, ec);
+            DEM_THROW_STRING(std::string("Unable to create ")
+                             + cache_file_name);
+        }
+    }
+
+    void write_dem_cache(const std::string& cache_file_name,
+                         const std::string& dem_file_name)
+    {
+        auto source = get_dem_cache_source(dem_file_name);
+        DemReader reader(dem_file_name);
+        write_dem_cache(cache_file_name, reader, source);
+    }
+
+    void write_dem_cache(const std::string& cache_file_name,
+                         DemReader& reader,
+                         const DemCacheSource& source)
+    {
+        // Without a vertical unit the values are not scaled.
+        auto grid = read_compact_dem_grid(reader, GridLib::Unit::UNDEFINED);
+        write_dem_cache(cache_file_name, reader.record_a(), grid.values(),
+                        source);
+    }
+
+    struct DemCache::Data
+    {
+        MemoryMappedFile file;
+        DemCacheSource source;
+        RecordA a;
+        Chorasmia::ArrayView2D<int16_t> values;
+    };
+
+    DemCache::DemCache() = default;
+
+    DemCache::DemCache(const std::string& file_name)
+        : m_Data(std::make_unique<Data>())
+    {
+        m_Data->file = MemoryMappedFile(file_name);
+        const auto& file = m_Data->file;
+
+        CacheHeader header;
+        if (file.size() < sizeof(header))
+            DEM_THROW_STRING(file_name + " is not a DEM cache file.");
+        memcpy(&header, file.data(), sizeof(header));
+        if (!std::equal(std::begin(CACHE_MAGIC), std::end(CACHE_MAGIC),
+                        header.magic))
+        {
+            DEM_THROW_STRING(file_name + " is not a DEM cache file.");
+        }
+        if (header.byte_order != CACHE_BYTE_ORDER)
+        {
+            DEM_THROW_STRING(file_name + " was written on a machine with"
+                                         " a different byte order.");
+        }
+        if (header.version != CACHE_VERSION)
+        {
+            DEM_THROW_STRING(file_name + " has an unsupported version.");
+        }
+
+        auto values_size = uint64_t(header.row_count) * header.column_count
+                           * sizeof(int16_t);
+        if (header.values_offset % CACHE_ALIGNMENT != 0
+            || header.values_offset > file.size()
+            || file.size() - header.values_offset < values_size)
+        {
+            DEM_THROW_STRING(file_name + " is truncated or corrupt.");
+        }
+
+        m_Data->source = {header.source_size, header.source_time};
+        m_Data->a = make_record_a(header);
+        m_Data->values = Chorasmia::ArrayView2D<int16_t>(
+            reinterpret_cast<const int16_t*>(file.data()
+                                             + header.values_offset),
+            header.row_count, header.column_count);
+    }
+
+    DemCache::DemCache(DemCache&& rhs) noexcept = default;
+
+    DemCache::~DemCache() = default;
+
+    DemCache& DemCache::operator=(DemCache&& rhs) noexcept = default;
+
+    const DemCacheSource& DemCache::source() const
+    {
+        if (!m_Data)
+            DEM_THROW("The DemCache is empty.");
+        return m_Data->source;
+    }
+
+    bool DemCache::is_current(const std::string& dem_file_name) const
+    {
+        std::error_code ec;
+        if (!std::filesystem::exists(dem_file_name, ec))
+            return false;
+        return get_dem_cache_source(dem_file_name) == source();
+    }
+
+    const RecordA& DemCache::record_a() const
+    {
+        if (!m_Data)
+            DEM_THROW("The DemCache is empty.");
+        return m_Data->a;
+    }
+
+    Chorasmia::ArrayView2D<int16_t> DemCache::values() const
+    {
+        if (!m_Data)
+            return {};
+        return m_Data->values;
+    }
+
+    CompactGrid DemCache::to_compact_grid(GridLib::Unit vertical_unit) const
+    {
+        auto values = this->values();
+        CompactGrid grid(values.rowCount(), values.columnCount());
+        grid.set_factor(initialize_grid(grid.metadata(), record_a(),
+                                        vertical_unit));
+        auto dst = grid.values();
+        for (size_t i = 0; i < values.rowCount(); ++i)
+        {
+            std::copy_n(&values(i, 0), values.columnCount(), &dst(i, 0));
+        }
+        return grid;
+    }
+
+    GridLib::Grid DemCache::to_grid(GridLib::Unit vertical_unit) const
+    {
+        auto values = this->values();
+        GridLib::Grid grid;
+        auto factor = initialize_grid(grid, record_a(), vertical_unit);
+        grid.resize(values.rowCount(), values.columnCount());
+        auto dst = grid.elevations();
+        for (size_t i = 0; i < values.rowCount(); ++i)
+        {
+            scale_elevations(&values(i, 0), values.columnCount(), factor,
+                             &dst(i, 0));
+        }
+        return grid;
+    }
+
+    CompactGrid
+    read_cached_compact_dem_grid(const std::string& dem_file_name,
+                                 const std::string& cache_file_name,
+                                 GridLib::Unit vertical_unit)
+    {
+        std::error_code ec;
+        if (std::filesystem::exists(cache_file_name, ec))
+        {
+            try
+            {
+                DemCache cache(cache_file_name);
+                if (cache.is_current(dem_file_name))
+                    return cache.to_compact_grid(vertical_unit);
+            }
+            catch (DemException&)
+            {
+                // The cache is replaced below.
+            }
+        }
+
+        auto source = get_dem_cache_source(dem_file_name);
+        DemReader reader(dem_file_name);
+        auto grid = read_compact_dem_grid(reader, vertical_unit);
+        try
+        {
+            write_dem_cache(cache_file_name, reader.record_a(),
+                            grid.values(), source);
+        }
+        catch (DemException&)
+        {
+            // The grid is still valid, e.g. if the cache's directory is
+            // read-only or the disk is full.
+        }
+        return grid;
+    }
+}
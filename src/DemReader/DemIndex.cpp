@@ -0,0 +1,233 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-02-20.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DemReader/DemIndex.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include "DemReader/DemException.hpp"
+#include "DemReader/RecordB.hpp"
+#include "FortranReader.hpp"
+
+namespace Dem
+{
+    namespace
+    {
+        constexpr char INDEX_SIGNATURE[] = "DEMINDEX";
+        constexpr int INDEX_VERSION = 2;
+        /// The number of records that are allocated before any of them
+        /// have been read. Larger indexes grow as they are read, which
+        /// means a corrupt count can't allocate more memory than the
+        /// index's size warrants.
+        constexpr size_t MAX_INITIAL_RECORDS = 4096;
+    }
+
+    bool operator==(const DemIndexSource& a, const DemIndexSource& b)
+    {
+        return a.size == b.size
+               && a.modification_time == b.modification_time;
+    }
+
+    bool operator!=(const DemIndexSource& a, const DemIndexSource& b)
+    {
+        return !(a == b);
+    }
+
+    DemIndexSource get_dem_index_source(const std::string& dem_file_name)
+    {
+        try
+        {
+            DemIndexSource result;
+            result.size = std::filesystem::file_size(dem_file_name);
+            auto time = std::filesystem::last_write_time(dem_file_name);
+            result.modification_time = std::chrono::duration_cast<
+                std::chrono::nanoseconds>(time.time_since_epoch()).count();
+            return result;
+        }
+        catch (std::exception& ex)
+        {
+            DEM_THROW_STRING(std::string("Can not get the size and time of ")
+                             + dem_file_name + ": " + ex.what());
+        }
+    }
+
+    DemIndex::DemIndex() = default;
+
+    DemIndex::DemIndex(std::vector<RecordBInfo> records,
+                       const DemIndexSource& source)
+        : m_Records(std::move(records)),
+          m_Source(source)
+    {}
+
+    const DemIndexSource& DemIndex::source() const
+    {
+        return m_Source;
+    }
+
+    void DemIndex::set_source(const DemIndexSource& source)
+    {
+        m_Source = source;
+    }
+
+    const std::vector<RecordBInfo>& DemIndex::records() const
+    {
+        return m_Records;
+    }
+
+    size_t DemIndex::size() const
+    {
+        return m_Records.size();
+    }
+
+    bool DemIndex::empty() const
+    {
+        return m_Records.empty();
+    }
+
+    const RecordBInfo& DemIndex::operator[](size_t index) const
+    {
+        return m_Records[index];
+    }
+
+    std::optional<size_t> DemIndex::find_column(int column) const
+    {
+        for (size_t i = 0; i < m_Records.size(); ++i)
+        {
+            const auto& rec = m_Records[i];
+            if (rec.column <= column && column < rec.column + rec.columns)
+                return i;
+        }
+        return {};
+    }
+
+    DemIndex build_dem_index(FortranReader& reader, bool has_record_c)
+    {
+        std::vector<RecordBInfo> records;
+        auto offset = reader.tell();
+        if (offset < 0)
+            DEM_THROW("Unable to determine the position in the stream.");
+
+        while (reader.fill_buffer(DEM_BLOCK_SIZE))
+        {
+            if (has_record_c)
+            {
+                reader.fill_buffer(2 * DEM_BLOCK_SIZE);
+                if (reader.remaining_buffer_size() == DEM_BLOCK_SIZE)
+                    break;
+            }
+
+            RecordBInfo info;
+            info.offset = size_t(offset);
+            auto row = reader.read_int16(6);
+            auto column = reader.read_int16(6);
+            auto rows = reader.read_int16(6);
+            auto columns = reader.read_int16(6);
+            if (!row || !column || !rows || !columns
+                || *rows < 0 || *columns < 0)
+            {
+                DEM_THROW("Invalid record of type B.");
+            }
+            info.row = *row;
+            info.column = *column;
+            info.rows = *rows;
+            info.columns = *columns;
+            info.size = get_record_b_size(info.rows, info.columns);
+            records.push_back(info);
+
+            if (!reader.seek(std::streamoff(info.size - 4 * 6),
+                             std::ios_base::cur))
+            {
+                DEM_THROW("End of file reached.");
+            }
+            offset += std::streamoff(info.size);
+        }
+        return DemIndex(std::move(records));
+    }
+
+    void save_dem_index(const DemIndex& index, std::ostream& stream)
+    {
+        stream << INDEX_SIGNATURE << ' ' << INDEX_VERSION << '\n'
+               << index.source().size << ' '
+               << index.source().modification_time << '\n'
+               << index.size() << '\n';
+        for (const auto& rec : index.records())
+        {
+            stream << rec.offset << ' ' << rec.size << ' '
+                   << rec.row << ' ' << rec.column << ' '
+                   << rec.rows << ' ' << rec.columns << '\n';
+        }
+        if (!stream)
+            DEM_THROW("Unable to write the index.");
+    }
+
+    void save_dem_index(const DemIndex& index, const std::string& file_name)
+    {
+        std::ofstream stream(file_name);
+        if (!stream)
+            DEM_THROW_STRING(std::string("Can not create ") + file_name);
+        save_dem_index(index, stream);
+    }
+
+    DemIndex load_dem_index(std::istream& stream)
+    {
+        std::string signature;
+        int version = 0;
+        stream >> signature >> version;
+        if (!stream || signature != INDEX_SIGNATURE)
+            DEM_THROW("The stream doesn't contain an index.");
+        if (version != INDEX_VERSION)
+            DEM_THROW("Unsupported index version.");
+
+        DemIndexSource source;
+        size_t count = 0;
+        stream >> source.size >> source.modification_time >> count;
+        if (!stream)
+            DEM_THROW("The index is incomplete.");
+
+        std::vector<RecordBInfo> records;
+        records.reserve(std::min(count, MAX_INITIAL_RECORDS));
+        for (size_t i = 0; i < count; ++i)
+        {
+            RecordBInfo rec;
+            stream >> rec.offset >> rec.size
+                   >> rec.row >> rec.column >> rec.rows >> rec.columns;
+            if (!stream)
+                DEM_THROW("The index is incomplete.");
+            records.push_back(rec);
+        }
+        return DemIndex(std::move(records), source);
+    }
+
+    DemIndex load_dem_index(const std::string& file_name)
+    {
+        std::ifstream stream(file_name);
+        if (!stream)
+            DEM_THROW_STRING(std::string("Can not open ") + file_name);
+        return load_dem_index(stream);
+    }
+
+    DemIndex load_dem_index(std::istream& stream,
+                            const DemIndexSource& expected_source)
+    {
+        auto index = load_dem_index(stream);
+        if (index.source() != expected_source)
+            DEM_THROW("The index was built from a different DEM file.");
+        return index;
+    }
+
+    DemIndex load_dem_index(const std::string& file_name,
+                            const std::string& dem_file_name)
+    {
+        auto source = get_dem_index_source(dem_file_name);
+        std::ifstream stream(file_name);
+        if (!stream)
+            DEM_THROW_STRING(std::string("Can not open ") + file_name);
+        return load_dem_index(stream, source);
+    }
+}
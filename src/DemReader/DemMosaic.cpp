@@ -0,0 +1,286 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-21.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DemReader/DemMosaic.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include "DemReader/DemException.hpp"
+#include "DemReader/DemReader.hpp"
+#include "GridMetadata.hpp"
+#include "ScaleElevations.hpp"
+
+namespace Dem
+{
+    namespace
+    {
+        struct MosaicFile
+        {
+            RecordA a;
+            double factor = 1.0;
+            /// The position of the first elevation in the first profile.
+            CartesianCoordinates first_position;
+        };
+
+        MosaicFile read_mosaic_file(const std::string& file_name,
+                                    GridLib::Unit desired_unit)
+        {
+            DemReader reader(file_name);
+            MosaicFile result;
+            result.a = reader.record_a();
+            for (const auto& corner : result.a.quadrangle_corners)
+            {
+                if (!corner)
+                {
+                    DEM_THROW_STRING(file_name + ": Record A doesn't have"
+                                                 " all the quadrangle"
+                                                 " corners.");
+                }
+            }
+            if (!result.a.x_resolution || !result.a.y_resolution
+                || *result.a.x_resolution <= 0 || *result.a.y_resolution <= 0)
+            {
+                DEM_THROW_STRING(file_name
+                                 + ": Record A has no valid resolution.");
+            }
+
+            GridLib::Grid metadata;
+            result.factor = initialize_grid(metadata, result.a,
+                                            desired_unit);
+            // Only the header is needed, no elevations are decoded.
+            auto first = reader.next_record_b(1, 0);
+            if (!first)
+                DEM_THROW_STRING(file_name + ": The file has no profiles.");
+            result.first_position = {first->x, first->y};
+            return result;
+        }
+
+        bool is_same(double a, double b)
+        {
+            return std::abs(a - b) <= 1e-6 * std::max(std::abs(a),
+                                                      std::abs(b));
+        }
+
+        void check_compatible(const RecordA& a, const RecordA& b,
+                              GridLib::Unit desired_unit,
+                              const std::string& file_name)
+        {
+            if (a.ref_sys != b.ref_sys || a.ref_sys_zone != b.ref_sys_zone
+                || a.horizontal_unit != b.horizontal_unit
+                || a.horizontal_datum != b.horizontal_datum)
+            {
+                DEM_THROW_STRING(file_name + ": The reference system differs"
+                                             " from the first file.");
+            }
+            if (!is_same(*a.x_resolution, *b.x_resolution)
+                || !is_same(*a.y_resolution, *b.y_resolution))
+            {
+                DEM_THROW_STRING(file_name + ": The resolution differs"
+                                             " from the first file.");
+            }
+            // The elevations are only converted to a common unit when
+            // the desired unit is meters or feet.
+            if (desired_unit != GridLib::Unit::METERS
+                && desired_unit != GridLib::Unit::FEET
+                && (a.vertical_unit != b.vertical_unit
+                    || a.z_resolution != b.z_resolution))
+            {
+                DEM_THROW_STRING(file_name + ": The vertical unit differs"
+                                             " from the first file.");
+            }
+        }
+
+        /**
+         * @brief Returns the number of cells from @a origin to
+         *  @a position, which must be on the lattice of the mosaic.
+         */
+        int64_t get_offset(double position, double origin,
+                           double resolution, const std::string& file_name)
+        {
+            auto offset = (position - origin) / resolution;
+            auto rounded = std::round(offset);
+            if (std::abs(offset - rounded) > 0.01)
+            {
+                DEM_THROW_STRING(file_name + ": The profiles aren't aligned"
+                                             " with the profiles of the"
+                                             " first file.");
+            }
+            return int64_t(rounded);
+        }
+
+        /**
+         * @brief Returns the offsets of the first and last lattice points
+         *  from @a origin that lie within [@a min, @a max].
+         */
+        std::pair<int64_t, int64_t>
+        get_lattice_range(double min, double max, double origin,
+                          double resolution)
+        {
+            return {int64_t(std::ceil((min - origin) / resolution - 0.01)),
+                    int64_t(std::floor((max - origin) / resolution + 0.01))};
+        }
+
+        /**
+         * @brief Writes the known elevations in @a elevations to
+         *  @a values.
+         *
+         * If @a covered isn't empty, cells that are already covered by
+         * another file are left as they are.
+         */
+        void merge_elevations(const int16_t* elevations,
+                              const double* scaled, size_t count,
+                              double* values, std::vector<bool>& covered,
+                              size_t covered_index)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (elevations[i] == UNKNOWN_ELEVATION)
+                    continue;
+                if (!covered.empty())
+                {
+                    if (covered[covered_index + i])
+                        continue;
+                    covered[covered_index + i] = true;
+                }
+                values[i] = scaled[i];
+            }
+        }
+    }
+
+    GridLib::Grid
+    build_dem_mosaic(const std::vector<std::string>& file_names,
+                     const MosaicOptions& options,
+                     const ProgressCallback& progress_callback)
+    {
+        if (file_names.empty())
+            return {};
+
+        // Read record A of every file to find the extent of the mosaic.
+        std::vector<MosaicFile> files;
+        files.reserve(file_names.size());
+        for (const auto& file_name : file_names)
+        {
+            files.push_back(read_mosaic_file(file_name,
+                                             options.vertical_unit));
+            check_compatible(files.front().a, files.back().a,
+                             options.vertical_unit, file_name);
+        }
+
+        // The profiles of all the files must lie on the lattice of the
+        // profiles in the first file. The quadrangle corners are usually
+        // not on the lattice, e.g. in 7.5-minute quadrangles with UTM
+        // coordinates, but the lattice points inside them give the
+        // extent of the mosaic.
+        auto x_res = double(*files.front().a.x_resolution);
+        auto y_res = double(*files.front().a.y_resolution);
+        auto anchor = files.front().first_position;
+        auto min_x = INT64_MAX, max_x = INT64_MIN;
+        auto min_y = INT64_MAX, max_y = INT64_MIN;
+        size_t steps = 0;
+        for (const auto& file : files)
+        {
+            auto [west, east] = std::minmax(
+                {file.a.quadrangle_corners[0]->easting,
+                 file.a.quadrangle_corners[1]->easting,
+                 file.a.quadrangle_corners[2]->easting,
+                 file.a.quadrangle_corners[3]->easting});
+            auto [south, north] = std::minmax(
+                {file.a.quadrangle_corners[0]->northing,
+                 file.a.quadrangle_corners[1]->northing,
+                 file.a.quadrangle_corners[2]->northing,
+                 file.a.quadrangle_corners[3]->northing});
+            auto [x0, x1] = get_lattice_range(west, east, anchor.easting,
+                                              x_res);
+            auto [y0, y1] = get_lattice_range(south, north, anchor.northing,
+                                              y_res);
+            min_x = std::min(min_x, x0);
+            max_x = std::max(max_x, x1);
+            min_y = std::min(min_y, y0);
+            max_y = std::max(max_y, y1);
+            steps += size_t(file.a.columns.value_or(1));
+        }
+
+        if (max_x < min_x || max_y < min_y)
+            DEM_THROW("The quadrangles are smaller than the resolution.");
+
+        // Grid rows are DEM columns.
+        auto row_count = size_t(max_x - min_x + 1);
+        auto column_count = size_t(max_y - min_y + 1);
+        auto easting = anchor.easting + double(min_x) * x_res;
+        auto northing = anchor.northing + double(min_y) * y_res;
+
+        // The first file provides the metadata, except for the position.
+        GridLib::Grid grid;
+        auto a = files.front().a;
+        a.longitude = {};
+        a.latitude = {};
+        auto factor = initialize_grid(grid, a, options.vertical_unit);
+        grid.setPlanarCoords(GridLib::PlanarCoords{
+            easting, northing, a.ref_sys_zone.value_or(0)});
+        grid.resize(row_count, column_count);
+        auto values = grid.elevations();
+        for (size_t i = 0; i < row_count; ++i)
+        {
+            std::fill(&values(i, 0), &values(i, 0) + column_count,
+                      UNKNOWN_ELEVATION * factor);
+        }
+
+        std::vector<bool> covered;
+        if (options.overlap == MosaicOverlap::FIRST)
+            covered.resize(row_count * column_count);
+
+        size_t step = 0;
+        RecordB b;
+        std::vector<int16_t> elevations;
+        std::vector<double> scaled;
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            const auto& file = files[i];
+            DemReader reader(file_names[i]);
+            while (reader.next_record_b(b, elevations))
+            {
+                auto first_row = get_offset(b.x, easting, x_res,
+                                            file_names[i]);
+                auto first_column = get_offset(b.y, northing, y_res,
+                                               file_names[i]);
+                if (first_row < 0 || first_column < 0
+                    || size_t(first_row) + size_t(b.columns) > row_count
+                    || size_t(first_column) + size_t(b.rows) > column_count)
+                {
+                    DEM_THROW_STRING(file_names[i] + ": Record of type B is"
+                                                     " outside the"
+                                                     " quadrangle.");
+                }
+
+                scaled.resize(size_t(b.rows));
+                auto column = size_t(first_column);
+                for (int j = 0; j < b.columns; ++j)
+                {
+                    auto row = size_t(first_row) + size_t(j);
+                    auto src = elevations.data() + size_t(j) * b.rows;
+                    scale_elevations(src, scaled.size(), file.factor,
+                                     scaled.data());
+                    merge_elevations(src, scaled.data(), scaled.size(),
+                                     &values(row, column), covered,
+                                     row * column_count + column);
+                }
+
+                if (progress_callback
+                    && !progress_callback(step + b.column + b.columns - 1,
+                                          steps))
+                {
+                    return {};
+                }
+            }
+            step += size_t(file.a.columns.value_or(1));
+        }
+
+        return grid;
+    }
+}
@@ -7,28 +7,254 @@
 //****************************************************************************
 #include "DemReader/DemReader.hpp"
 
+#include <algorithm>
+#include <fstream>
+#include <string_view>
+
 #include "DemReader/RecordA.hpp"
 #include "DemReader/RecordB.hpp"
 #include "DemReader/RecordC.hpp"
 #include "DemReader/DemException.hpp"
+#include "DemReader/ElevationStatistics.hpp"
+#include "DecompressStreamBuf.hpp"
 #include "FortranReader.hpp"
+#include "MemoryMappedFile.hpp"
+#include "ReadAheadStreamBuf.hpp"
 
 namespace Dem
 {
+    namespace
+    {
+        /**
+         * @brief Puts @a data back into @a stream, which must be where
+         *  it was read from.
+         *
+         * @param pos The position @a data was read from, or -1 if the
+         *  stream can't seek.
+         */
+        void put_back(std::istream& stream, std::istream::pos_type pos,
+                      const std::string& data)
+        {
+            stream.clear();
+            if (pos >= 0 && stream.seekg(pos))
+                return;
+
+            // Pipes can't seek, but the bytes that were just read are
+            // usually still in the stream's buffer.
+            stream.clear();
+            auto buffer = stream.rdbuf();
+            for (auto it = data.rbegin(); it != data.rend(); ++it)
+            {
+                if (buffer->sputbackc(*it) == std::istream::traits_type::eof())
+                    DEM_THROW("Unable to put back the start of the input.");
+            }
+        }
+
+        /**
+         * @brief Determines the compression format of @a stream.
+         *
+         * A DEM file starts with text, so the first byte of a gzip
+         * header is enough to tell them apart. zstd's signature starts
+         * with '(', which is text, so streams that start with '(' have
+         * their first four bytes read into @a prefix. The bytes are put
+         * back unless they are zstd's signature, in which case they
+         * must be passed on to the decompressor.
+         */
+        Compression detect_compression(std::istream& stream,
+                                       std::string& prefix)
+        {
+            auto first = stream.peek();
+            if (first == 0x1F)
+                return Compression::GZIP;
+            if (first != 0x28)
+                return Compression::NONE;
+
+            auto pos = stream.tellg();
+            prefix.resize(4);
+            stream.read(prefix.data(), std::streamsize(prefix.size()));
+            prefix.resize(size_t(stream.gcount()));
+            if (Dem::detect_compression(prefix.data(), prefix.size())
+                == Compression::ZSTD)
+            {
+                return Compression::ZSTD;
+            }
+
+            put_back(stream, pos, prefix);
+            prefix.clear();
+            return Compression::NONE;
+        }
+
+        /**
+         * @brief Returns the number of bytes from the current position
+         *  to the end of @a stream, or 0 if the stream can't seek.
+         */
+        uint64_t get_remaining_size(std::istream& stream)
+        {
+            auto pos = stream.tellg();
+            if (pos < 0)
+                return 0;
+            stream.seekg(0, std::ios::end);
+            auto end = stream.tellg();
+            stream.clear();
+            stream.seekg(pos);
+            return end > pos ? uint64_t(end - pos) : 0;
+        }
+    }
+
     struct DemReader::Data
     {
-        explicit Data(std::istream& stream)
-            : reader(stream)
+        Data() = default;
+
+        Data(const char* data, size_t size)
+            : reader(data, size)
         {}
 
+        /**
+         * @brief Sets up the reader to read from @a stream.
+         *
+         * Compressed input is decompressed in the read-ahead thread,
+         * which means decompression and parsing overlap. @a prefix is
+         * compressed data that has already been read from @a stream.
+         */
+        void open(std::istream& stream, Compression compression,
+                  std::optional<ReadAheadOptions> options,
+                  std::string_view prefix = {})
+        {
+            std::istream* input = &stream;
+            if (compression != Compression::NONE)
+            {
+                if (!is_supported(compression))
+                    DEM_THROW("DemReader was built without zstd support.");
+                decompress = std::make_unique<DecompressStreamBuf>(
+                    stream, compression, prefix);
+                decompressed = std::make_unique<std::istream>(
+                    decompress.get());
+                // Let errors in the compressed data reach the caller
+                // rather than making the stream look shorter.
+                decompressed->exceptions(std::ios::badbit);
+                input = decompressed.get();
+                if (!options)
+                    options = ReadAheadOptions();
+            }
+
+            if (options)
+            {
+                read_ahead = std::make_unique<ReadAheadStreamBuf>(
+                    *input, options->buffer_size, options->depth);
+                buffered = std::make_unique<std::istream>(read_ahead.get());
+                buffered->exceptions(std::ios::badbit);
+                input = buffered.get();
+            }
+
+            reader = FortranReader(*input);
+        }
+
+        void open(const std::string& file_name, Compression compression,
+                  std::optional<ReadAheadOptions> options)
+        {
+            source = std::make_unique<std::ifstream>(file_name,
+                                                     std::ios::binary);
+            if (!*source)
+                DEM_THROW_STRING(std::string("Can not open ") + file_name);
+            open(*source, compression, options);
+        }
+
+        MemoryMappedFile file;
+        // The streams are destroyed in reverse order, which means the
+        // read-ahead thread is stopped before the streams it reads from
+        // are destroyed.
+        std::unique_ptr<std::istream> source;
+        std::unique_ptr<DecompressStreamBuf> decompress;
+        std::unique_ptr<std::istream> decompressed;
+        std::unique_ptr<ReadAheadStreamBuf> read_ahead;
+        std::unique_ptr<std::istream> buffered;
         FortranReader reader;
+        StreamAccess access = StreamAccess::SEEKABLE;
         RecordA a;
         std::optional<RecordC> c;
+        std::optional<DemIndex> index;
+        /// Identifies the input in saved indexes.
+        DemIndexSource index_source;
+        /// The first column after the records of type B that have been
+        /// read. Record C follows the record that ends at column
+        /// a.columns.
+        int next_column = 1;
+        ElevationStatistics* statistics = nullptr;
     };
 
-    DemReader::DemReader(std::istream& stream)
-        : m_Data(std::make_unique<Data>(stream))
+    DemReader::DemReader(std::istream& stream, StreamAccess access)
+        : m_Data(std::make_unique<Data>())
     {
+        m_Data->access = access;
+        if (access == StreamAccess::SEEKABLE)
+            m_Data->index_source.size = get_remaining_size(stream);
+        std::string prefix;
+        auto compression = detect_compression(stream, prefix);
+        m_Data->open(stream, compression, {}, prefix);
+        read_record_a();
+        read_record_c();
+    }
+
+    DemReader::DemReader(std::istream& stream,
+                         const ReadAheadOptions& options,
+                         StreamAccess access)
+        : m_Data(std::make_unique<Data>())
+    {
+        m_Data->access = access;
+        if (access == StreamAccess::SEEKABLE)
+            m_Data->index_source.size = get_remaining_size(stream);
+        std::string prefix;
+        auto compression = detect_compression(stream, prefix);
+        m_Data->open(stream, compression, options, prefix);
+        read_record_a();
+        read_record_c();
+    }
+
+    DemReader::DemReader(const std::string& file_name)
+        : m_Data(std::make_unique<Data>())
+    {
+        MemoryMappedFile file(file_name);
+        auto compression = Dem::detect_compression(
+            file.data(), std::min<size_t>(file.size(), 4));
+        if (compression == Compression::NONE)
+        {
+            m_Data->file = std::move(file);
+            m_Data->reader = FortranReader(m_Data->file.data(),
+                                           m_Data->file.size());
+        }
+        else
+        {
+            m_Data->open(file_name, compression, {});
+        }
+        m_Data->index_source = get_dem_index_source(file_name);
+        read_record_a();
+        read_record_c();
+    }
+
+    DemReader::DemReader(const std::string& file_name,
+                         const ReadAheadOptions& options)
+        : m_Data(std::make_unique<Data>())
+    {
+        Compression compression;
+        {
+            std::ifstream file(file_name, std::ios::binary);
+            if (!file)
+                DEM_THROW_STRING(std::string("Can not open ") + file_name);
+            char magic[4];
+            file.read(magic, sizeof(magic));
+            compression = Dem::detect_compression(magic,
+                                                  size_t(file.gcount()));
+        }
+        m_Data->open(file_name, compression, options);
+        m_Data->index_source = get_dem_index_source(file_name);
+        read_record_a();
+        read_record_c();
+    }
+
+    DemReader::DemReader(const char* data, size_t size)
+        : m_Data(std::make_unique<Data>(data, size))
+    {
+        m_Data->index_source.size = size;
         read_record_a();
         read_record_c();
     }
@@ -54,6 +280,244 @@ namespace Dem
         return read_record_b();
     }
 
+    bool DemReader::next_record_b(RecordB& record)
+    {
+        if (!has_more_record_b())
+            return false;
+
+        try
+        {
+            Dem::read_record_b(m_Data->reader, record, m_Data->statistics);
+            m_Data->next_column = record.column + record.columns;
+            return true;
+        }
+        catch (std::exception& ex)
+        {
+            DEM_THROW_STRING(std::string("Invalid record of type B.\n    ")
+                             + ex.what());
+        }
+    }
+
+    bool DemReader::next_record_b(RecordB& record,
+                                  std::vector<int16_t>& elevations)
+    {
+        if (!has_more_record_b())
+            return false;
+
+        try
+        {
+            auto& reader = m_Data->reader;
+            read_record_b_header(reader, record);
+            record.elevations.clear();
+            elevations.resize(size_t(record.rows) * size_t(record.columns));
+            read_record_b_elevations(reader, record, 0, elevations.size(),
+                                     elevations.data(), m_Data->statistics);
+            m_Data->next_column = record.column + record.columns;
+            return true;
+        }
+        catch (std::exception& ex)
+        {
+            DEM_THROW_STRING(std::string("Invalid record of type B.\n    ")
+                             + ex.what());
+        }
+    }
+
+    std::optional<RecordB> DemReader::next_record_b(int first_row,
+                                                    int row_count)
+    {
+        if (!has_more_record_b())
+            return {};
+
+        try
+        {
+            auto& reader = m_Data->reader;
+            auto result = Dem::read_record_b_header(reader);
+            m_Data->next_column = result.column + result.columns;
+            auto first = std::max(first_row, int(result.row));
+            auto last = std::min(first_row + std::max(row_count, 0),
+                                 result.row + result.rows);
+            if (first >= last)
+            {
+                read_record_b_elevations(reader, result, 0, 0,
+                                         static_cast<int32_t*>(nullptr));
+                result.rows = 0;
+                return result;
+            }
+
+            if (result.columns == 1)
+            {
+                result.elevations.resize(size_t(last - first));
+                read_record_b_elevations(reader, result,
+                                         size_t(first - result.row),
+                                         result.elevations.size(),
+                                         result.elevations.data(),
+                                         m_Data->statistics);
+            }
+            else
+            {
+                // The elevations are ordered by column and then by row,
+                // read all of them and remove the ones that aren't needed.
+                result.elevations.resize(size_t(result.rows)
+                                         * size_t(result.columns));
+                read_record_b_elevations(reader, result, 0,
+                                         result.elevations.size(),
+                                         result.elevations.data());
+                auto it = result.elevations.begin();
+                for (int i = 0; i < result.columns; ++i)
+                {
+                    auto src = result.elevations.begin()
+                               + i * result.rows + (first - result.row);
+                    it = std::copy(src, src + (last - first), it);
+                }
+                result.elevations.erase(it, result.elevations.end());
+                if (m_Data->statistics)
+                    m_Data->statistics->add(result.elevations.data(),
+                                            result.elevations.size());
+            }
+            result.row = int16_t(first);
+            result.rows = int16_t(last - first);
+            return result;
+        }
+        catch (std::exception& ex)
+        {
+            DEM_THROW_STRING(std::string("Invalid record of type B.\n    ")
+                             + ex.what());
+        }
+    }
+
+    std::optional<RecordBInfo> DemReader::peek_record_b()
+    {
+        if (!has_more_record_b())
+            return {};
+
+        auto str = m_Data->reader.peek_string(4 * 6);
+        FortranReader header(str.data(), str.size());
+        auto row = header.read_int16(6);
+        auto column = header.read_int16(6);
+        auto rows = header.read_int16(6);
+        auto columns = header.read_int16(6);
+        if (!row || !column || !rows || !columns
+            || *rows < 0 || *columns < 0)
+        {
+            DEM_THROW("Invalid record of type B.");
+        }
+
+        RecordBInfo result;
+        result.offset = size_t(m_Data->reader.tell());
+        result.size = get_record_b_size(*rows, *columns);
+        result.row = *row;
+        result.column = *column;
+        result.rows = *rows;
+        result.columns = *columns;
+        return result;
+    }
+
+    bool DemReader::skip_record_b()
+    {
+        auto info = peek_record_b();
+        if (!info)
+            return false;
+        m_Data->reader.skip(info->size);
+        m_Data->next_column = info->column + info->columns;
+        return true;
+    }
+
+    const DemIndex& DemReader::index()
+    {
+        if (!m_Data)
+            DEM_THROW("No input stream.");
+
+        if (!m_Data->index)
+        {
+            if (m_Data->access == StreamAccess::SINGLE_PASS)
+                DEM_THROW("The index requires seekable input.");
+
+            auto& reader = m_Data->reader;
+            auto pos = reader.tell();
+            auto next_column = m_Data->next_column;
+            move_to_first_record_b();
+            // Record C may not have been read yet if the reader is in
+            // single-pass mode, so rely on record A's flag.
+            auto has_record_c = m_Data->a.data_validation_flag.value_or(0)
+                                != 0;
+            m_Data->index = build_dem_index(reader, has_record_c);
+            m_Data->index->set_source(m_Data->index_source);
+            if (pos >= 0)
+                reader.seek(pos, std::ios_base::beg);
+            m_Data->next_column = next_column;
+        }
+        return *m_Data->index;
+    }
+
+    void DemReader::set_index(DemIndex index)
+    {
+        if (!m_Data)
+            DEM_THROW("No input stream.");
+
+        // Memory buffers and streams have no modification time, their
+        // indexes are only compared by size.
+        const auto& expected = m_Data->index_source;
+        const auto& actual = index.source();
+        if (expected.size != 0
+            && (actual.size != expected.size
+                || (expected.modification_time != 0
+                    && actual.modification_time != 0
+                    && actual.modification_time
+                       != expected.modification_time)))
+        {
+            DEM_THROW("The index was built from a different DEM file.");
+        }
+        m_Data->index = std::move(index);
+    }
+
+    RecordB DemReader::read_record_b(size_t index)
+    {
+        require_seekable();
+        const auto& idx = this->index();
+        if (index >= idx.size())
+            DEM_THROW("Index of record B is out of range.");
+
+        if (!m_Data->reader.seek(std::streamoff(idx[index].offset),
+                                 std::ios_base::beg))
+        {
+            DEM_THROW("Unable to move to the record of type B.");
+        }
+
+        try
+        {
+            RecordB result;
+            Dem::read_record_b(m_Data->reader, result, m_Data->statistics);
+            m_Data->next_column = result.column + result.columns;
+            return result;
+        }
+        catch (std::exception& ex)
+        {
+            DEM_THROW_STRING(std::string("Invalid record of type B.\n    ")
+                             + ex.what());
+        }
+    }
+
+    void DemReader::set_statistics(ElevationStatistics* statistics)
+    {
+        m_Data->statistics = statistics;
+    }
+
+    bool DemReader::seek_to_column(int column)
+    {
+        require_seekable();
+        const auto& idx = index();
+        auto i = idx.find_column(column);
+        if (!i)
+            return false;
+        if (!m_Data->reader.seek(std::streamoff(idx[*i].offset),
+                                 std::ios_base::beg))
+        {
+            return false;
+        }
+        m_Data->next_column = idx[*i].column;
+        return true;
+    }
+
     void DemReader::read_record_a()
     {
         if (!m_Data)
@@ -72,26 +536,52 @@ namespace Dem
         }
     }
 
-    std::optional<RecordB> DemReader::read_record_b()
+    bool DemReader::has_more_record_b()
     {
         if (!m_Data)
             DEM_THROW("No input stream.");
 
         if (!m_Data->reader.fill_buffer(1024))
-            return {};
+            return false;
+
+        if (m_Data->a.data_validation_flag.value_or(0) == 0)
+            return true;
 
-        if (m_Data->a.data_validation_flag.value_or(0) != 0
-            && m_Data->reader.fill_buffer(2048)
-            && m_Data->reader.remaining_buffer_size() == 1024)
+        bool at_record_c;
+        if (auto columns = m_Data->a.columns; columns && *columns > 0)
         {
-            // We've reached the final 1024 bytes of the file, which contains
-            // record type c.
-            return {};
+            // Record C follows the profile that ends at the last column.
+            at_record_c = m_Data->next_column > *columns;
         }
+        else
+        {
+            // fill_buffer only comes up short when the end of the input
+            // has been reached. If what remains is exactly one block,
+            // it is the record of type C.
+            m_Data->reader.fill_buffer(2048);
+            at_record_c = m_Data->reader.remaining_buffer_size() == 1024;
+        }
+
+        if (!at_record_c)
+            return true;
+
+        // Streams that aren't allowed to seek reach record C here.
+        if (!m_Data->c)
+            parse_record_c();
+        return false;
+    }
+
+    std::optional<RecordB> DemReader::read_record_b()
+    {
+        if (!has_more_record_b())
+            return {};
 
         try
         {
-            return Dem::read_record_b(m_Data->reader);
+            RecordB result;
+            Dem::read_record_b(m_Data->reader, result, m_Data->statistics);
+            m_Data->next_column = result.column + result.columns;
+            return result;
         }
         catch (std::exception& ex)
         {
@@ -105,8 +595,21 @@ namespace Dem
         if (m_Data->a.data_validation_flag.value_or(0) == 0)
             return;
 
-        m_Data->reader.seek(-1024, std::ios_base::end);
+        // If the stream can't or shouldn't seek, e.g. a pipe or
+        // compressed data, record C is read when the last record of
+        // type B has been read.
+        if (m_Data->access == StreamAccess::SINGLE_PASS
+            || !m_Data->reader.seek(-1024, std::ios_base::end))
+        {
+            return;
+        }
+
+        parse_record_c();
+        move_to_first_record_b();
+    }
 
+    void DemReader::parse_record_c()
+    {
         try
         {
             m_Data->c = Dem::read_record_c(m_Data->reader);
@@ -117,12 +620,21 @@ namespace Dem
                                          " a valid record of type C.\n    ")
                              + ex.what());
         }
+    }
 
-        move_to_first_record_b();
+    void DemReader::require_seekable() const
+    {
+        if (!m_Data)
+            DEM_THROW("No input stream.");
+        if (m_Data->access == StreamAccess::SINGLE_PASS)
+            DEM_THROW("Random access to records of type B requires"
+                      " seekable input.");
     }
 
     void DemReader::move_to_first_record_b()
     {
-        m_Data->reader.seek(1024, std::ios_base::beg);
+        if (!m_Data->reader.seek(1024, std::ios_base::beg))
+            DEM_THROW("Unable to move to the first record of type B.");
+        m_Data->next_column = 1;
     }
 }
@@ -0,0 +1,288 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-26.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DemReader/DemTileCache.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include "DemReader/DemReader.hpp"
+#include "GridMetadata.hpp"
+
+namespace Dem
+{
+    namespace
+    {
+        /// The file name followed by the members of the window.
+        using TileKey = std::tuple<std::string,
+                                   size_t, size_t, size_t, size_t>;
+
+        using TilePtr = std::shared_ptr<const GridLib::Grid>;
+
+        struct Tile
+        {
+            std::shared_future<TilePtr> future;
+            /// The tile's position in the LRU list, only valid when the
+            /// tile has been read.
+            std::list<TileKey>::iterator lru_position;
+            size_t size = 0;
+            bool ready = false;
+        };
+
+        bool is_entire_grid(const DemWindow& window)
+        {
+            return window.row == 0 && window.column == 0
+                   && window.row_count == SIZE_MAX
+                   && window.column_count == SIZE_MAX;
+        }
+
+        struct GridSize
+        {
+            size_t rows = 0;
+            size_t columns = 0;
+        };
+
+        GridSize read_grid_size(const std::string& file_name)
+        {
+            DemReader reader(file_name);
+            auto first = reader.peek_record_b();
+            if (!first)
+                return {};
+            const auto& a = reader.record_a();
+            return {size_t(a.columns.value_or(1)),
+                    size_t(get_row_count(a, first->rows))};
+        }
+
+        /**
+         * @brief Clamps @a window to a grid of @a size the same way
+         *  read_dem_grid does, and returns the default window if it
+         *  covers the entire grid.
+         */
+        DemWindow normalize_window(const DemWindow& window,
+                                   const GridSize& size)
+        {
+            DemWindow result;
+            result.row = std::min(window.row, size.rows);
+            result.row_count = std::min(window.row_count,
+                                        size.rows - result.row);
+            result.column = std::min(window.column, size.columns);
+            result.column_count = std::min(window.column_count,
+                                           size.columns - result.column);
+            if (result.row == 0 && result.column == 0
+                && result.row_count == size.rows
+                && result.column_count == size.columns)
+            {
+                return {};
+            }
+            return result;
+        }
+
+        /**
+         * @brief Returns an absolute path without ".", ".." and
+         *  symbolic links, so that different names for the same file
+         *  give the same tiles.
+         */
+        std::string normalize_path(const std::string& file_name)
+        {
+            std::error_code ec;
+            auto path = std::filesystem::weakly_canonical(file_name, ec);
+            if (ec)
+                return file_name;
+            return path.string();
+        }
+
+        size_t get_memory_usage(const GridLib::Grid& grid)
+        {
+            auto values = grid.elevations();
+            return sizeof(GridLib::Grid)
+                   + values.rowCount() * values.columnCount() * sizeof(double);
+        }
+    }
+
+    struct DemTileCache::Data
+    {
+        GridSize get_grid_size(const std::string& path)
+        {
+            {
+                std::lock_guard lock(mutex);
+                auto it = grid_sizes.find(path);
+                if (it != grid_sizes.end())
+                    return it->second;
+            }
+            // Reading the size doesn't require the lock, and two threads
+            // reading it at the same time get the same result.
+            auto size = read_grid_size(path);
+            std::lock_guard lock(mutex);
+            grid_sizes.emplace(path, size);
+            return size;
+        }
+
+        /**
+         * @brief Removes the least recently used tiles until the cache
+         *  is within the budget, but never @a keep.
+         */
+        void evict(const TileKey* keep)
+        {
+            while (memory_usage > memory_budget && !lru.empty())
+            {
+                auto& key = lru.back();
+                if (keep && key == *keep)
+                {
+                    if (lru.size() == 1)
+                        break;
+                    lru.splice(lru.begin(), lru, std::prev(lru.end()));
+                    continue;
+                }
+                auto it = tiles.find(key);
+                memory_usage -= it->second.size;
+                tiles.erase(it);
+                lru.pop_back();
+                ++statistics.evictions;
+            }
+        }
+
+        GridLib::Unit vertical_unit;
+        size_t memory_budget;
+        mutable std::mutex mutex;
+        std::map<TileKey, Tile> tiles;
+        /// The grid sizes of the files, used to normalize windows.
+        std::map<std::string, GridSize> grid_sizes;
+        /// The keys of the tiles that have been read, the most recently
+        /// used first.
+        std::list<TileKey> lru;
+        size_t memory_usage = 0;
+        DemTileCacheStatistics statistics;
+    };
+
+    DemTileCache::DemTileCache(size_t memory_budget,
+                               GridLib::Unit vertical_unit)
+        : m_Data(std::make_unique<Data>())
+    {
+        m_Data->vertical_unit = vertical_unit;
+        m_Data->memory_budget = memory_budget;
+    }
+
+    DemTileCache::~DemTileCache() = default;
+
+    std::shared_ptr<const GridLib::Grid>
+    DemTileCache::get(const std::string& file_name, const DemWindow& window)
+    {
+        auto& data = *m_Data;
+        auto path = normalize_path(file_name);
+        auto normalized = is_entire_grid(window)
+                          ? window
+                          : normalize_window(window,
+                                             data.get_grid_size(path));
+        TileKey key(path, normalized.row, normalized.column,
+                    normalized.row_count, normalized.column_count);
+
+        std::promise<TilePtr> promise;
+        {
+            std::unique_lock lock(data.mutex);
+            auto it = data.tiles.find(key);
+            if (it != data.tiles.end())
+            {
+                ++data.statistics.hits;
+                auto& tile = it->second;
+                if (tile.ready)
+                {
+                    data.lru.splice(data.lru.begin(), data.lru,
+                                    tile.lru_position);
+                    return tile.future.get();
+                }
+                // Another thread is reading the tile.
+                auto future = tile.future;
+                lock.unlock();
+                return future.get();
+            }
+
+            ++data.statistics.misses;
+            Tile tile;
+            tile.future = promise.get_future().share();
+            data.tiles.emplace(key, std::move(tile));
+        }
+
+        TilePtr result;
+        try
+        {
+            if (is_entire_grid(normalized))
+            {
+                result = std::make_shared<const GridLib::Grid>(
+                    read_dem_grid(path, data.vertical_unit));
+            }
+            else
+            {
+                result = std::make_shared<const GridLib::Grid>(
+                    read_dem_grid(path, data.vertical_unit, normalized));
+            }
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard lock(data.mutex);
+                data.tiles.erase(key);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+
+        {
+            std::lock_guard lock(data.mutex);
+            // clear() leaves tiles that are being read in the cache.
+            auto& tile = data.tiles.at(key);
+            tile.size = get_memory_usage(*result);
+            tile.ready = true;
+            tile.lru_position = data.lru.insert(data.lru.begin(), key);
+            data.memory_usage += tile.size;
+            data.evict(&key);
+        }
+        promise.set_value(result);
+        return result;
+    }
+
+    void DemTileCache::clear()
+    {
+        std::lock_guard lock(m_Data->mutex);
+        auto& tiles = m_Data->tiles;
+        for (auto it = tiles.begin(); it != tiles.end();)
+        {
+            if (it->second.ready)
+                it = tiles.erase(it);
+            else
+                ++it;
+        }
+        m_Data->lru.clear();
+        m_Data->grid_sizes.clear();
+        m_Data->memory_usage = 0;
+    }
+
+    size_t DemTileCache::memory_budget() const
+    {
+        std::lock_guard lock(m_Data->mutex);
+        return m_Data->memory_budget;
+    }
+
+    void DemTileCache::set_memory_budget(size_t memory_budget)
+    {
+        std::lock_guard lock(m_Data->mutex);
+        m_Data->memory_budget = memory_budget;
+        m_Data->evict(nullptr);
+    }
+
+    DemTileCacheStatistics DemTileCache::statistics() const
+    {
+        std::lock_guard lock(m_Data->mutex);
+        auto result = m_Data->statistics;
+        result.tile_count = m_Data->lru.size();
+        result.memory_usage = m_Data->memory_usage;
+        return result;
+    }
+}
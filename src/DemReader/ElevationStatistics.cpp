@@ -0,0 +1,364 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-29.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DemReader/ElevationStatistics.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include "DemReader/DemException.hpp"
+#include "GridMetadata.hpp"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define DEMREADER_SSE2
+#endif
+
+namespace Dem
+{
+    namespace
+    {
+        struct Summary
+        {
+            uint64_t voids = 0;
+            int32_t min = INT32_MAX;
+            int32_t max = INT32_MIN;
+            int64_t sum = 0;
+        };
+
+        template <typename T>
+        void summarize_scalar(const T* values, size_t count, Summary& s)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto v = int32_t(values[i]);
+                if (v == UNKNOWN_ELEVATION)
+                {
+                    ++s.voids;
+                    continue;
+                }
+                s.min = std::min(s.min, v);
+                s.max = std::max(s.max, v);
+                s.sum += v;
+            }
+        }
+
+    #if defined(__AVX2__) || defined(DEMREADER_SSE2)
+
+        /*
+         * The SIMD loops keep the void counts in 16 or 32-bit lanes and
+         * the sums in 32-bit lanes. Neither can overflow within this
+         * number of iterations, after which they are added to Summary.
+         */
+        constexpr size_t FLUSH_INTERVAL = 16384;
+
+        template <typename T, size_t N>
+        int64_t sum_lanes(const T (&lanes)[N])
+        {
+            int64_t sum = 0;
+            for (auto lane : lanes)
+                sum += lane;
+            return sum;
+        }
+
+    #endif
+
+    #if defined(__AVX2__)
+
+        template <typename T>
+        void store(T (&lanes)[32 / sizeof(T)], __m256i v)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), v);
+        }
+
+        void summarize(const int16_t* values, size_t count, Summary& s)
+        {
+            const auto void_value = _mm256_set1_epi16(UNKNOWN_ELEVATION);
+            const auto ones = _mm256_set1_epi16(1);
+            const auto highest = _mm256_set1_epi16(INT16_MAX);
+            const auto lowest = _mm256_set1_epi16(INT16_MIN);
+            auto min = highest;
+            auto max = lowest;
+            auto voids = _mm256_setzero_si256();
+            auto sum = _mm256_setzero_si256();
+            int16_t voids16[16];
+            int32_t sum32[8];
+
+            size_t i = 0;
+            size_t pending = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                auto v = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(values + i));
+                auto is_void = _mm256_cmpeq_epi16(v, void_value);
+                voids = _mm256_sub_epi16(voids, is_void);
+                min = _mm256_min_epi16(min, _mm256_blendv_epi8(v, highest,
+                                                               is_void));
+                max = _mm256_max_epi16(max, _mm256_blendv_epi8(v, lowest,
+                                                               is_void));
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(
+                    _mm256_andnot_si256(is_void, v), ones));
+                if (++pending == FLUSH_INTERVAL || i + 32 > count)
+                {
+                    store(voids16, voids);
+                    store(sum32, sum);
+                    s.voids += uint64_t(sum_lanes(voids16));
+                    s.sum += sum_lanes(sum32);
+                    voids = _mm256_setzero_si256();
+                    sum = _mm256_setzero_si256();
+                    pending = 0;
+                }
+            }
+
+            // The sentinels only affect the result if all values are
+            // voids, in which case min and max are not updated.
+            if (uint64_t(i) > s.voids)
+            {
+                int16_t lanes[16];
+                store(lanes, min);
+                s.min = std::min<int32_t>(s.min, *std::min_element(
+                    std::begin(lanes), std::end(lanes)));
+                store(lanes, max);
+                s.max = std::max<int32_t>(s.max, *std::max_element(
+                    std::begin(lanes), std::end(lanes)));
+            }
+            summarize_scalar(values + i, count - i, s);
+        }
+
+        void summarize(const int32_t* values, size_t count, Summary& s)
+        {
+            const auto void_value = _mm256_set1_epi32(UNKNOWN_ELEVATION);
+            const auto highest = _mm256_set1_epi32(INT32_MAX);
+            const auto lowest = _mm256_set1_epi32(INT32_MIN);
+            auto min = highest;
+            auto max = lowest;
+            auto voids = _mm256_setzero_si256();
+            auto sum = _mm256_setzero_si256();
+            int32_t lanes[8];
+
+            size_t i = 0;
+            size_t pending = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                auto v = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(values + i));
+                auto is_void = _mm256_cmpeq_epi32(v, void_value);
+                voids = _mm256_sub_epi32(voids, is_void);
+                min = _mm256_min_epi32(min, _mm256_blendv_epi8(v, highest,
+                                                               is_void));
+                max = _mm256_max_epi32(max, _mm256_blendv_epi8(v, lowest,
+                                                               is_void));
+                sum = _mm256_add_epi32(sum, _mm256_andnot_si256(is_void, v));
+                if (++pending == FLUSH_INTERVAL || i + 16 > count)
+                {
+                    store(lanes, voids);
+                    s.voids += uint64_t(sum_lanes(lanes));
+                    store(lanes, sum);
+                    s.sum += sum_lanes(lanes);
+                    voids = _mm256_setzero_si256();
+                    sum = _mm256_setzero_si256();
+                    pending = 0;
+                }
+            }
+
+            store(lanes, min);
+            s.min = std::min(s.min, *std::min_element(std::begin(lanes),
+                                                      std::end(lanes)));
+            store(lanes, max);
+            s.max = std::max(s.max, *std::max_element(std::begin(lanes),
+                                                      std::end(lanes)));
+            summarize_scalar(values + i, count - i, s);
+        }
+
+    #elif defined(DEMREADER_SSE2)
+
+        template <typename T>
+        void store(T (&lanes)[16 / sizeof(T)], __m128i v)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), v);
+        }
+
+        __m128i select(__m128i mask, __m128i a, __m128i b)
+        {
+            return _mm_or_si128(_mm_and_si128(mask, a),
+                                _mm_andnot_si128(mask, b));
+        }
+
+        void summarize(const int16_t* values, size_t count, Summary& s)
+        {
+            const auto void_value = _mm_set1_epi16(UNKNOWN_ELEVATION);
+            const auto ones = _mm_set1_epi16(1);
+            const auto highest = _mm_set1_epi16(INT16_MAX);
+            const auto lowest = _mm_set1_epi16(INT16_MIN);
+            auto min = highest;
+            auto max = lowest;
+            auto voids = _mm_setzero_si128();
+            auto sum = _mm_setzero_si128();
+            int16_t voids16[8];
+            int32_t sum32[4];
+
+            size_t i = 0;
+            size_t pending = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                auto v = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(values + i));
+                auto is_void = _mm_cmpeq_epi16(v, void_value);
+                voids = _mm_sub_epi16(voids, is_void);
+                min = _mm_min_epi16(min, select(is_void, highest, v));
+                max = _mm_max_epi16(max, select(is_void, lowest, v));
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(
+                    _mm_andnot_si128(is_void, v), ones));
+                if (++pending == FLUSH_INTERVAL || i + 16 > count)
+                {
+                    store(voids16, voids);
+                    store(sum32, sum);
+                    s.voids += uint64_t(sum_lanes(voids16));
+                    s.sum += sum_lanes(sum32);
+                    voids = _mm_setzero_si128();
+                    sum = _mm_setzero_si128();
+                    pending = 0;
+                }
+            }
+
+            // The sentinels only affect the result if all values are
+            // voids, in which case min and max are not updated.
+            if (uint64_t(i) > s.voids)
+            {
+                int16_t lanes[8];
+                store(lanes, min);
+                s.min = std::min<int32_t>(s.min, *std::min_element(
+                    std::begin(lanes), std::end(lanes)));
+                store(lanes, max);
+                s.max = std::max<int32_t>(s.max, *std::max_element(
+                    std::begin(lanes), std::end(lanes)));
+            }
+            summarize_scalar(values + i, count - i, s);
+        }
+
+        // SSE2 lacks 32-bit min and max.
+        void summarize(const int32_t* values, size_t count, Summary& s)
+        {
+            summarize_scalar(values, count, s);
+        }
+
+    #else
+
+        template <typename T>
+        void summarize(const T* values, size_t count, Summary& s)
+        {
+            summarize_scalar(values, count, s);
+        }
+
+    #endif
+    }
+
+    ElevationStatistics::ElevationStatistics(unsigned histogram_bin_size)
+        : m_HistogramBinSize(histogram_bin_size)
+    {
+        if (m_HistogramBinSize != 0)
+            m_Histogram.resize((65536 + m_HistogramBinSize - 1)
+                               / m_HistogramBinSize);
+    }
+
+    void ElevationStatistics::add(const int16_t* values, size_t count)
+    {
+        add_values(values, count);
+    }
+
+    void ElevationStatistics::add(const int32_t* values, size_t count)
+    {
+        add_values(values, count);
+    }
+
+    void ElevationStatistics::add(const ElevationStatistics& other)
+    {
+        if (other.m_HistogramBinSize != m_HistogramBinSize)
+            DEM_THROW("The histograms have different bin sizes.");
+        m_Count += other.m_Count;
+        m_VoidCount += other.m_VoidCount;
+        m_Min = std::min(m_Min, other.m_Min);
+        m_Max = std::max(m_Max, other.m_Max);
+        m_Sum += other.m_Sum;
+        for (size_t i = 0; i < m_Histogram.size(); ++i)
+            m_Histogram[i] += other.m_Histogram[i];
+    }
+
+    void ElevationStatistics::clear()
+    {
+        *this = ElevationStatistics(m_HistogramBinSize);
+    }
+
+    uint64_t ElevationStatistics::count() const
+    {
+        return m_Count;
+    }
+
+    uint64_t ElevationStatistics::void_count() const
+    {
+        return m_VoidCount;
+    }
+
+    std::optional<int16_t> ElevationStatistics::min() const
+    {
+        if (m_Count == 0)
+            return {};
+        return int16_t(m_Min);
+    }
+
+    std::optional<int16_t> ElevationStatistics::max() const
+    {
+        if (m_Count == 0)
+            return {};
+        return int16_t(m_Max);
+    }
+
+    int64_t ElevationStatistics::sum() const
+    {
+        return m_Sum;
+    }
+
+    std::optional<double> ElevationStatistics::mean() const
+    {
+        if (m_Count == 0)
+            return {};
+        return double(m_Sum) / double(m_Count);
+    }
+
+    unsigned ElevationStatistics::histogram_bin_size() const
+    {
+        return m_HistogramBinSize;
+    }
+
+    const std::vector<uint64_t>& ElevationStatistics::histogram() const
+    {
+        return m_Histogram;
+    }
+
+    template <typename T>
+    void ElevationStatistics::add_values(const T* values, size_t count)
+    {
+        Summary s;
+        summarize(values, count, s);
+        m_Count += count - s.voids;
+        m_VoidCount += s.voids;
+        m_Min = std::min(m_Min, s.min);
+        m_Max = std::max(m_Max, s.max);
+        m_Sum += s.sum;
+
+        // The values were just summarized and are still in the cache.
+        if (m_Histogram.empty())
+            return;
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto v = int32_t(values[i]);
+            if (v != UNKNOWN_ELEVATION)
+                ++m_Histogram[size_t(v - INT16_MIN) / m_HistogramBinSize];
+        }
+    }
+}
@@ -37,6 +37,11 @@ namespace Dem
           m_Stream(&stream)
     {}
 
+    FortranReader::FortranReader(const char* data, size_t size)
+        : m_Str(data, size),
+          m_Memory(data, size)
+    {}
+
     std::optional<char> FortranReader::read_char()
     {
         auto str = read_string(1);
@@ -57,6 +62,12 @@ namespace Dem
         return trimSpaces ? trim(result) : result;
     }
 
+    std::string_view FortranReader::peek_string(size_t size)
+    {
+        fill_buffer(size);
+        return m_Str.substr(0, std::min(size, m_Str.size()));
+    }
+
     std::optional<int8_t> FortranReader::read_int8(size_t size)
     {
         return read_int<int8_t>(size);
@@ -82,29 +93,44 @@ namespace Dem
         return read_float<double>(size);
     }
 
+    void FortranReader::read_float64s(size_t size, size_t count,
+                                      std::optional<double>* values)
+    {
+        auto str = read_string(size * count, false);
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto field = trim(str.substr(i * size, size));
+            if (field.empty())
+            {
+                values[i] = {};
+                continue;
+            }
+            double n;
+            if (!parse(field, n))
+                DEM_THROW("Invalid floating point number");
+            values[i] = n;
+        }
+    }
+
     bool FortranReader::fill_buffer(size_t size)
     {
-        if (!m_Stream || !*m_Stream)
-            return false;
         if (m_Str.size() >= size)
             return true;
-        if (m_Str.data() != m_Buffer.data())
-        {
-            std::copy(m_Str.begin(), m_Str.end(),
-                      m_Buffer.begin());
-            m_Str = {m_Buffer.data(), m_Str.size()};
-        }
+        if (!m_Stream || !*m_Stream)
+            return false;
+
+        // Move the unread bytes to the front of the buffer. This must be
+        // done before the buffer is resized as resizing can move it.
+        auto remaining = m_Str.size();
+        if (remaining != 0 && m_Str.data() != m_Buffer.data())
+            std::copy(m_Str.begin(), m_Str.end(), m_Buffer.begin());
         if (m_Buffer.size() < size)
-        {
-            auto prevSize = m_Buffer.size();
             m_Buffer.resize(size);
-            m_Str = {m_Buffer.data(), prevSize};
-        }
-        auto bytesToRead = m_Buffer.size() - m_Str.size();
-        m_Stream->read(m_Buffer.data() + m_Str.size(), bytesToRead);
+
+        m_Stream->read(m_Buffer.data() + remaining,
+                       std::streamsize(m_Buffer.size() - remaining));
         auto bytesRead = size_t(m_Stream->gcount());
-        m_Buffer.resize(m_Str.size() + bytesRead);
-        m_Str = {m_Buffer.data(), m_Buffer.size()};
+        m_Str = {m_Buffer.data(), remaining + bytesRead};
         return bytesRead != 0;
     }
 
@@ -121,33 +147,87 @@ namespace Dem
             return;
         }
 
+        if (!m_Stream)
+            DEM_THROW("End of file reached.");
+
         size -= m_Str.size();
         m_Str = {};
         auto start = std::streamoff(m_Stream->tellg());
-        m_Stream->seekg(size, std::ios::cur);
-        auto end = std::streamoff(m_Stream->tellg());
-        if (size_t(end - start) != size)
+        if (start >= 0 && m_Stream->seekg(size, std::ios::cur))
+        {
+            auto end = std::streamoff(m_Stream->tellg());
+            if (size_t(end - start) != size)
+                DEM_THROW("End of file reached.");
+            return;
+        }
+
+        // The stream can't seek, e.g. a pipe or decompressed data.
+        m_Stream->clear(m_Stream->rdstate() & ~std::ios::failbit);
+        m_Stream->ignore(std::streamsize(size));
+        if (size_t(m_Stream->gcount()) != size)
             DEM_THROW("End of file reached.");
     }
 
     bool FortranReader::seek(std::streamoff pos, std::ios_base::seekdir dir)
     {
+        if (!m_Stream)
+            return seek_memory(pos, dir);
+
         if (dir == std::ios_base::cur)
         {
-            if (pos <= m_Str.size())
+            if (0 <= pos && size_t(pos) <= m_Str.size())
             {
                 m_Str = m_Str.substr(pos);
                 return true;
             }
-            pos -= m_Str.size();
+            pos -= std::streamoff(m_Str.size());
+        }
+        // Reading the final bytes of the stream sets eofbit and failbit,
+        // which must be cleared before seekg can succeed.
+        auto state = m_Stream->rdstate();
+        m_Stream->clear();
+        if (!m_Stream->seekg(pos, dir))
+        {
+            // The stream can't seek. Its position hasn't changed, so
+            // the buffered data are still valid.
+            m_Stream->clear(state);
+            return false;
         }
         m_Str = {};
-        return bool(m_Stream->seekg(pos));
+        return true;
     }
 
     std::streamsize FortranReader::tell() const
     {
-        return std::streamsize(m_Stream->tellg()) - m_Str.size();
+        if (!m_Stream)
+            return std::streamsize(m_Str.data() - m_Memory.data());
+
+        // tellg fails when eofbit is set, which is the normal state once
+        // the final block has been read into the buffer.
+        auto state = m_Stream->rdstate();
+        if (state & std::ios_base::eofbit)
+            m_Stream->clear();
+        auto pos = std::streamsize(m_Stream->tellg());
+        m_Stream->setstate(state);
+        if (pos < 0)
+            return pos;
+        return pos - std::streamsize(m_Str.size());
+    }
+
+    bool FortranReader::seek_memory(std::streamoff pos,
+                                    std::ios_base::seekdir dir)
+    {
+        std::streamoff origin = 0;
+        if (dir == std::ios_base::cur)
+            origin = tell();
+        else if (dir == std::ios_base::end)
+            origin = std::streamoff(m_Memory.size());
+
+        auto newPos = origin + pos;
+        if (newPos < 0 || size_t(newPos) > m_Memory.size())
+            return false;
+        m_Str = m_Memory.substr(size_t(newPos));
+        return true;
     }
 
     template <typename T>
@@ -170,7 +250,7 @@ namespace Dem
             return {};
         T n;
         if (!parse(str, n))
-            DEM_THROW("Invalid integer");
+            DEM_THROW("Invalid floating point number");
         return std::optional<T>(n);
     }
 }
@@ -23,8 +23,21 @@ namespace Dem
         explicit FortranReader(std::istream& stream,
                                size_t bufferSize = 8192);
 
+        /**
+         * @brief Reads directly from the @a size bytes at @a data.
+         *
+         * No data are copied, the memory must remain valid for as long
+         * as the reader is in use.
+         */
+        FortranReader(const char* data, size_t size);
+
         std::string_view read_string(size_t size, bool trimSpaces = true);
 
+        /**
+         * @brief Returns up to @a size bytes without consuming them.
+         */
+        std::string_view peek_string(size_t size);
+
         std::optional<char> read_char();
 
         std::optional<int8_t> read_int8(size_t size);
@@ -37,6 +50,16 @@ namespace Dem
 
         std::optional<double> read_float64(size_t size);
 
+        /**
+         * @brief Reads @a count adjacent fields of @a size characters
+         *  into @a values.
+         *
+         * Faster than calling read_float64 @a count times as the buffer
+         * is only checked once. Blank fields become empty optionals.
+         */
+        void read_float64s(size_t size, size_t count,
+                           std::optional<double>* values);
+
         void skip(size_t size);
 
         [[nodiscard]]
@@ -49,6 +72,8 @@ namespace Dem
         [[nodiscard]]
         std::streamsize tell() const;
     private:
+        bool seek_memory(std::streamoff pos, std::ios_base::seekdir dir);
+
         template <typename T>
         std::optional<T> read_int(size_t size);
 
@@ -58,5 +83,6 @@ namespace Dem
         std::istream* m_Stream = nullptr;
         std::string_view m_Str;
         std::vector<char> m_Buffer;
+        std::string_view m_Memory;
     };
 }
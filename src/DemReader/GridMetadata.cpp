@@ -0,0 +1,139 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-21.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "GridMetadata.hpp"
+
+namespace Dem
+{
+    constexpr float METERS_PER_FOOT = 0.3048;
+
+    GridLib::Unit fromDemUnit(int16_t unit)
+    {
+        switch (unit)
+        {
+        case 1:
+            return GridLib::Unit::FEET;
+        case 2:
+            return GridLib::Unit::METERS;
+        case 3:
+            return GridLib::Unit::ARC_SECONDS;
+        default:
+            return GridLib::Unit::UNDEFINED;
+        }
+    }
+
+    GridInfo get_grid_info(const RecordA& a, GridLib::Unit desired_unit)
+    {
+        GridInfo info;
+        auto& hUnit = info.horizontal_unit;
+        auto& cRes = info.column_resolution;
+        auto& rRes = info.row_resolution;
+        auto& vUnit = info.vertical_unit;
+        auto& vRes = info.vertical_resolution;
+        auto& factor = info.factor;
+
+        hUnit = fromDemUnit(a.horizontal_unit.value_or(0));
+        cRes = a.x_resolution.value_or(1.0);
+        rRes = a.y_resolution.value_or(1.0);
+        vUnit = fromDemUnit(a.vertical_unit.value_or(0));
+        vRes = a.z_resolution.value_or(1.0);
+
+        if (a.longitude && a.latitude)
+        {
+            info.spherical_coords = {to_degrees(*a.latitude),
+                                     to_degrees(*a.longitude)};
+        }
+        if (const auto& c = a.quadrangle_corners[0])
+        {
+            info.planar_coords = {c->easting, c->northing};
+            info.zone = a.ref_sys_zone.value_or(0);
+        }
+        info.horizontal_datum = a.horizontal_datum;
+        info.vertical_datum = a.vertical_datum.value_or(0);
+        info.rotation_angle = a.rotation_angle.value_or(0);
+
+        if (desired_unit == GridLib::Unit::METERS)
+        {
+            if (vUnit == GridLib::Unit::FEET)
+            {
+                factor = vRes * METERS_PER_FOOT;
+                vRes = 1.0;
+                vUnit = GridLib::Unit::METERS;
+            }
+            else
+            {
+                factor = vRes;
+                vRes = 1.0;
+            }
+
+            if (hUnit == GridLib::Unit::FEET)
+            {
+                rRes *= METERS_PER_FOOT;
+                cRes *= METERS_PER_FOOT;
+                hUnit = GridLib::Unit::METERS;
+            }
+        }
+        else if (desired_unit == GridLib::Unit::FEET)
+        {
+            if (vUnit == GridLib::Unit::METERS)
+            {
+                factor = vRes / METERS_PER_FOOT;
+                vRes = 1.0;
+                vUnit = GridLib::Unit::FEET;
+            }
+            else
+            {
+                factor = vRes;
+                vRes = 1.0;
+            }
+
+            if (hUnit == GridLib::Unit::METERS)
+            {
+                rRes *= 1.0 / METERS_PER_FOOT;
+                cRes *= 1.0 / METERS_PER_FOOT;
+                hUnit = GridLib::Unit::FEET;
+            }
+        }
+        return info;
+    }
+
+    double initialize_grid(GridLib::Grid& grid, const RecordA& a,
+                           GridLib::Unit desired_unit)
+    {
+        auto info = get_grid_info(a, desired_unit);
+        if (const auto& c = info.spherical_coords)
+        {
+            grid.setSphericalCoords(GridLib::SphericalCoords{c->first,
+                                                             c->second});
+        }
+        if (const auto& c = info.planar_coords)
+        {
+            grid.setPlanarCoords(GridLib::PlanarCoords{c->first, c->second,
+                                                       info.zone});
+        }
+        if (info.horizontal_datum)
+        {
+            grid.setReferenceSystem(
+                GridLib::ReferenceSystem{*info.horizontal_datum,
+                                         info.vertical_datum});
+        }
+        grid.setVerticalAxis({info.vertical_resolution, info.vertical_unit});
+        grid.setRowAxis({info.row_resolution, info.horizontal_unit});
+        grid.setColumnAxis({info.column_resolution, info.horizontal_unit});
+        grid.setRotationAngle(info.rotation_angle);
+        grid.setUnknownElevation(UNKNOWN_ELEVATION * info.factor);
+        return info.factor;
+    }
+
+    int get_row_count(const RecordA& a, int first_b_rows)
+    {
+        auto rows = a.rows.value_or(1);
+        if (rows == 1)
+            rows = first_b_rows;
+        return rows;
+    }
+}
@@ -0,0 +1,65 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-21.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <GridLib/Grid.hpp>
+#include "DemReader/RecordA.hpp"
+
+namespace Dem
+{
+    /**
+     * @brief The raw elevation DEM files use for unknown values.
+     */
+    constexpr int16_t UNKNOWN_ELEVATION = -32767;
+
+    GridLib::Unit fromDemUnit(int16_t unit);
+
+    /**
+     * @brief The grid metadata in record A with the units and
+     *  resolutions adjusted to the desired vertical unit.
+     */
+    struct GridInfo
+    {
+        GridLib::Unit horizontal_unit = GridLib::Unit::UNDEFINED;
+        GridLib::Unit vertical_unit = GridLib::Unit::UNDEFINED;
+        /// The distance between the elevations in a profile.
+        double row_resolution = 1.0;
+        /// The distance between the profiles.
+        double column_resolution = 1.0;
+        double vertical_resolution = 1.0;
+        /// The latitude and longitude in degrees.
+        std::optional<std::pair<double, double>> spherical_coords;
+        /// The easting and northing of the south-west corner.
+        std::optional<std::pair<double, double>> planar_coords;
+        int zone = 0;
+        std::optional<int> horizontal_datum;
+        int vertical_datum = 0;
+        double rotation_angle = 0;
+        /// Converts raw elevations to the vertical unit.
+        double factor = 1.0;
+    };
+
+    GridInfo get_grid_info(const RecordA& a, GridLib::Unit desired_unit);
+
+    /**
+     * @brief Sets the grid's metadata from record A and returns the
+     *  factor that converts raw elevations to @a desired_unit.
+     */
+    double initialize_grid(GridLib::Grid& grid, const RecordA& a,
+                           GridLib::Unit desired_unit);
+
+    /**
+     * @brief Returns the number of elevations in each profile.
+     *
+     * Record A often has 1 as its row count, the number of rows in the
+     * first record of type B is used instead.
+     */
+    int get_row_count(const RecordA& a, int first_b_rows);
+}
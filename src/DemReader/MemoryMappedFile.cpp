@@ -0,0 +1,157 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-02-06.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "MemoryMappedFile.hpp"
+
+#include <utility>
+#include "DemReader/DemException.hpp"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace Dem
+{
+    MemoryMappedFile::MemoryMappedFile() = default;
+
+#ifdef _WIN32
+
+    MemoryMappedFile::MemoryMappedFile(const std::string& file_name,
+                                       FileAccess)
+    {
+        auto file = CreateFileA(file_name.c_str(), GENERIC_READ,
+                                FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            DEM_THROW_STRING(std::string("Can not open ") + file_name);
+        m_FileHandle = file;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            close();
+            DEM_THROW_STRING(std::string("Can not get the size of ")
+                             + file_name);
+        }
+        m_Size = size_t(size.QuadPart);
+        if (m_Size == 0)
+            return;
+
+        m_MappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY,
+                                             0, 0, nullptr);
+        if (!m_MappingHandle)
+        {
+            close();
+            DEM_THROW_STRING(std::string("Can not map ") + file_name);
+        }
+
+        m_Data = static_cast<const char*>(
+            MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (!m_Data)
+        {
+            close();
+            DEM_THROW_STRING(std::string("Can not map ") + file_name);
+        }
+    }
+
+    void MemoryMappedFile::close()
+    {
+        if (m_Data)
+            UnmapViewOfFile(m_Data);
+        if (m_MappingHandle)
+            CloseHandle(m_MappingHandle);
+        if (m_FileHandle)
+            CloseHandle(m_FileHandle);
+        m_Data = nullptr;
+        m_Size = 0;
+        m_MappingHandle = nullptr;
+        m_FileHandle = nullptr;
+    }
+
+#else
+
+    MemoryMappedFile::MemoryMappedFile(const std::string& file_name,
+                                       FileAccess access)
+    {
+        auto fd = open(file_name.c_str(), O_RDONLY);
+        if (fd == -1)
+            DEM_THROW_STRING(std::string("Can not open ") + file_name);
+
+        struct stat info = {};
+        if (fstat(fd, &info) == -1)
+        {
+            ::close(fd);
+            DEM_THROW_STRING(std::string("Can not get the size of ")
+                             + file_name);
+        }
+
+        m_Size = size_t(info.st_size);
+        if (m_Size != 0)
+        {
+            auto ptr = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED)
+            {
+                ::close(fd);
+                DEM_THROW_STRING(std::string("Can not map ") + file_name);
+            }
+            m_Data = static_cast<const char*>(ptr);
+            if (access == FileAccess::SEQUENTIAL)
+                madvise(ptr, m_Size, MADV_SEQUENTIAL);
+        }
+        // The mapping remains valid after the file descriptor is closed.
+        ::close(fd);
+    }
+
+    void MemoryMappedFile::close()
+    {
+        if (m_Data)
+            munmap(const_cast<char*>(m_Data), m_Size);
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+
+#endif
+
+    MemoryMappedFile::MemoryMappedFile(MemoryMappedFile&& rhs) noexcept
+        : MemoryMappedFile()
+    {
+        *this = std::move(rhs);
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        close();
+    }
+
+    MemoryMappedFile&
+    MemoryMappedFile::operator=(MemoryMappedFile&& rhs) noexcept
+    {
+        std::swap(m_Data, rhs.m_Data);
+        std::swap(m_Size, rhs.m_Size);
+    #ifdef _WIN32
+        std::swap(m_FileHandle, rhs.m_FileHandle);
+        std::swap(m_MappingHandle, rhs.m_MappingHandle);
+    #endif
+        return *this;
+    }
+
+    const char* MemoryMappedFile::data() const
+    {
+        return m_Data;
+    }
+
+    size_t MemoryMappedFile::size() const
+    {
+        return m_Size;
+    }
+}
@@ -0,0 +1,60 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-02-06.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace Dem
+{
+    /**
+     * @brief Tells the operating system how a memory-mapped file will
+     *  be read. It is passed to madvise, and ignored on Windows.
+     */
+    enum class FileAccess
+    {
+        /// The default read-ahead, suitable for random access.
+        NORMAL,
+        /// The file is read once from start to end. Pages are read far
+        /// ahead and may be dropped soon after they have been read.
+        SEQUENTIAL
+    };
+
+    /**
+     * @brief A read-only view of the contents of a file that is mapped
+     *  into memory.
+     */
+    class MemoryMappedFile
+    {
+    public:
+        MemoryMappedFile();
+
+        explicit MemoryMappedFile(const std::string& file_name,
+                                  FileAccess access = FileAccess::NORMAL);
+
+        MemoryMappedFile(MemoryMappedFile&& rhs) noexcept;
+
+        ~MemoryMappedFile();
+
+        MemoryMappedFile& operator=(MemoryMappedFile&& rhs) noexcept;
+
+        [[nodiscard]]
+        const char* data() const;
+
+        [[nodiscard]]
+        size_t size() const;
+    private:
+        void close();
+
+        const char* m_Data = nullptr;
+        size_t m_Size = 0;
+    #ifdef _WIN32
+        void* m_FileHandle = nullptr;
+        void* m_MappingHandle = nullptr;
+    #endif
+    };
+}
@@ -0,0 +1,57 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-06.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DemReader/NorthUp.hpp"
+
+#include <algorithm>
+
+namespace Dem
+{
+    namespace
+    {
+        constexpr size_t BLOCK_SIZE = 64;
+
+        template <typename T>
+        Chorasmia::Array2D<T>
+        to_north_up_impl(const Chorasmia::ArrayView2D<T>& values)
+        {
+            auto rows = values.rowCount();
+            auto cols = values.columnCount();
+            Chorasmia::Array2D<T> result(cols, rows);
+            auto dst = result.data();
+
+            // values(i, j) goes to result(cols - 1 - j, i).
+            for (size_t i0 = 0; i0 < rows; i0 += BLOCK_SIZE)
+            {
+                auto i1 = std::min(i0 + BLOCK_SIZE, rows);
+                for (size_t j0 = 0; j0 < cols; j0 += BLOCK_SIZE)
+                {
+                    auto j1 = std::min(j0 + BLOCK_SIZE, cols);
+                    for (size_t j = j0; j < j1; ++j)
+                    {
+                        auto dst_row = dst + (cols - 1 - j) * rows;
+                        for (size_t i = i0; i < i1; ++i)
+                            dst_row[i] = values(i, j);
+                    }
+                }
+            }
+            return result;
+        }
+    }
+
+    Chorasmia::Array2D<double>
+    to_north_up(const Chorasmia::ArrayView2D<double>& values)
+    {
+        return to_north_up_impl(values);
+    }
+
+    Chorasmia::Array2D<int16_t>
+    to_north_up(const Chorasmia::ArrayView2D<int16_t>& values)
+    {
+        return to_north_up_impl(values);
+    }
+}
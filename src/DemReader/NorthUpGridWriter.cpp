@@ -0,0 +1,405 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-22.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DemReader/NorthUpGridWriter.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include "DemReader/DemException.hpp"
+#include "DemReader/DemReader.hpp"
+#include "GridMetadata.hpp"
+#include "ScaleElevations.hpp"
+
+namespace Dem
+{
+    namespace
+    {
+        std::string make_scratch_file_name(const std::string& directory)
+        {
+            std::filesystem::path path = directory.empty()
+                                         ? std::filesystem::temp_directory_path()
+                                         : std::filesystem::path(directory);
+            std::random_device device;
+            std::uniform_int_distribution<uint64_t> distribution;
+            char name[40];
+            snprintf(name, sizeof(name), "DemReader-%016llx.tmp",
+                     static_cast<unsigned long long>(distribution(device)));
+            return (path / name).string();
+        }
+
+        void write_json_value(std::ostream& stream, double value)
+        {
+            char buffer[32];
+            auto size = snprintf(buffer, sizeof(buffer), "%.15g", value);
+            stream.write(buffer, size);
+        }
+
+        const char* get_unit_name(GridLib::Unit unit)
+        {
+            switch (unit)
+            {
+            case GridLib::Unit::METERS:
+                return "METERS";
+            case GridLib::Unit::FEET:
+                return "FEET";
+            case GridLib::Unit::ARC_SECONDS:
+                return "ARC_SECONDS";
+            default:
+                return "UNDEFINED";
+            }
+        }
+
+        void write_json_axis(std::ostream& stream, const char* name,
+                             double resolution, GridLib::Unit unit)
+        {
+            stream << ",\n \"" << name << "\": {\"resolution\": ";
+            write_json_value(stream, resolution);
+            stream << ", \"unit\": \"" << get_unit_name(unit) << "\"}";
+        }
+
+        template <typename T>
+        void write_binary_value(std::ostream& stream, T value)
+        {
+            stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+    }
+
+    struct NorthUpGridWriter::Data
+    {
+        Data(std::ostream& stream, GridFileFormat format,
+             const RecordA& record_a, GridLib::Unit vertical_unit,
+             size_t profile_count, size_t profile_length,
+             const NorthUpGridWriterOptions& options)
+            : stream(stream),
+              format(format),
+              info(get_grid_info(record_a, vertical_unit)),
+              profile_count(profile_count),
+              profile_length(profile_length),
+              factor(info.factor),
+              options(options)
+        {
+            auto profile_size = std::max<size_t>(profile_length, 1)
+                                * sizeof(int16_t);
+            band_width = std::clamp<size_t>(options.memory_budget
+                                            / profile_size,
+                                            1, std::max<size_t>(profile_count, 1));
+            start_band(0);
+        }
+
+        ~Data()
+        {
+            if (!scratch_name.empty())
+            {
+                scratch.close();
+                std::error_code ec;
+                std::filesystem::remove(scratch_name, ec);
+            }
+        }
+
+        [[nodiscard]]
+        size_t get_band_width(size_t start) const
+        {
+            return std::min(band_width, profile_count - start);
+        }
+
+        void start_band(size_t start)
+        {
+            band_start = start;
+            band.assign(profile_length * get_band_width(start),
+                        UNKNOWN_ELEVATION);
+        }
+
+        void flush_band()
+        {
+            if (scratch_name.empty())
+            {
+                scratch_name = make_scratch_file_name(
+                    options.scratch_directory);
+                scratch.open(scratch_name, std::ios::in | std::ios::out
+                                           | std::ios::trunc
+                                           | std::ios::binary);
+                if (!scratch)
+                {
+                    DEM_THROW_STRING(std::string("Can not create scratch file ")
+                                     + scratch_name);
+                }
+            }
+
+            band_offsets.push_back(scratch.tellp());
+            scratch.write(reinterpret_cast<const char*>(band.data()),
+                          std::streamsize(band.size() * sizeof(int16_t)));
+            if (!scratch)
+                DEM_THROW("Unable to write to the scratch file.");
+            start_band(band_start + get_band_width(band_start));
+        }
+
+        void write_header()
+        {
+            if (format == GridFileFormat::BINARY)
+            {
+                stream.write(BINARY_GRID_MAGIC, sizeof(BINARY_GRID_MAGIC));
+                write_binary_value(stream, uint64_t(profile_length));
+                write_binary_value(stream, uint64_t(profile_count));
+                write_binary_value(stream, UNKNOWN_ELEVATION * factor);
+                return;
+            }
+
+            // The profiles are the columns of the output, the distance
+            // between the values in each row is therefore the distance
+            // between the profiles.
+            stream << "{\"row_count\": " << profile_length
+                   << ",\n \"column_count\": " << profile_count;
+            write_json_axis(stream, "row_axis", info.column_resolution,
+                            info.horizontal_unit);
+            write_json_axis(stream, "column_axis", info.row_resolution,
+                            info.horizontal_unit);
+            write_json_axis(stream, "vertical_axis",
+                            info.vertical_resolution, info.vertical_unit);
+            if (const auto& c = info.spherical_coords)
+            {
+                stream << ",\n \"spherical_coords\": {\"latitude\": ";
+                write_json_value(stream, c->first);
+                stream << ", \"longitude\": ";
+                write_json_value(stream, c->second);
+                stream << '}';
+            }
+            if (const auto& c = info.planar_coords)
+            {
+                stream << ",\n \"planar_coords\": {\"easting\": ";
+                write_json_value(stream, c->first);
+                stream << ", \"northing\": ";
+                write_json_value(stream, c->second);
+                stream << ", \"zone\": " << info.zone << '}';
+            }
+            if (info.horizontal_datum)
+            {
+                stream << ",\n \"reference_system\": {\"horizontal\": "
+                       << *info.horizontal_datum
+                       << ", \"vertical\": " << info.vertical_datum << '}';
+            }
+            stream << ",\n \"rotation_angle\": ";
+            write_json_value(stream, info.rotation_angle);
+            stream << ",\n \"unknown_elevation\": ";
+            write_json_value(stream, UNKNOWN_ELEVATION * factor);
+            stream << ",\n \"elevations\": [";
+        }
+
+        void write_row(const int16_t* values, size_t row)
+        {
+            row_buffer.resize(profile_count);
+            scale_elevations(values, profile_count, factor,
+                             row_buffer.data());
+            if (format == GridFileFormat::BINARY)
+            {
+                stream.write(reinterpret_cast<const char*>(row_buffer.data()),
+                             std::streamsize(row_buffer.size()
+                                             * sizeof(double)));
+                return;
+            }
+
+            stream << (row == 0 ? "\n  [" : ",\n  [");
+            for (size_t i = 0; i < row_buffer.size(); ++i)
+            {
+                if (i != 0)
+                    stream << ", ";
+                write_json_value(stream, row_buffer[i]);
+            }
+            stream << ']';
+        }
+
+        void write_footer()
+        {
+            if (format == GridFileFormat::JSON)
+                stream << "\n]}\n";
+        }
+
+        /**
+         * @brief Writes the rows from the bands in the scratch file,
+         *  reading as many rows as fit within the memory budget from
+         *  each band at a time.
+         */
+        void write_rows_from_scratch()
+        {
+            auto row_size = std::max<size_t>(profile_count, 1)
+                            * sizeof(int16_t);
+            auto block_rows = std::clamp<size_t>(options.memory_budget
+                                                 / row_size,
+                                                 1, profile_length);
+            std::vector<int16_t> block(block_rows * profile_count);
+            std::vector<int16_t> band_rows;
+
+            for (size_t r0 = 0; r0 < profile_length; r0 += block_rows)
+            {
+                auto n = std::min(block_rows, profile_length - r0);
+                for (size_t k = 0; k < band_offsets.size(); ++k)
+                {
+                    auto start = k * band_width;
+                    auto width = get_band_width(start);
+                    band_rows.resize(n * width);
+                    auto offset = band_offsets[k]
+                                  + std::streamoff(r0 * width
+                                                   * sizeof(int16_t));
+                    scratch.seekg(offset);
+                    scratch.read(reinterpret_cast<char*>(band_rows.data()),
+                                 std::streamsize(band_rows.size()
+                                                 * sizeof(int16_t)));
+                    if (!scratch)
+                        DEM_THROW("Unable to read from the scratch file.");
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        std::copy_n(band_rows.data() + i * width, width,
+                                    block.data() + i * profile_count + start);
+                    }
+                }
+
+                for (size_t i = 0; i < n; ++i)
+                    write_row(block.data() + i * profile_count, r0 + i);
+            }
+        }
+
+        std::ostream& stream;
+        GridFileFormat format;
+        GridInfo info;
+        size_t profile_count;
+        size_t profile_length;
+        double factor;
+        NorthUpGridWriterOptions options;
+
+        /// The number of profiles in each band, except possibly the last.
+        size_t band_width = 1;
+        /// The index of the first profile in the current band.
+        size_t band_start = 0;
+        /// The elevations of the current band, north-up and row-major.
+        std::vector<int16_t> band;
+        /// The positions of the completed bands in the scratch file.
+        std::vector<std::streamoff> band_offsets;
+        std::string scratch_name;
+        std::fstream scratch;
+        std::vector<double> row_buffer;
+        bool finished = false;
+    };
+
+    NorthUpGridWriter::NorthUpGridWriter(
+        std::ostream& stream, GridFileFormat format,
+        const RecordA& record_a, GridLib::Unit vertical_unit,
+        size_t profile_count, size_t profile_length,
+        const NorthUpGridWriterOptions& options)
+        : m_Data(std::make_unique<Data>(stream, format, record_a,
+                                        vertical_unit, profile_count,
+                                        profile_length, options))
+    {}
+
+    NorthUpGridWriter::NorthUpGridWriter(NorthUpGridWriter&& rhs) noexcept
+        = default;
+
+    NorthUpGridWriter::~NorthUpGridWriter() = default;
+
+    NorthUpGridWriter&
+    NorthUpGridWriter::operator=(NorthUpGridWriter&& rhs) noexcept = default;
+
+    void NorthUpGridWriter::add_record_b(const RecordB& record,
+                                         const std::vector<int16_t>& elevations)
+    {
+        auto& data = *m_Data;
+        if (data.finished)
+            DEM_THROW("The grid has already been written.");
+
+        if (record.row < 1 || record.column < 1
+            || size_t(record.column - 1 + record.columns) > data.profile_count
+            || size_t(record.row - 1 + record.rows) > data.profile_length)
+        {
+            DEM_THROW("Record of type B is outside the grid.");
+        }
+        if (elevations.size() < size_t(record.rows) * size_t(record.columns))
+            DEM_THROW("Record of type B has too few elevations.");
+
+        auto src = elevations.data();
+        for (int i = 0; i < record.columns; ++i)
+        {
+            auto profile = size_t(record.column - 1 + i);
+            if (profile < data.band_start)
+            {
+                DEM_THROW("The records of type B are not ordered from"
+                          " west to east.");
+            }
+            while (profile >= data.band_start
+                              + data.get_band_width(data.band_start))
+            {
+                data.flush_band();
+            }
+
+            // The profiles go from south to north.
+            auto width = data.get_band_width(data.band_start);
+            auto dst = data.band.data() + (profile - data.band_start)
+                       + (data.profile_length - size_t(record.row))
+                         * width;
+            for (int j = 0; j < record.rows; ++j, dst -= width)
+                *dst = *src++;
+        }
+    }
+
+    void NorthUpGridWriter::finish()
+    {
+        auto& data = *m_Data;
+        if (data.finished)
+            DEM_THROW("The grid has already been written.");
+        data.finished = true;
+
+        data.write_header();
+        if (data.band_offsets.empty()
+            && data.band_width >= data.profile_count)
+        {
+            // All the profiles fit within the memory budget.
+            for (size_t i = 0; i < data.profile_length; ++i)
+                data.write_row(data.band.data() + i * data.profile_count, i);
+        }
+        else
+        {
+            while (data.band_start < data.profile_count)
+                data.flush_band();
+            data.band = {};
+            data.write_rows_from_scratch();
+        }
+        data.write_footer();
+
+        if (!data.stream)
+            DEM_THROW("Unable to write the grid.");
+    }
+
+    bool write_north_up_grid(DemReader& reader, std::ostream& stream,
+                             GridFileFormat format,
+                             GridLib::Unit vertical_unit,
+                             const NorthUpGridWriterOptions& options,
+                             const ProgressCallback& progress_callback)
+    {
+        auto& a = reader.record_a();
+        size_t profile_count = 0;
+        size_t profile_length = 0;
+        if (auto first = reader.peek_record_b())
+        {
+            profile_count = size_t(a.columns.value_or(1));
+            profile_length = size_t(get_row_count(a, first->rows));
+        }
+
+        NorthUpGridWriter writer(stream, format, a, vertical_unit,
+                                 profile_count, profile_length, options);
+        auto cols = a.columns.value_or(1);
+        RecordB b;
+        std::vector<int16_t> elevations;
+        while (reader.next_record_b(b, elevations))
+        {
+            writer.add_record_b(b, elevations);
+            if (progress_callback && !progress_callback(b.column, cols))
+                return false;
+        }
+        writer.finish();
+        return true;
+    }
+}
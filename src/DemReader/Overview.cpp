@@ -0,0 +1,285 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-01.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DemReader/Overview.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include "DemReader/DemException.hpp"
+#include "GridMetadata.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define DEMREADER_SSE2
+#endif
+
+namespace Dem
+{
+    namespace
+    {
+        /*
+         * Each reducer combines the blocks a0 a1 / b0 b1, where a and b
+         * are two adjacent rows. The SSE2 versions take 16 consecutive
+         * values from each row and return the 8 reduced values.
+         */
+
+        bool all_unknown(int16_t a0, int16_t a1, int16_t b0, int16_t b1)
+        {
+            return a0 == UNKNOWN_ELEVATION && a1 == UNKNOWN_ELEVATION
+                   && b0 == UNKNOWN_ELEVATION && b1 == UNKNOWN_ELEVATION;
+        }
+
+    #ifdef DEMREADER_SSE2
+
+        __m128i select(__m128i mask, __m128i a, __m128i b)
+        {
+            return _mm_or_si128(_mm_and_si128(mask, a),
+                                _mm_andnot_si128(mask, b));
+        }
+
+        /**
+         * @brief Sign-extends the lower 16 bits of each 32-bit lane in
+         *  @a lo and @a hi and packs them into 16-bit lanes.
+         */
+        __m128i pack_low_halves(__m128i lo, __m128i hi)
+        {
+            return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(lo, 16), 16),
+                                   _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16));
+        }
+
+        /**
+         * @brief Returns a mask of the 8 blocks where all four values
+         *  are unknown.
+         */
+        __m128i all_unknown(__m128i a0, __m128i a1, __m128i b0, __m128i b1)
+        {
+            const auto unknown = _mm_set1_epi16(UNKNOWN_ELEVATION);
+            const auto all_set = _mm_set1_epi32(-1);
+            auto lo = _mm_and_si128(_mm_cmpeq_epi16(a0, unknown),
+                                    _mm_cmpeq_epi16(b0, unknown));
+            auto hi = _mm_and_si128(_mm_cmpeq_epi16(a1, unknown),
+                                    _mm_cmpeq_epi16(b1, unknown));
+            return _mm_packs_epi32(_mm_cmpeq_epi32(lo, all_set),
+                                   _mm_cmpeq_epi32(hi, all_set));
+        }
+
+    #endif
+
+        struct MeanReducer
+        {
+            static int16_t reduce(int16_t a0, int16_t a1,
+                                  int16_t b0, int16_t b1)
+            {
+                int32_t sum = 0;
+                int32_t count = 0;
+                for (int32_t v : {a0, a1, b0, b1})
+                {
+                    if (v != UNKNOWN_ELEVATION)
+                    {
+                        sum += v;
+                        ++count;
+                    }
+                }
+                if (count == 0)
+                    return UNKNOWN_ELEVATION;
+                // Same rounding as the SSE2 version.
+                return int16_t(std::nearbyint(float(sum) / float(count)));
+            }
+
+        #ifdef DEMREADER_SSE2
+
+            static __m128i reduce(__m128i a0, __m128i a1,
+                                  __m128i b0, __m128i b1)
+            {
+                const auto unknown = _mm_set1_epi16(UNKNOWN_ELEVATION);
+                const auto ones = _mm_set1_epi16(1);
+                __m128i sums[2];
+                __m128i counts[2];
+                __m128i a[2] = {a0, a1};
+                __m128i b[2] = {b0, b1};
+                for (int i = 0; i < 2; ++i)
+                {
+                    auto a_void = _mm_cmpeq_epi16(a[i], unknown);
+                    auto b_void = _mm_cmpeq_epi16(b[i], unknown);
+                    // madd adds adjacent pairs, i.e. a0 + a1, to 32 bits.
+                    sums[i] = _mm_add_epi32(
+                        _mm_madd_epi16(_mm_andnot_si128(a_void, a[i]), ones),
+                        _mm_madd_epi16(_mm_andnot_si128(b_void, b[i]), ones));
+                    counts[i] = _mm_add_epi32(
+                        _mm_madd_epi16(_mm_andnot_si128(a_void, ones), ones),
+                        _mm_madd_epi16(_mm_andnot_si128(b_void, ones), ones));
+                }
+
+                __m128i means[2];
+                for (int i = 0; i < 2; ++i)
+                {
+                    // Blocks without known values give NaN here, they
+                    // are replaced below.
+                    means[i] = _mm_cvtps_epi32(
+                        _mm_div_ps(_mm_cvtepi32_ps(sums[i]),
+                                   _mm_cvtepi32_ps(counts[i])));
+                }
+                return select(all_unknown(a0, a1, b0, b1), unknown,
+                              _mm_packs_epi32(means[0], means[1]));
+            }
+
+        #endif
+        };
+
+        template <int16_t IGNORED>
+        int16_t replace_unknown(int16_t v)
+        {
+            return v == UNKNOWN_ELEVATION ? IGNORED : v;
+        }
+
+        struct MinReducer
+        {
+            static int16_t reduce(int16_t a0, int16_t a1,
+                                  int16_t b0, int16_t b1)
+            {
+                auto r = replace_unknown<INT16_MAX>;
+                if (all_unknown(a0, a1, b0, b1))
+                    return UNKNOWN_ELEVATION;
+                return std::min({r(a0), r(a1), r(b0), r(b1)});
+            }
+
+        #ifdef DEMREADER_SSE2
+
+            static __m128i reduce(__m128i a0, __m128i a1,
+                                  __m128i b0, __m128i b1)
+            {
+                const auto unknown = _mm_set1_epi16(UNKNOWN_ELEVATION);
+                const auto highest = _mm_set1_epi16(INT16_MAX);
+                auto r = [&](__m128i v)
+                {
+                    return select(_mm_cmpeq_epi16(v, unknown), highest, v);
+                };
+                auto lo = _mm_min_epi16(r(a0), r(b0));
+                auto hi = _mm_min_epi16(r(a1), r(b1));
+                lo = _mm_min_epi16(lo, _mm_srli_epi32(lo, 16));
+                hi = _mm_min_epi16(hi, _mm_srli_epi32(hi, 16));
+                return select(all_unknown(a0, a1, b0, b1), unknown,
+                              pack_low_halves(lo, hi));
+            }
+
+        #endif
+        };
+
+        struct MaxReducer
+        {
+            static int16_t reduce(int16_t a0, int16_t a1,
+                                  int16_t b0, int16_t b1)
+            {
+                auto r = replace_unknown<INT16_MIN>;
+                if (all_unknown(a0, a1, b0, b1))
+                    return UNKNOWN_ELEVATION;
+                return std::max({r(a0), r(a1), r(b0), r(b1)});
+            }
+
+        #ifdef DEMREADER_SSE2
+
+            static __m128i reduce(__m128i a0, __m128i a1,
+                                  __m128i b0, __m128i b1)
+            {
+                const auto unknown = _mm_set1_epi16(UNKNOWN_ELEVATION);
+                const auto lowest = _mm_set1_epi16(INT16_MIN);
+                auto r = [&](__m128i v)
+                {
+                    return select(_mm_cmpeq_epi16(v, unknown), lowest, v);
+                };
+                auto lo = _mm_max_epi16(r(a0), r(b0));
+                auto hi = _mm_max_epi16(r(a1), r(b1));
+                lo = _mm_max_epi16(lo, _mm_srli_epi32(lo, 16));
+                hi = _mm_max_epi16(hi, _mm_srli_epi32(hi, 16));
+                return select(all_unknown(a0, a1, b0, b1), unknown,
+                              pack_low_halves(lo, hi));
+            }
+
+        #endif
+        };
+
+        struct NearestReducer
+        {
+            static int16_t reduce(int16_t a0, int16_t, int16_t, int16_t)
+            {
+                return a0;
+            }
+
+        #ifdef DEMREADER_SSE2
+
+            static __m128i reduce(__m128i a0, __m128i a1, __m128i, __m128i)
+            {
+                return pack_low_halves(a0, a1);
+            }
+
+        #endif
+        };
+
+        template <typename Reducer>
+        Chorasmia::Array2D<int16_t>
+        make_overview(const Chorasmia::ArrayView2D<int16_t>& values)
+        {
+            auto rows = values.rowCount();
+            auto cols = values.columnCount();
+            Chorasmia::Array2D<int16_t> result((rows + 1) / 2,
+                                               (cols + 1) / 2);
+            if (result.valueCount() == 0)
+                return result;
+
+            auto result_cols = result.columnCount();
+            for (size_t i = 0; i < result.rowCount(); ++i)
+            {
+                // An odd last row is combined with itself, which gives
+                // the same result as a block with only that row.
+                auto a = &values(2 * i, 0);
+                auto b = &values(std::min(2 * i + 1, rows - 1), 0);
+                auto dst = &result(i, 0);
+                size_t j = 0;
+            #ifdef DEMREADER_SSE2
+                for (; 2 * j + 16 <= cols; j += 8)
+                {
+                    auto load = [](const int16_t* p)
+                    {
+                        return _mm_loadu_si128(
+                            reinterpret_cast<const __m128i*>(p));
+                    };
+                    auto r = Reducer::reduce(load(a + 2 * j),
+                                             load(a + 2 * j + 8),
+                                             load(b + 2 * j),
+                                             load(b + 2 * j + 8));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j), r);
+                }
+            #endif
+                for (; j < result_cols; ++j)
+                {
+                    auto j0 = 2 * j;
+                    auto j1 = std::min(j0 + 1, cols - 1);
+                    dst[j] = Reducer::reduce(a[j0], a[j1], b[j0], b[j1]);
+                }
+            }
+            return result;
+        }
+    }
+
+    Chorasmia::Array2D<int16_t>
+    make_overview(const Chorasmia::ArrayView2D<int16_t>& values,
+                  OverviewReducer reducer)
+    {
+        switch (reducer)
+        {
+        case OverviewReducer::MEAN:
+            return make_overview<MeanReducer>(values);
+        case OverviewReducer::MIN:
+            return make_overview<MinReducer>(values);
+        case OverviewReducer::MAX:
+            return make_overview<MaxReducer>(values);
+        case OverviewReducer::NEAREST:
+            return make_overview<NearestReducer>(values);
+        }
+        DEM_THROW("Unknown overview reducer.");
+    }
+}
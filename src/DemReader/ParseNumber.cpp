@@ -7,11 +7,16 @@
 //****************************************************************************
 #include "ParseNumber.hpp"
 
-#include <cmath>
+#include <charconv>
 #include <cstdint>
 #include <limits>
 #include <optional>
+#include <string>
 #include <type_traits>
+#ifndef __cpp_lib_to_chars
+    #include <locale>
+    #include <sstream>
+#endif
 
 namespace Dem
 {
@@ -273,6 +278,102 @@ namespace Dem
             return int(uint8_t(c) ^ 0x30u);
         }
 
+        constexpr double POWERS_OF_TEN[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        /**
+         * @brief The largest mantissa and power of ten that are exactly
+         *  representable in T.
+         *
+         * A number whose mantissa and power of ten both are exact can be
+         * computed with a single multiplication or division, which
+         * IEEE 754 guarantees is correctly rounded (Clinger's fast path).
+         * Long double is left out, its precision varies between
+         * platforms.
+         */
+        template <typename T>
+        struct FastPathLimits
+        {
+            static constexpr uint64_t MAX_MANTISSA = 0;
+            static constexpr int MAX_EXPONENT = -1;
+        };
+
+        template <>
+        struct FastPathLimits<float>
+        {
+            static constexpr uint64_t MAX_MANTISSA = uint64_t(1) << 24;
+            static constexpr int MAX_EXPONENT = 10;
+        };
+
+        template <>
+        struct FastPathLimits<double>
+        {
+            static constexpr uint64_t MAX_MANTISSA = uint64_t(1) << 53;
+            static constexpr int MAX_EXPONENT = 22;
+        };
+
+        // The number of decimal digits that always fit in an uint64_t.
+        constexpr int MAX_MANTISSA_DIGITS = 19;
+
+        /**
+         * @brief A number that has been scanned by parseFloatingPoint.
+         *
+         * @a text is the number without sign and underscores, and with
+         * 'e' as exponent character, i.e. a string from_chars accepts.
+         */
+        struct ScannedNumber
+        {
+            std::string_view text;
+            uint64_t mantissa = 0;
+            int exponent = 0;
+            bool truncated = false;
+        };
+
+        template <typename T>
+        std::optional<T> convertSlowly(const ScannedNumber& number)
+        {
+            T value = {};
+            auto first = number.text.data();
+            auto last = first + number.text.size();
+        #ifdef __cpp_lib_to_chars
+            auto [ptr, ec] = std::from_chars(first, last, value);
+            if (ec != std::errc() || ptr != last)
+                return {};
+        #else
+            std::istringstream stream(std::string(first, last));
+            stream.imbue(std::locale::classic());
+            if (!(stream >> value))
+                return {};
+        #endif
+            return value;
+        }
+
+        template <typename T>
+        std::optional<T> convert(const ScannedNumber& number)
+        {
+            using Limits = FastPathLimits<T>;
+            if (!number.truncated && number.mantissa <= Limits::MAX_MANTISSA)
+            {
+                if (number.mantissa == 0)
+                    return T(0);
+
+                auto value = T(number.mantissa);
+                if (0 <= number.exponent
+                    && number.exponent <= Limits::MAX_EXPONENT)
+                {
+                    return value * T(POWERS_OF_TEN[number.exponent]);
+                }
+                if (0 < -number.exponent
+                    && -number.exponent <= Limits::MAX_EXPONENT)
+                {
+                    return value / T(POWERS_OF_TEN[-number.exponent]);
+                }
+            }
+            return convertSlowly<T>(number);
+        }
+
         template <typename T>
         std::optional<T> parseFloatingPoint(std::string_view str)
         {
@@ -294,9 +395,7 @@ namespace Dem
                     return {};
             }
 
-            // Get the integer value
-            auto value = T(getDigit(str[i]));
-            if (value > 9)
+            if (getDigit(str[i]) > 9)
             {
                 if (str == "Infinity" || str == "null" || str == "+Infinity")
                     return std::numeric_limits<T>::infinity();
@@ -307,14 +406,44 @@ namespace Dem
                 return {};
             }
 
+            // The text is never longer than the input, only fields longer
+            // than a DEM record need a buffer on the heap.
+            char localBuffer[64];
+            std::string heapBuffer;
+            char* text = localBuffer;
+            if (str.size() > sizeof(localBuffer))
+            {
+                heapBuffer.resize(str.size());
+                text = heapBuffer.data();
+            }
+            size_t length = 0;
+
+            ScannedNumber number;
+            int mantissaDigits = 0;
+            auto addDigit = [&](int digit)
+            {
+                text[length++] = char('0' + digit);
+                if (mantissaDigits < MAX_MANTISSA_DIGITS)
+                {
+                    number.mantissa = number.mantissa * 10 + uint64_t(digit);
+                    if (number.mantissa != 0)
+                        ++mantissaDigits;
+                    return true;
+                }
+                if (digit != 0)
+                    number.truncated = true;
+                return false;
+            };
+
+            // Get the integer value
             bool underscore = false;
-            for (++i; i < str.size(); ++i)
+            for (; i < str.size(); ++i)
             {
                 auto digit = getDigit(str[i]);
                 if (digit <= 9)
                 {
-                    value *= 10;
-                    value += digit;
+                    if (!addDigit(digit))
+                        ++number.exponent;
                     underscore = false;
                 }
                 else if (str[i] != '_' || underscore)
@@ -330,24 +459,19 @@ namespace Dem
             if (underscore)
                 return {};
 
-            if (i == str.size())
-                return !negative ? value : -value;
-
             // Get the fraction
             underscore = true; // Makes underscore after point illegal.
-            int decimals = 0;
-            T fraction = {};
-            if (str[i] == '.')
+            if (i != str.size() && str[i] == '.')
             {
+                text[length++] = '.';
                 for (++i; i < str.size(); ++i)
                 {
                     auto digit = getDigit(str[i]);
                     if (digit <= 9)
                     {
-                        fraction *= 10;
-                        fraction += digit;
+                        if (addDigit(digit))
+                            --number.exponent;
                         underscore = false;
-                        ++decimals;
                     }
                     else if (str[i] != '_' || underscore)
                     {
@@ -361,12 +485,12 @@ namespace Dem
             }
 
             // Get the exponent
-            int exponent = 0;
             if (i != str.size())
             {
                 // Accept both e/E and d/D (FORTRAN) as exponent character.
                 if ((uint8_t(str[i]) & 0xDEu) != 'D')
                     return {};
+                text[length++] = 'e';
 
                 if (++i == str.size())
                     return {};
@@ -375,6 +499,7 @@ namespace Dem
                 if (str[i] == '-')
                 {
                     negativeExponent = true;
+                    text[length++] = '-';
                     if (++i == str.size())
                         return {};
                 }
@@ -384,9 +509,10 @@ namespace Dem
                         return {};
                 }
 
-                exponent += getDigit(str[i]);
+                int exponent = getDigit(str[i]);
                 if (exponent > 9)
                     return {};
+                text[length++] = str[i];
 
                 for (++i; i != str.size(); ++i)
                 {
@@ -395,6 +521,7 @@ namespace Dem
                     {
                         exponent *= 10;
                         exponent += digit;
+                        text[length++] = str[i];
                         underscore = false;
                     }
                     else if (str[i] != '_' || underscore)
@@ -408,18 +535,15 @@ namespace Dem
                     if (exponent > std::numeric_limits<T>::max_exponent10)
                         return {};
                 }
-                if (negativeExponent)
-                    exponent = -exponent;
+                number.exponent += negativeExponent ? -exponent : exponent;
             }
 
-            if (exponent)
-                value *= pow(T(10), exponent);
-            if (fraction != 0)
-                value += fraction * pow(T(10), exponent - decimals);
+            number.text = std::string_view(text, length);
+            auto value = convert<T>(number);
 
             // Add the sign
-            if (negative)
-                value = -value;
+            if (value && negative)
+                value = -*value;
 
             return value;
         }
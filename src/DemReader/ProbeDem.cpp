@@ -0,0 +1,247 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-28.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "DemReader/ProbeDem.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include "DemReader/DemException.hpp"
+#include "DemReader/RecordB.hpp"
+#include "DecompressStreamBuf.hpp"
+#include "FortranReader.hpp"
+#include "GridMetadata.hpp"
+
+namespace Dem
+{
+    namespace
+    {
+        bool has_record_c(const RecordA& a)
+        {
+            return a.data_validation_flag.value_or(0) != 0;
+        }
+
+        /**
+         * @brief Reads record A and the header of the first record of
+         *  type B from the start of @a reader.
+         */
+        std::optional<RecordB> read_head(FortranReader& reader,
+                                         DemProbe& probe)
+        {
+            probe.record_a = read_record_a(reader);
+            probe.profile_count = size_t(
+                std::max<int>(probe.record_a.columns.value_or(0), 0));
+            if (probe.profile_count == 0
+                || !reader.fill_buffer(RECORD_B_HEADER_SIZE))
+            {
+                return {};
+            }
+
+            try
+            {
+                return read_record_b_header(reader);
+            }
+            catch (std::exception& ex)
+            {
+                DEM_THROW_STRING(std::string("Invalid record of type B.\n    ")
+                                 + ex.what());
+            }
+        }
+
+        DemProbe probe_compressed_dem(std::istream& file,
+                                      Compression compression)
+        {
+            if (!is_supported(compression))
+                DEM_THROW("DemReader was built without zstd support.");
+
+            DecompressStreamBuf buffer(file, compression);
+            std::istream stream(&buffer);
+            stream.exceptions(std::ios::badbit);
+            FortranReader reader(stream, DEM_BLOCK_SIZE + RECORD_B_HEADER_SIZE);
+
+            DemProbe result;
+            if (auto b = read_head(reader, result))
+                result.profile_length = size_t(
+                    get_row_count(result.record_a, b->rows));
+            return result;
+        }
+    }
+
+    DemProbe probe_dem(const std::string& file_name)
+    {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file)
+            DEM_THROW_STRING(std::string("Can not open ") + file_name);
+
+        char head[DEM_BLOCK_SIZE + RECORD_B_HEADER_SIZE];
+        file.read(head, sizeof(head));
+        auto head_size = size_t(file.gcount());
+        auto compression = detect_compression(head,
+                                              std::min<size_t>(head_size, 4));
+        if (compression != Compression::NONE)
+        {
+            file.clear();
+            file.seekg(0);
+            auto result = probe_compressed_dem(file, compression);
+            file.clear();
+            result.file_size = uint64_t(file.seekg(0, std::ios::end).tellg());
+            return result;
+        }
+
+        if (head_size < DEM_BLOCK_SIZE)
+            DEM_THROW("The file is too small to contain a record of type A.");
+
+        DemProbe result;
+        FortranReader head_reader(head, head_size);
+        auto first_b = read_head(head_reader, result);
+
+        file.clear();
+        result.file_size = uint64_t(file.seekg(0, std::ios::end).tellg());
+
+        size_t record_c_size = 0;
+        if (has_record_c(result.record_a)
+            && result.file_size >= 2 * DEM_BLOCK_SIZE)
+        {
+            char tail[DEM_BLOCK_SIZE];
+            file.seekg(-std::streamoff(DEM_BLOCK_SIZE), std::ios::end);
+            if (!file.read(tail, DEM_BLOCK_SIZE))
+                DEM_THROW_STRING(std::string("Can not read record C in ")
+                                 + file_name);
+            try
+            {
+                FortranReader tail_reader(tail, DEM_BLOCK_SIZE);
+                result.record_c = read_record_c(tail_reader);
+            }
+            catch (std::exception& ex)
+            {
+                DEM_THROW_STRING(std::string("The file doesn't contain"
+                                             " a valid record of type C.\n    ")
+                                 + ex.what());
+            }
+            record_c_size = DEM_BLOCK_SIZE;
+        }
+
+        if (!first_b)
+            return result;
+
+        // If all profiles are as long as the first one, the records of
+        // type B fill the space between records A and C, except perhaps
+        // for some padding at the end.
+        auto b_size = get_record_b_size(first_b->rows, first_b->columns);
+        auto expected_size = DEM_BLOCK_SIZE + record_c_size
+                             + result.profile_count * b_size;
+        if (expected_size <= result.file_size
+            && result.file_size - expected_size < DEM_BLOCK_SIZE)
+        {
+            result.profile_length = size_t(
+                get_row_count(result.record_a, first_b->rows));
+        }
+        return result;
+    }
+
+    bool probe_dems(const std::vector<std::string>& file_names,
+                    unsigned thread_count,
+                    const DemProbeCallback& callback)
+    {
+        if (thread_count == 0)
+            thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+        thread_count = unsigned(std::min<size_t>(thread_count,
+                                                 file_names.size()));
+
+        std::atomic<size_t> next_file(0);
+        std::atomic<bool> stopped(false);
+        std::mutex callback_mutex;
+
+        auto probe_files = [&]
+        {
+            while (!stopped)
+            {
+                auto i = next_file++;
+                if (i >= file_names.size())
+                    break;
+
+                DemProbeResult result;
+                try
+                {
+                    result.probe = probe_dem(file_names[i]);
+                }
+                catch (std::exception& ex)
+                {
+                    result.error = file_names[i] + ": " + ex.what();
+                }
+
+                std::lock_guard lock(callback_mutex);
+                if (stopped)
+                    break;
+                try
+                {
+                    if (!callback(i, std::move(result)))
+                        stopped = true;
+                }
+                catch (...)
+                {
+                    stopped = true;
+                    throw;
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        for (unsigned i = 1; i < thread_count; ++i)
+        {
+            threads.emplace_back([&]
+            {
+                try
+                {
+                    probe_files();
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(error_mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            });
+        }
+
+        try
+        {
+            probe_files();
+        }
+        catch (...)
+        {
+            std::lock_guard lock(error_mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        if (error)
+            std::rethrow_exception(error);
+        return !stopped;
+    }
+
+    std::vector<DemProbeResult>
+    probe_dems(const std::vector<std::string>& file_names,
+               unsigned thread_count)
+    {
+        std::vector<DemProbeResult> result(file_names.size());
+        probe_dems(file_names, thread_count,
+                   [&](size_t i, DemProbeResult&& probe)
+                   {
+                       result[i] = std::move(probe);
+                       return true;
+                   });
+        return result;
+    }
+}
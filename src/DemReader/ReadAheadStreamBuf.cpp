@@ -0,0 +1,209 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-13.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "ReadAheadStreamBuf.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace Dem
+{
+    ReadAheadStreamBuf::ReadAheadStreamBuf(std::istream& source,
+                                           size_t buffer_size,
+                                           size_t depth)
+        : m_Source(source),
+          m_BufferSize(std::max<size_t>(buffer_size, 1))
+    {
+        // One buffer is in the get area while the others are filled.
+        m_Buffers.resize(std::max<size_t>(depth, 1) + 1);
+        start(std::streamoff(m_Source.tellg()));
+    }
+
+    ReadAheadStreamBuf::~ReadAheadStreamBuf()
+    {
+        stop();
+    }
+
+    ReadAheadStreamBuf::int_type ReadAheadStreamBuf::underflow()
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+
+        std::unique_lock lock(m_Mutex);
+        if (m_HasCurrent)
+        {
+            if (m_Position >= 0)
+                m_Position += std::streamoff(m_Current.size);
+            m_FreeBuffers.push_back(m_Current.buffer);
+            m_HasCurrent = false;
+            setg(nullptr, nullptr, nullptr);
+            m_Condition.notify_all();
+        }
+
+        m_Condition.wait(lock, [&]{return !m_Chunks.empty() || m_Finished;});
+        if (m_Chunks.empty())
+        {
+            if (m_Error)
+                std::rethrow_exception(std::exchange(m_Error, nullptr));
+            return traits_type::eof();
+        }
+
+        m_Current = m_Chunks.front();
+        m_Chunks.pop_front();
+        m_HasCurrent = true;
+        m_Position = m_Current.position;
+        lock.unlock();
+
+        auto data = m_Buffers[m_Current.buffer].data();
+        setg(data, data, data + m_Current.size);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    ReadAheadStreamBuf::pos_type
+    ReadAheadStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                std::ios_base::openmode which)
+    {
+        if (!(which & std::ios_base::in))
+            return pos_type(off_type(-1));
+
+        // A source that doesn't report its position can't seek either,
+        // and stopping the thread would discard the data it has read.
+        auto pos = current_position();
+        if (pos == pos_type(off_type(-1)))
+            return pos;
+
+        if (dir == std::ios_base::cur)
+        {
+            // This is how tellg is implemented, it mustn't disturb
+            // the thread.
+            if (off == 0)
+                return pos;
+            return seekpos(pos + off, which);
+        }
+
+        stop();
+        m_Source.clear();
+        if (!m_Source.seekg(off, dir))
+        {
+            // Leave the stream where it was.
+            m_Source.clear();
+            m_Source.seekg(pos);
+            start(off_type(pos));
+            return pos_type(off_type(-1));
+        }
+
+        auto new_pos = m_Source.tellg();
+        start(off_type(new_pos));
+        return new_pos;
+    }
+
+    ReadAheadStreamBuf::pos_type
+    ReadAheadStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+    {
+        if (!(which & std::ios_base::in))
+            return pos_type(off_type(-1));
+
+        // Seeks within the current buffer don't require the thread to
+        // be restarted.
+        if (m_HasCurrent && m_Position >= 0)
+        {
+            auto offset = off_type(pos) - m_Position;
+            if (0 <= offset && offset <= egptr() - eback())
+            {
+                setg(eback(), eback() + offset, egptr());
+                return pos;
+            }
+        }
+
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+    void ReadAheadStreamBuf::start(std::streamoff position)
+    {
+        m_Chunks.clear();
+        m_FreeBuffers.clear();
+        for (size_t i = 0; i < m_Buffers.size(); ++i)
+            m_FreeBuffers.push_back(i);
+        m_Error = nullptr;
+        m_Stop = false;
+        m_Finished = false;
+        m_HasCurrent = false;
+        m_Position = position;
+        setg(nullptr, nullptr, nullptr);
+        m_Thread = std::thread(&ReadAheadStreamBuf::read_ahead, this,
+                               position);
+    }
+
+    void ReadAheadStreamBuf::stop()
+    {
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Condition.notify_all();
+        if (m_Thread.joinable())
+            m_Thread.join();
+    }
+
+    void ReadAheadStreamBuf::read_ahead(std::streamoff position)
+    {
+        try
+        {
+            while (true)
+            {
+                size_t buffer;
+                {
+                    std::unique_lock lock(m_Mutex);
+                    m_Condition.wait(lock, [&]
+                    {
+                        return m_Stop || !m_FreeBuffers.empty();
+                    });
+                    if (m_Stop)
+                        return;
+                    buffer = m_FreeBuffers.back();
+                    m_FreeBuffers.pop_back();
+                }
+
+                auto& data = m_Buffers[buffer];
+                data.resize(m_BufferSize);
+                m_Source.read(data.data(), std::streamsize(data.size()));
+                auto size = size_t(m_Source.gcount());
+
+                std::lock_guard lock(m_Mutex);
+                if (size != 0)
+                    m_Chunks.push_back({buffer, size, position});
+                else
+                    m_FreeBuffers.push_back(buffer);
+                if (position >= 0)
+                    position += std::streamoff(size);
+                // istream::read only comes up short at the end of the
+                // stream or when an error occurs.
+                if (size < data.size())
+                    m_Finished = true;
+                m_Condition.notify_all();
+                if (m_Finished)
+                    return;
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Error = std::current_exception();
+            m_Finished = true;
+            m_Condition.notify_all();
+        }
+    }
+
+    ReadAheadStreamBuf::pos_type ReadAheadStreamBuf::current_position() const
+    {
+        if (m_Position < 0)
+            return pos_type(off_type(-1));
+        if (!m_HasCurrent)
+            return pos_type(m_Position);
+        return pos_type(m_Position + (gptr() - eback()));
+    }
+}
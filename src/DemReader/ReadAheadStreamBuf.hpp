@@ -0,0 +1,85 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-13.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <istream>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+namespace Dem
+{
+    /**
+     * @brief A stream buffer that reads from another stream in a
+     *  background thread.
+     *
+     * The thread fills up to @a depth buffers of @a buffer_size bytes
+     * ahead of the one that is currently being read, which means that
+     * parsing and I/O overlap. Seeking stops the thread, moves the
+     * source stream and restarts the thread at the new position.
+     */
+    class ReadAheadStreamBuf : public std::streambuf
+    {
+    public:
+        ReadAheadStreamBuf(std::istream& source,
+                           size_t buffer_size, size_t depth);
+
+        ReadAheadStreamBuf(const ReadAheadStreamBuf&) = delete;
+
+        ~ReadAheadStreamBuf() override;
+
+        ReadAheadStreamBuf& operator=(const ReadAheadStreamBuf&) = delete;
+    protected:
+        int_type underflow() override;
+
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                         std::ios_base::openmode which) override;
+
+        pos_type seekpos(pos_type pos,
+                         std::ios_base::openmode which) override;
+    private:
+        struct Chunk
+        {
+            size_t buffer = 0;
+            size_t size = 0;
+            std::streamoff position = 0;
+        };
+
+        void start(std::streamoff position);
+
+        void stop();
+
+        void read_ahead(std::streamoff position);
+
+        pos_type current_position() const;
+
+        std::istream& m_Source;
+        size_t m_BufferSize;
+        std::vector<std::vector<char>> m_Buffers;
+
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::deque<Chunk> m_Chunks;
+        std::vector<size_t> m_FreeBuffers;
+        std::exception_ptr m_Error;
+        bool m_Stop = false;
+        bool m_Finished = false;
+        std::thread m_Thread;
+
+        /// The chunk in the get area. Only accessed by the reading thread.
+        Chunk m_Current;
+        bool m_HasCurrent = false;
+        /// The stream position of eback() if there is a current chunk,
+        /// otherwise of the next byte. Negative if the source stream
+        /// doesn't report positions.
+        std::streamoff m_Position = -1;
+    };
+}
@@ -6,136 +6,1083 @@
 // License text is included with the source distribution.
 //****************************************************************************
 #include "DemReader/ReadDemGrid.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include "DemReader/DemException.hpp"
 #include "DemReader/DemReader.hpp"
+#include "DemReader/ElevationStatistics.hpp"
+#include "DecompressStreamBuf.hpp"
+#include "FortranReader.hpp"
+#include "GridMetadata.hpp"
+#include "MemoryMappedFile.hpp"
+#include "ScaleElevations.hpp"
+#include "WorkStealingQueue.hpp"
 
 namespace Dem
 {
-    constexpr float METERS_PER_FOOT = 0.3048;
-    constexpr int16_t UNKNOWN = -32767;
+    GridLib::Grid read_dem_grid(std::istream& stream,
+                                GridLib::Unit desired_unit,
+                                const ProgressCallback& progress_callback)
+    {
+        Dem::DemReader reader(stream);
+        return read_dem_grid(reader, desired_unit, progress_callback);
+    }
 
-    GridLib::Unit fromDemUnit(int16_t unit)
+    namespace
     {
-        switch (unit)
+        bool is_compressed(const MemoryMappedFile& file)
+        {
+            auto size = std::min<size_t>(file.size(), 4);
+            return detect_compression(file.data(), size) != Compression::NONE;
+        }
+
+        template <typename GridT>
+        void resize_grid(GridT& grid, const RecordA& a, int first_b_rows)
+        {
+            auto rows = get_row_count(a, first_b_rows);
+            auto cols = a.columns.value_or(1);
+            // DEM files uses columnCount (x) as the major axis.
+            grid.resize(cols, rows);
+        }
+
+        void check_record_b(size_t row_count, size_t column_count,
+                            const RecordB& b)
+        {
+            if (b.row < 1 || b.column < 1
+                || size_t(b.column - 1 + b.columns) > row_count
+                || size_t(b.row - 1 + b.rows) > column_count)
+            {
+                DEM_THROW("Record of type B is outside the grid.");
+            }
+        }
+
+        /**
+         * @brief Writes the parts of @a b that are inside the grid,
+         *  where the grid's first row and column are @a row_offset and
+         *  @a column_offset in the DEM file.
+         *
+         * @a copy is called with the source, count and destination of
+         *  each part of a profile.
+         */
+        template <typename T, typename CopyFunc>
+        void write_record_b(const Chorasmia::MutableArrayView2D<T>& values,
+                            const RecordB& b,
+                            size_t row_offset, size_t column_offset,
+                            CopyFunc copy)
+        {
+            // The row and column ranges in the DEM file that are inside
+            // the grid.
+            auto row_min = int64_t(row_offset);
+            auto row_max = row_min + int64_t(values.rowCount());
+            auto col_min = int64_t(column_offset);
+            auto col_max = col_min + int64_t(values.columnCount());
+
+            auto j0 = std::max<int64_t>(col_min - (b.row - 1), 0);
+            auto j1 = std::min<int64_t>(col_max - (b.row - 1), b.rows);
+            if (j0 >= j1)
+                return;
+
+            for (int i = 0; i < b.columns; ++i)
+            {
+                auto r = int64_t(b.column - 1 + i);
+                if (r < row_min || r >= row_max)
+                    continue;
+                auto c = b.row - 1 + j0 - col_min;
+                copy(b.elevations.data() + i * b.rows + j0,
+                     size_t(j1 - j0),
+                     &values(size_t(r - row_min), size_t(c)));
+            }
+        }
+
+        void write_record_b(const Chorasmia::MutableArrayView2D<double>& values,
+                            const RecordB& b, double factor,
+                            size_t row_offset, size_t column_offset)
+        {
+            write_record_b(values, b, row_offset, column_offset,
+                           [&](const int32_t* src, size_t n, double* dst)
+                           {
+                               scale_elevations(src, n, factor, dst);
+                           });
+        }
+
+        void write_record_b(const Chorasmia::MutableArrayView2D<int16_t>& values,
+                            const RecordB& b,
+                            size_t row_offset, size_t column_offset)
+        {
+            write_record_b(values, b, row_offset, column_offset,
+                           [](const int32_t* src, size_t n, int16_t* dst)
+                           {
+                               for (size_t i = 0; i < n; ++i)
+                                   dst[i] = int16_t(src[i]);
+                           });
+        }
+
+        void write_record_b(const Chorasmia::MutableArrayView2D<double>& values,
+                            const RecordB& b, double factor)
+        {
+            check_record_b(values.rowCount(), values.columnCount(), b);
+
+            // The elevations in each column of a profile are consecutive
+            // in both the record and the grid.
+            for (int i = 0; i < b.columns; ++i)
+            {
+                scale_elevations(b.elevations.data() + i * b.rows,
+                                 size_t(b.rows), factor,
+                                 &values(i + b.column - 1, b.row - 1));
+            }
+        }
+
+        void write_record_b(const Chorasmia::MutableArrayView2D<int16_t>& values,
+                            const RecordB& b,
+                            const std::vector<int16_t>& elevations)
+        {
+            check_record_b(values.rowCount(), values.columnCount(), b);
+
+            auto src = elevations.data();
+            for (int i = 0; i < b.columns; ++i)
+            {
+                std::copy(src, src + b.rows,
+                          &values(i + b.column - 1, b.row - 1));
+                src += b.rows;
+            }
+        }
+
+        /**
+         * @brief Reads the record of type B in @a reader directly into
+         *  @a values.
+         *
+         * The elevations of a profile are stored consecutively in the
+         * grid, which means records with a single column can be decoded
+         * without an intermediate buffer.
+         */
+        void read_record_b(FortranReader& reader,
+                           const Chorasmia::MutableArrayView2D<int16_t>& values,
+                           RecordB& b, std::vector<int16_t>& buffer,
+                           ElevationStatistics* statistics)
+        {
+            read_record_b_header(reader, b);
+            check_record_b(values.rowCount(), values.columnCount(), b);
+            if (b.columns == 1)
+            {
+                read_record_b_elevations(reader, b, 0, size_t(b.rows),
+                                         &values(b.column - 1, b.row - 1),
+                                         statistics);
+            }
+            else
+            {
+                buffer.resize(size_t(b.rows) * size_t(b.columns));
+                read_record_b_elevations(reader, b, 0, buffer.size(),
+                                         buffer.data(), statistics);
+                write_record_b(values, b, buffer);
+            }
+        }
+
+        /**
+         * @brief Calls @a read with a FortranReader for each record of
+         *  type B in @a index, using @a thread_count threads.
+         *
+         * Each thread gets its own copy of @a read, which means it can
+         * own buffers that are reused for every record the thread reads.
+         * Each copy is passed to @a finish when its thread is done, one
+         * thread at a time.
+         *
+         * @return false if @a progress_callback stopped the reading.
+         */
+        template <typename ReadFunc, typename FinishFunc>
+        bool read_records_in_parallel(const MemoryMappedFile& file,
+                                      const DemIndex& index,
+                                      unsigned thread_count,
+                                      const ReadFunc& read,
+                                      const FinishFunc& finish,
+                                      const ProgressCallback& progress_callback)
+        {
+            std::atomic<size_t> next_index = 0;
+            std::atomic<bool> stop = false;
+            std::mutex mutex;
+            size_t completed = 0;
+            std::exception_ptr error;
+
+            auto worker = [&]
+            {
+                auto thread_read = read;
+                while (!stop)
+                {
+                    auto i = next_index++;
+                    if (i >= index.size())
+                        break;
+
+                    try
+                    {
+                        FortranReader b_reader(file.data() + index[i].offset,
+                                               index[i].size);
+                        thread_read(b_reader);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard lock(mutex);
+                        if (!error)
+                            error = std::current_exception();
+                        stop = true;
+                        break;
+                    }
+
+                    if (progress_callback)
+                    {
+                        std::lock_guard lock(mutex);
+                        if (!stop && !progress_callback(++completed,
+                                                        index.size()))
+                        {
+                            stop = true;
+                        }
+                    }
+                }
+
+                std::lock_guard lock(mutex);
+                finish(thread_read);
+            };
+
+            std::vector<std::thread> threads;
+            thread_count = unsigned(std::min<size_t>(thread_count,
+                                                     index.size()));
+            for (unsigned i = 1; i < thread_count; ++i)
+                threads.emplace_back(worker);
+            worker();
+            for (auto& thread : threads)
+                thread.join();
+
+            if (error)
+                std::rethrow_exception(error);
+            return !stop;
+        }
+
+        /**
+         * @brief Reads records of type B into a grid of doubles in one
+         *  of the threads started by read_records_in_parallel.
+         */
+        struct GridRecordReader
+        {
+            Chorasmia::MutableArrayView2D<double> values;
+            double factor;
+            std::optional<ElevationStatistics> statistics;
+            RecordB b{};
+
+            void operator()(FortranReader& reader)
+            {
+                Dem::read_record_b(reader, b,
+                                   statistics ? &*statistics : nullptr);
+                write_record_b(values, b, factor);
+            }
+        };
+
+        /**
+         * @brief Reads records of type B into a CompactGrid in one of
+         *  the threads started by read_records_in_parallel.
+         */
+        struct CompactRecordReader
+        {
+            Chorasmia::MutableArrayView2D<int16_t> values;
+            std::optional<ElevationStatistics> statistics;
+            RecordB b{};
+            std::vector<int16_t> buffer{};
+
+            void operator()(FortranReader& reader)
+            {
+                read_record_b(reader, values, b, buffer,
+                              statistics ? &*statistics : nullptr);
+            }
+        };
+
+        /**
+         * @brief Returns a function that adds the statistics of each
+         *  thread's reader to @a statistics.
+         */
+        auto add_thread_statistics(ElevationStatistics* statistics)
         {
-        case 1:
-            return GridLib::Unit::FEET;
-        case 2:
-            return GridLib::Unit::METERS;
-        case 3:
-            return GridLib::Unit::ARC_SECONDS;
-        default:
-            return GridLib::Unit::UNDEFINED;
+            return [statistics](auto& thread_reader)
+            {
+                if (statistics && thread_reader.statistics)
+                    statistics->add(*thread_reader.statistics);
+            };
         }
+
+        std::optional<ElevationStatistics>
+        make_thread_statistics(const ElevationStatistics* statistics)
+        {
+            if (!statistics)
+                return {};
+            return ElevationStatistics(statistics->histogram_bin_size());
+        }
+
+        /**
+         * @brief Adds the elevations read by @a reader to @a statistics
+         *  while it exists.
+         */
+        class StatisticsScope
+        {
+        public:
+            StatisticsScope(DemReader& reader,
+                            ElevationStatistics* statistics)
+                : m_Reader(statistics ? &reader : nullptr)
+            {
+                if (m_Reader)
+                    m_Reader->set_statistics(statistics);
+            }
+
+            StatisticsScope(const StatisticsScope&) = delete;
+
+            StatisticsScope& operator=(const StatisticsScope&) = delete;
+
+            ~StatisticsScope()
+            {
+                if (m_Reader)
+                    m_Reader->set_statistics(nullptr);
+            }
+        private:
+            DemReader* m_Reader;
+        };
     }
 
-    GridLib::Grid read_dem_grid(std::istream& stream,
+    GridLib::Grid read_dem_grid(DemReader& reader,
                                 GridLib::Unit desired_unit,
                                 const ProgressCallback& progress_callback)
     {
         GridLib::Grid grid;
-        Dem::DemReader reader(stream);
         auto& a = reader.record_a();
-        auto hUnit = fromDemUnit(a.horizontal_unit.value_or(0));
-        auto cRes = a.x_resolution.value_or(1.0);
-        auto rRes = a.y_resolution.value_or(1.0);
+        auto factor = initialize_grid(grid, a, desired_unit);
 
-        auto vUnit = fromDemUnit(a.vertical_unit.value_or(0));
-        auto vRes = a.z_resolution.value_or(1.0);
+        Chorasmia::MutableArrayView2D<double> values;
+        auto cols = a.columns.value_or(1);
+        RecordB b;
+        while (reader.next_record_b(b))
+        {
+            if (values.empty())
+            {
+                resize_grid(grid, a, b.rows);
+                values = grid.elevations();
+            }
+            write_record_b(values, b, factor);
+            if (progress_callback && !progress_callback(b.column, cols))
+                return {};
+        }
 
-        if (a.longitude && a.latitude)
+        return grid;
+    }
+
+    GridLib::Grid read_dem_grid(const std::string& file_name,
+                                GridLib::Unit desired_unit,
+                                const DemWindow& window,
+                                const ProgressCallback& progress_callback)
+    {
+        Dem::DemReader reader(file_name);
+        return read_dem_grid(reader, desired_unit, window, progress_callback);
+    }
+
+    namespace
+    {
+        GridLib::Grid& get_metadata(GridLib::Grid& grid)
         {
-            grid.setSphericalCoords(
-                GridLib::SphericalCoords{to_degrees(*a.latitude),
-                                         to_degrees(*a.longitude)});
+            return grid;
         }
-        if (const auto& c = a.quadrangle_corners[0])
+
+        GridLib::Grid& get_metadata(CompactGrid& grid)
         {
-            grid.setPlanarCoords(
-                GridLib::PlanarCoords{c->easting, c->northing,
-                                      a.ref_sys_zone.value_or(0)});
+            return grid.metadata();
         }
-        if (a.horizontal_datum)
+
+        template <typename GridT>
+        GridT read_dem_grid_window(DemReader& reader,
+                                   GridLib::Unit desired_unit,
+                                   const DemWindow& window,
+                                   const ProgressCallback& progress_callback)
         {
-            grid.setReferenceSystem(
-                GridLib::ReferenceSystem{*a.horizontal_datum,
-                                         a.vertical_datum.value_or(0)});
+            GridT grid;
+            auto& a = reader.record_a();
+            auto& metadata = get_metadata(grid);
+            auto factor = initialize_grid(metadata, a, desired_unit);
+            if constexpr (std::is_same_v<GridT, CompactGrid>)
+                grid.set_factor(factor);
+
+            auto first = reader.peek_record_b();
+            if (!first)
+                return grid;
+
+            // Clamp the window to the grid. Grid rows are DEM columns.
+            auto rows = size_t(a.columns.value_or(1));
+            auto cols = size_t(get_row_count(a, first->rows));
+            auto row0 = std::min(window.row, rows);
+            auto row1 = row0 + std::min(window.row_count, rows - row0);
+            auto col0 = std::min(window.column, cols);
+            auto col1 = col0 + std::min(window.column_count, cols - col0);
+
+            if (const auto& c = a.quadrangle_corners[0])
+            {
+                auto xRes = a.x_resolution.value_or(1.0);
+                auto yRes = a.y_resolution.value_or(1.0);
+                metadata.setPlanarCoords(
+                    GridLib::PlanarCoords{c->easting + row0 * xRes,
+                                          c->northing + col0 * yRes,
+                                          a.ref_sys_zone.value_or(0)});
+            }
+
+            grid.resize(row1 - row0, col1 - col0);
+            if (row0 == row1 || col0 == col1)
+                return grid;
+
+            while (auto info = reader.peek_record_b())
+            {
+                auto column = size_t(info->column - 1);
+                // Profiles are ordered from west to east.
+                if (column >= row1)
+                    break;
+
+                if (column + info->columns <= row0)
+                {
+                    reader.skip_record_b();
+                    continue;
+                }
+
+                auto b = reader.next_record_b(int(col0 + 1),
+                                              int(col1 - col0));
+                if constexpr (std::is_same_v<GridT, CompactGrid>)
+                    write_record_b(grid.values(), *b, row0, col0);
+                else
+                    write_record_b(grid.elevations(), *b, factor, row0, col0);
+
+                if (progress_callback
+                    && !progress_callback(column + 1 - row0, row1 - row0))
+                {
+                    return {};
+                }
+            }
+
+            return grid;
         }
-        double factor = 1.0;
-        if (desired_unit == GridLib::Unit::METERS)
+    }
+
+    GridLib::Grid read_dem_grid(DemReader& reader,
+                                GridLib::Unit desired_unit,
+                                const DemWindow& window,
+                                const ProgressCallback& progress_callback)
+    {
+        return read_dem_grid_window<GridLib::Grid>(reader, desired_unit,
+                                                   window, progress_callback);
+    }
+
+    namespace
+    {
+        GridLib::Grid
+        read_dem_grid_impl(const std::string& file_name,
+                           GridLib::Unit desired_unit,
+                           unsigned thread_count,
+                           ElevationStatistics* statistics,
+                           const ProgressCallback& progress_callback)
         {
-            if (vUnit == GridLib::Unit::FEET)
+            if (thread_count == 0)
+                thread_count = std::max(std::thread::hardware_concurrency(),
+                                        1u);
+
+            // A single thread reads the file from start to end, while
+            // several threads each read a part of it.
+            MemoryMappedFile file(file_name, thread_count == 1
+                                             ? FileAccess::SEQUENTIAL
+                                             : FileAccess::NORMAL);
+            if (is_compressed(file))
             {
-                factor = vRes * METERS_PER_FOOT;
-                vRes = 1.0;
-                vUnit = GridLib::Unit::METERS;
+                // Compressed files can only be decoded from start to end.
+                Dem::DemReader reader(file_name);
+                StatisticsScope scope(reader, statistics);
+                return read_dem_grid(reader, desired_unit, progress_callback);
             }
-            else
+
+            Dem::DemReader reader(file.data(), file.size());
+            if (thread_count == 1)
             {
-                factor = vRes;
-                vRes = 1.0;
+                StatisticsScope scope(reader, statistics);
+                return read_dem_grid(reader, desired_unit, progress_callback);
             }
 
-            if (hUnit == GridLib::Unit::FEET)
+            GridLib::Grid grid;
+            auto& a = reader.record_a();
+            auto factor = initialize_grid(grid, a, desired_unit);
+
+            const auto& index = reader.index();
+            if (index.empty())
+                return grid;
+
+            resize_grid(grid, a, index[0].rows);
+            GridRecordReader read{grid.elevations(), factor,
+                                  make_thread_statistics(statistics)};
+            if (!read_records_in_parallel(file, index, thread_count, read,
+                                          add_thread_statistics(statistics),
+                                          progress_callback))
             {
-                rRes *= METERS_PER_FOOT;
-                cRes *= METERS_PER_FOOT;
-                hUnit = GridLib::Unit::METERS;
+                return {};
             }
+            return grid;
         }
-        else if (desired_unit == GridLib::Unit::FEET)
+
+        CompactGrid
+        read_compact_dem_grid_impl(const std::string& file_name,
+                                   GridLib::Unit desired_unit,
+                                   unsigned thread_count,
+                                   ElevationStatistics* statistics,
+                                   const ProgressCallback& progress_callback)
         {
-            if (vUnit == GridLib::Unit::METERS)
+            if (thread_count == 0)
+                thread_count = std::max(std::thread::hardware_concurrency(),
+                                        1u);
+
+            // A single thread reads the file from start to end, while
+            // several threads each read a part of it.
+            MemoryMappedFile file(file_name, thread_count == 1
+                                             ? FileAccess::SEQUENTIAL
+                                             : FileAccess::NORMAL);
+            if (is_compressed(file))
             {
-                factor = vRes / METERS_PER_FOOT;
-                vRes = 1.0;
-                vUnit = GridLib::Unit::FEET;
+                // Compressed files can only be decoded from start to end.
+                Dem::DemReader reader(file_name);
+                StatisticsScope scope(reader, statistics);
+                return read_compact_dem_grid(reader, desired_unit,
+                                             progress_callback);
             }
-            else
+
+            Dem::DemReader reader(file.data(), file.size());
+            if (thread_count == 1)
             {
-                factor = vRes;
-                vRes = 1.0;
+                StatisticsScope scope(reader, statistics);
+                return read_compact_dem_grid(reader, desired_unit,
+                                             progress_callback);
             }
 
-            if (hUnit == GridLib::Unit::METERS)
+            CompactGrid grid;
+            auto& a = reader.record_a();
+            grid.set_factor(initialize_grid(grid.metadata(), a, desired_unit));
+
+            const auto& index = reader.index();
+            if (index.empty())
+                return grid;
+
+            resize_grid(grid, a, index[0].rows);
+            CompactRecordReader read{grid.values(),
+                                     make_thread_statistics(statistics)};
+            if (!read_records_in_parallel(file, index, thread_count, read,
+                                          add_thread_statistics(statistics),
+                                          progress_callback))
             {
-                rRes *= 1.0 / METERS_PER_FOOT;
-                cRes *= 1.0 / METERS_PER_FOOT;
-                hUnit = GridLib::Unit::FEET;
+                return {};
             }
+            return grid;
         }
+    }
+
+    GridLib::Grid read_dem_grid(const std::string& file_name,
+                                GridLib::Unit desired_unit,
+                                const ProgressCallback& progress_callback)
+    {
+        return read_dem_grid_impl(file_name, desired_unit, 1,
+                                  nullptr, progress_callback);
+    }
 
-        grid.setVerticalAxis({vRes, vUnit});
-        grid.setRowAxis({rRes, hUnit});
-        grid.setColumnAxis({cRes, hUnit});
-        grid.setRotationAngle(a.rotation_angle.value_or(0));
-        grid.setUnknownElevation(UNKNOWN * factor);
+    GridLib::Grid read_dem_grid(const std::string& file_name,
+                                GridLib::Unit desired_unit,
+                                unsigned thread_count,
+                                const ProgressCallback& progress_callback)
+    {
+        return read_dem_grid_impl(file_name, desired_unit, thread_count,
+                                  nullptr, progress_callback);
+    }
 
-        Chorasmia::MutableArrayView2D<double> values;
-        auto rows = a.rows.value_or(1);
+    GridLib::Grid read_dem_grid(const std::string& file_name,
+                                GridLib::Unit desired_unit,
+                                unsigned thread_count,
+                                ElevationStatistics& statistics,
+                                const ProgressCallback& progress_callback)
+    {
+        return read_dem_grid_impl(file_name, desired_unit, thread_count,
+                                  &statistics, progress_callback);
+    }
+
+    CompactGrid read_compact_dem_grid(const std::string& file_name,
+                                      GridLib::Unit desired_unit,
+                                      unsigned thread_count,
+                                      const ProgressCallback& progress_callback)
+    {
+        return read_compact_dem_grid_impl(file_name, desired_unit,
+                                          thread_count, nullptr,
+                                          progress_callback);
+    }
+
+    CompactGrid read_compact_dem_grid(const std::string& file_name,
+                                      GridLib::Unit desired_unit,
+                                      unsigned thread_count,
+                                      ElevationStatistics& statistics,
+                                      const ProgressCallback& progress_callback)
+    {
+        return read_compact_dem_grid_impl(file_name, desired_unit,
+                                          thread_count, &statistics,
+                                          progress_callback);
+    }
+
+    CompactGrid read_compact_dem_grid(DemReader& reader,
+                                      GridLib::Unit desired_unit,
+                                      const ProgressCallback& progress_callback)
+    {
+        CompactGrid grid;
+        auto& a = reader.record_a();
+        grid.set_factor(initialize_grid(grid.metadata(), a, desired_unit));
+
+        Chorasmia::MutableArrayView2D<int16_t> values;
         auto cols = a.columns.value_or(1);
-        bool is0 = false;
-        while (auto b = reader.next_record_b())
+        RecordB b;
+        std::vector<int16_t> elevations;
+        while (reader.next_record_b(b, elevations))
         {
             if (values.empty())
             {
-                if (rows == 1)
-                    rows = b->rows;
-                // DEM files uses columnCount (x) as the major axis.
-                grid.resize(cols, rows);
-                values = grid.elevations();
+                resize_grid(grid, a, b.rows);
+                values = grid.values();
             }
-            for (int i = 0; i < b->columns; ++i)
+            write_record_b(values, b, elevations);
+            if (progress_callback && !progress_callback(b.column, cols))
+                return {};
+        }
+
+        return grid;
+    }
+
+    CompactGrid read_compact_dem_grid(const std::string& file_name,
+                                      GridLib::Unit desired_unit,
+                                      const DemWindow& window,
+                                      const ProgressCallback& progress_callback)
+    {
+        Dem::DemReader reader(file_name);
+        return read_compact_dem_grid(reader, desired_unit, window,
+                                     progress_callback);
+    }
+
+    CompactGrid read_compact_dem_grid(DemReader& reader,
+                                      GridLib::Unit desired_unit,
+                                      const DemWindow& window,
+                                      const ProgressCallback& progress_callback)
+    {
+        return read_dem_grid_window<CompactGrid>(reader, desired_unit,
+                                                 window, progress_callback);
+    }
+
+    namespace
+    {
+        /**
+         * @brief The state of a file that is being read by read_dem_grids.
+         */
+        struct BatchFile
+        {
+            size_t file_index = 0;
+            MemoryMappedFile file;
+            std::unique_ptr<DemReader> reader;
+            bool compressed = false;
+            DemIndex index;
+            GridLib::Grid grid;
+            Chorasmia::MutableArrayView2D<double> values;
+            double factor = 1.0;
+            size_t grid_size = 0;
+            /// The number of profiles that have been read. Protected by
+            /// the callback mutex.
+            size_t completed = 0;
+            std::atomic<size_t> remaining_tasks = 0;
+        };
+
+        /**
+         * @brief The number of profiles below which a file isn't divided
+         *  into more tasks.
+         */
+        constexpr size_t MIN_PROFILES_PER_TASK = 16;
+
+        unsigned get_thread_count(unsigned thread_count)
+        {
+            if (thread_count == 0)
+                return std::max(std::thread::hardware_concurrency(), 1u);
+            return thread_count;
+        }
+
+        /**
+         * @brief Reads a number of DEM files with a pool of threads that
+         *  share both files and profiles between them.
+         *
+         * A worker first runs the tasks in its own queue, then steals
+         * tasks from the other workers, and only when there are none
+         * left does it open the next file. Opening a file divides its
+         * profiles into tasks in the worker's queue.
+         */
+        class BatchReader
+        {
+        public:
+            BatchReader(const std::vector<std::string>& file_names,
+                        const ReadDemGridsOptions& options,
+                        const GridCallback& grid_callback,
+                        const FileProgressCallback& progress_callback)
+                : m_FileNames(file_names),
+                  m_Options(options),
+                  m_GridCallback(grid_callback),
+                  m_ProgressCallback(progress_callback),
+                  m_Queues(get_thread_count(options.thread_count))
+            {}
+
+            bool run()
             {
-                for (int j = 0; j < b->rows; ++j)
+                std::vector<std::thread> threads;
+                for (size_t i = 1; i < m_Queues.size(); ++i)
+                    threads.emplace_back([this, i] {work(i);});
+                work(0);
+                for (auto& thread : threads)
+                    thread.join();
+
+                if (m_Error)
+                    std::rethrow_exception(m_Error);
+                return !m_Stop;
+            }
+        private:
+            void work(size_t worker)
+            {
+                while (true)
                 {
-                    auto elev = b->elevations[i * b->rows + j];
-                    values(i + b->column - 1, j + b->row - 1) = elev * factor;
+                    // Any change after this point wakes the worker if it
+                    // doesn't find anything to do.
+                    uint64_t events;
+                    {
+                        std::lock_guard lock(m_Mutex);
+                        if (m_Stop || m_FinishedFiles == m_FileNames.size())
+                            return;
+                        events = m_Events;
+                    }
+
+                    try
+                    {
+                        if (auto task = find_task(worker))
+                        {
+                            (*task)();
+                            continue;
+                        }
+                        if (start_next_file(worker))
+                            continue;
+                    }
+                    catch (...)
+                    {
+                        {
+                            std::lock_guard lock(m_Mutex);
+                            if (!m_Error)
+                                m_Error = std::current_exception();
+                        }
+                        stop();
+                        return;
+                    }
+
+                    std::unique_lock lock(m_Mutex);
+                    m_Condition.wait(lock, [&] {return m_Events != events;});
                 }
             }
-            if (progress_callback && !progress_callback(b->column, cols))
+
+            std::optional<Task> find_task(size_t worker)
+            {
+                if (auto task = m_Queues[worker].pop())
+                    return task;
+                for (size_t i = 1; i < m_Queues.size(); ++i)
+                {
+                    auto j = (worker + i) % m_Queues.size();
+                    if (auto task = m_Queues[j].steal())
+                        return task;
+                }
                 return {};
-        }
+            }
 
-        return grid;
+            /**
+             * @brief Opens the next file and adds its tasks to
+             *  @a worker's queue, unless the file's grid would exceed
+             *  the memory budget.
+             */
+            bool start_next_file(size_t worker)
+            {
+                // Workers that don't get the lock wait for the one that
+                // does to start the file.
+                std::unique_lock start_lock(m_StartMutex, std::try_to_lock);
+                if (!start_lock.owns_lock())
+                    return false;
+
+                if (!m_NextFile)
+                {
+                    if (m_NextFileIndex == m_FileNames.size())
+                        return false;
+                    m_NextFile = open_file(m_NextFileIndex++);
+                }
+
+                {
+                    std::lock_guard lock(m_Mutex);
+                    auto budget = m_Options.memory_budget;
+                    if (budget != 0 && m_ActiveFiles != 0
+                        && m_UsedMemory + m_NextFile->grid_size > budget)
+                    {
+                        return false;
+                    }
+                    m_UsedMemory += m_NextFile->grid_size;
+                    ++m_ActiveFiles;
+                }
+
+                auto file = std::move(m_NextFile);
+                start_lock.unlock();
+                add_tasks(worker, file);
+                return true;
+            }
+
+            std::shared_ptr<BatchFile> open_file(size_t file_index)
+            {
+                const auto& file_name = m_FileNames[file_index];
+                auto result = std::make_shared<BatchFile>();
+                result->file_index = file_index;
+                try
+                {
+                    result->file = MemoryMappedFile(file_name);
+                    if (is_compressed(result->file))
+                    {
+                        // Compressed files can only be decoded from start
+                        // to end.
+                        result->file = MemoryMappedFile();
+                        result->compressed = true;
+                        result->reader = std::make_unique<DemReader>(
+                            file_name);
+                    }
+                    else
+                    {
+                        result->reader = std::make_unique<DemReader>(
+                            result->file.data(), result->file.size());
+                        result->index = result->reader->index();
+                    }
+
+                    auto& a = result->reader->record_a();
+                    result->factor = initialize_grid(result->grid, a,
+                                                     m_Options.vertical_unit);
+                    if (auto first = result->reader->peek_record_b())
+                    {
+                        result->grid_size = size_t(a.columns.value_or(1))
+                                            * get_row_count(a, first->rows)
+                                            * sizeof(double);
+                    }
+                }
+                catch (std::exception& ex)
+                {
+                    DEM_THROW_STRING(file_name + ": " + ex.what());
+                }
+                return result;
+            }
+
+            void add_tasks(size_t worker,
+                           const std::shared_ptr<BatchFile>& file)
+            {
+                auto& queue = m_Queues[worker];
+                if (file->compressed)
+                {
+                    file->remaining_tasks = 1;
+                    queue.push([this, file] {read_compressed_file(file);});
+                }
+                else if (file->index.empty())
+                {
+                    finish_file(*file);
+                    return;
+                }
+                else
+                {
+                    const auto& index = file->index;
+                    resize_grid(file->grid, file->reader->record_a(),
+                                index[0].rows);
+                    file->values = file->grid.elevations();
+
+                    // Divide the file between all the workers, with a few
+                    // tasks each to even out the load.
+                    auto task_count = m_Queues.size() * 4;
+                    auto chunk = std::max((index.size() + task_count - 1)
+                                          / task_count,
+                                          MIN_PROFILES_PER_TASK);
+                    file->remaining_tasks = (index.size() + chunk - 1)
+                                            / chunk;
+                    for (size_t i = 0; i < index.size(); i += chunk)
+                    {
+                        auto j = std::min(i + chunk, index.size());
+                        queue.push([this, file, i, j]
+                                   {read_profiles(file, i, j);});
+                    }
+                }
+                notify();
+            }
+
+            void read_profiles(const std::shared_ptr<BatchFile>& file,
+                               size_t first, size_t last)
+            {
+                if (m_Stop)
+                    return;
+
+                try
+                {
+                    RecordB b;
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        const auto& info = file->index[i];
+                        FortranReader b_reader(file->file.data() + info.offset,
+                                               info.size);
+                        Dem::read_record_b(b_reader, b);
+                        write_record_b(file->values, b, file->factor);
+                    }
+                }
+                catch (std::exception& ex)
+                {
+                    DEM_THROW_STRING(m_FileNames[file->file_index] + ": "
+                                     + ex.what());
+                }
+
+                if (m_ProgressCallback)
+                {
+                    std::lock_guard lock(m_CallbackMutex);
+                    file->completed += last - first;
+                    if (!m_Stop && !m_ProgressCallback(file->file_index,
+                                                       file->completed,
+                                                       file->index.size()))
+                    {
+                        stop();
+                    }
+                }
+
+                if (--file->remaining_tasks == 0)
+                    finish_file(*file);
+            }
+
+            void read_compressed_file(const std::shared_ptr<BatchFile>& file)
+            {
+                if (m_Stop)
+                    return;
+
+                ProgressCallback progress;
+                if (m_ProgressCallback)
+                {
+                    progress = [this, &file](size_t step, size_t steps)
+                    {
+                        std::lock_guard lock(m_CallbackMutex);
+                        if (!m_Stop && !m_ProgressCallback(file->file_index,
+                                                           step, steps))
+                        {
+                            stop();
+                        }
+                        return !m_Stop;
+                    };
+                }
+
+                try
+                {
+                    file->grid = read_dem_grid(*file->reader,
+                                               m_Options.vertical_unit,
+                                               progress);
+                }
+                catch (std::exception& ex)
+                {
+                    DEM_THROW_STRING(m_FileNames[file->file_index] + ": "
+                                     + ex.what());
+                }
+                file->reader.reset();
+
+                if (--file->remaining_tasks == 0)
+                    finish_file(*file);
+            }
+
+            void finish_file(BatchFile& file)
+            {
+                if (m_GridCallback)
+                {
+                    std::lock_guard lock(m_CallbackMutex);
+                    if (!m_Stop && !m_GridCallback(file.file_index,
+                                                   std::move(file.grid)))
+                    {
+                        stop();
+                    }
+                }
+                // Release the memory before it's returned to the budget.
+                file.values = {};
+                file.grid = GridLib::Grid();
+                file.file = MemoryMappedFile();
+
+                {
+                    std::lock_guard lock(m_Mutex);
+                    m_UsedMemory -= file.grid_size;
+                    --m_ActiveFiles;
+                    ++m_FinishedFiles;
+                    ++m_Events;
+                }
+                m_Condition.notify_all();
+            }
+
+            void stop()
+            {
+                m_Stop = true;
+                notify();
+            }
+
+            void notify()
+            {
+                {
+                    std::lock_guard lock(m_Mutex);
+                    ++m_Events;
+                }
+                m_Condition.notify_all();
+            }
+
+            const std::vector<std::string>& m_FileNames;
+            ReadDemGridsOptions m_Options;
+            const GridCallback& m_GridCallback;
+            const FileProgressCallback& m_ProgressCallback;
+            std::vector<WorkStealingQueue> m_Queues;
+
+            std::atomic<bool> m_Stop = false;
+            std::mutex m_CallbackMutex;
+
+            /// Protects opening the next file.
+            std::mutex m_StartMutex;
+            size_t m_NextFileIndex = 0;
+            std::shared_ptr<BatchFile> m_NextFile;
+
+            std::mutex m_Mutex;
+            std::condition_variable m_Condition;
+            uint64_t m_Events = 0;
+            size_t m_UsedMemory = 0;
+            size_t m_ActiveFiles = 0;
+            size_t m_FinishedFiles = 0;
+            std::exception_ptr m_Error;
+        };
+    }
+
+    bool read_dem_grids(const std::vector<std::string>& file_names,
+                        const ReadDemGridsOptions& options,
+                        const GridCallback& grid_callback,
+                        const FileProgressCallback& progress_callback)
+    {
+        BatchReader reader(file_names, options, grid_callback,
+                           progress_callback);
+        return reader.run();
+    }
+
+    std::vector<GridLib::Grid>
+    read_dem_grids(const std::vector<std::string>& file_names,
+                   const ReadDemGridsOptions& options,
+                   const FileProgressCallback& progress_callback)
+    {
+        std::vector<GridLib::Grid> grids(file_names.size());
+        GridCallback store = [&grids](size_t file_index, GridLib::Grid&& grid)
+        {
+            grids[file_index] = std::move(grid);
+            return true;
+        };
+        if (!read_dem_grids(file_names, options, store, progress_callback))
+            return {};
+        return grids;
     }
 }
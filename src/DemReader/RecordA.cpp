@@ -7,6 +7,7 @@
 //****************************************************************************
 #include "DemReader/RecordA.hpp"
 
+#include <iterator>
 #include <ostream>
 #include "FortranReader.hpp"
 #include "PrintMacros.hpp"
@@ -100,21 +101,23 @@ namespace Dem
         result.elevation_pattern_code = reader.read_int16(6);
         result.ref_sys = reader.read_int16(6);
         result.ref_sys_zone = reader.read_int16(6);
-        for (auto& param : result.map_projection_params)
-            param = reader.read_float64(24);
+        reader.read_float64s(24, std::size(result.map_projection_params),
+                             result.map_projection_params);
         result.horizontal_unit = reader.read_int16(6);
         result.vertical_unit = reader.read_int16(6);
         result.polygon_sides = reader.read_int16(6);
-        for (auto& corner : result.quadrangle_corners)
+        std::optional<double> values[11];
+        reader.read_float64s(24, std::size(values), values);
+        for (size_t i = 0; i < std::size(result.quadrangle_corners); ++i)
         {
-            auto e = reader.read_float64(24);
-            auto n = reader.read_float64(24);
+            auto& e = values[2 * i];
+            auto& n = values[2 * i + 1];
             if (e && n)
-                corner = {*e, *n};
+                result.quadrangle_corners[i] = {*e, *n};
         }
-        result.min_elevation = reader.read_float64(24);
-        result.max_elevation = reader.read_float64(24);
-        result.rotation_angle = reader.read_float64(24);
+        result.min_elevation = values[8];
+        result.max_elevation = values[9];
+        result.rotation_angle = values[10];
         result.elevation_accuracy = reader.read_int16(6);
         result.x_resolution = reader.read_float32(12);
         result.y_resolution = reader.read_float32(12);
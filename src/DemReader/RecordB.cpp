@@ -7,37 +7,138 @@
 //****************************************************************************
 #include "DemReader/RecordB.hpp"
 
+#include <algorithm>
+#include <string>
+#include "DemReader/DemException.hpp"
+#include "DemReader/ElevationStatistics.hpp"
+#include "DecodeElevations.hpp"
 #include "FortranReader.hpp"
 
 namespace Dem
 {
-    constexpr size_t BLOCK_SIZE = 1024;
+    namespace
+    {
+        constexpr size_t FIELDS_PER_BLOCK = DEM_BLOCK_SIZE
+                                            / ELEVATION_FIELD_SIZE;
+        constexpr size_t FIELDS_IN_FIRST_BLOCK = (DEM_BLOCK_SIZE
+                                                  - RECORD_B_HEADER_SIZE)
+                                                 / ELEVATION_FIELD_SIZE;
+
+        template <typename T>
+        void read_elevations(FortranReader& reader, const RecordB& header,
+                             size_t first, size_t count, T* values,
+                             ElevationStatistics* statistics)
+        {
+            auto total = size_t(header.rows) * size_t(header.columns);
+            first = std::min(first, total);
+            auto last = first + std::min(count, total - first);
+
+            // All positions are relative to the start of the record.
+            size_t pos = RECORD_B_HEADER_SIZE;
+            size_t blockStart = RECORD_B_HEADER_SIZE;
+            size_t capacity = FIELDS_IN_FIRST_BLOCK;
+            size_t index = 0;
+            while (index < last)
+            {
+                auto end = std::min(index + capacity, total);
+                if (first < end)
+                {
+                    auto lo = std::max(first, index);
+                    auto n = std::min(last, end) - lo;
+                    auto offset = blockStart
+                                  + (lo - index) * ELEVATION_FIELD_SIZE;
+                    reader.skip(offset - pos);
+                    auto str = reader.read_string(n * ELEVATION_FIELD_SIZE,
+                                                  false);
+                    auto decoded = decode_elevations(str, values, n);
+                    if (decoded != n)
+                    {
+                        auto field = str.substr(decoded * ELEVATION_FIELD_SIZE,
+                                                ELEVATION_FIELD_SIZE);
+                        DEM_THROW_STRING(std::string("Invalid elevation: '")
+                                         + std::string(field) + "'");
+                    }
+                    if (statistics)
+                        statistics->add(values, n);
+                    values += n;
+                    pos = offset + n * ELEVATION_FIELD_SIZE;
+                }
+                index = end;
+                blockStart = (blockStart / DEM_BLOCK_SIZE + 1)
+                             * DEM_BLOCK_SIZE;
+                capacity = FIELDS_PER_BLOCK;
+            }
+
+            reader.skip(get_record_b_size(header.rows, header.columns)
+                        - pos);
+        }
+    }
+
     RecordB read_record_b(FortranReader& reader)
     {
         RecordB result;
+        read_record_b(reader, result);
+        return result;
+    }
+
+    void read_record_b(FortranReader& reader, RecordB& result,
+                       ElevationStatistics* statistics)
+    {
+        read_record_b_header(reader, result);
+        result.elevations.resize(size_t(result.rows) * size_t(result.columns));
+        read_record_b_elevations(reader, result, 0, result.elevations.size(),
+                                 result.elevations.data(), statistics);
+    }
+
+    RecordB read_record_b_header(FortranReader& reader)
+    {
+        RecordB result;
+        read_record_b_header(reader, result);
+        return result;
+    }
+
+    void read_record_b_header(FortranReader& reader, RecordB& result)
+    {
         result.row = *reader.read_int16(6);
         result.column = *reader.read_int16(6);
         result.rows = *reader.read_int16(6);
         result.columns = *reader.read_int16(6);
-        result.x = *reader.read_float64(24);
-        result.y = *reader.read_float64(24);
-        result.elevation_base = *reader.read_float64(24);
-        result.elevation_min = reader.read_float64(24);
-        result.elevation_max = reader.read_float64(24);
-
-        size_t blockPos = 4 * 6 + 5 * 24;
-        size_t remainder = result.rows * result.columns;
-        result.elevations.reserve(remainder);
-        while (remainder > 0)
-        {
-            auto n = std::min((BLOCK_SIZE - blockPos) / 6, remainder);
-            for (size_t i = 0; i < n; ++i)
-                result.elevations.push_back(*reader.read_int16(6));
-            remainder -= n;
-            blockPos += n * 6;
-            reader.skip(BLOCK_SIZE - blockPos);
-            blockPos = 0;
-        }
-        return result;
+        std::optional<double> values[5];
+        reader.read_float64s(24, 5, values);
+        if (!values[0] || !values[1] || !values[2])
+            DEM_THROW("Record B lacks coordinates or elevation base.");
+        result.x = *values[0];
+        result.y = *values[1];
+        result.elevation_base = *values[2];
+        result.elevation_min = values[3];
+        result.elevation_max = values[4];
+    }
+
+    void read_record_b_elevations(FortranReader& reader,
+                                  const RecordB& header,
+                                  size_t first, size_t count,
+                                  int32_t* values,
+                                  ElevationStatistics* statistics)
+    {
+        read_elevations(reader, header, first, count, values, statistics);
+    }
+
+    void read_record_b_elevations(FortranReader& reader,
+                                  const RecordB& header,
+                                  size_t first, size_t count,
+                                  int16_t* values,
+                                  ElevationStatistics* statistics)
+    {
+        read_elevations(reader, header, first, count, values, statistics);
+    }
+
+    size_t get_record_b_size(int16_t rows, int16_t columns)
+    {
+        size_t count = size_t(rows) * size_t(columns);
+        if (count <= FIELDS_IN_FIRST_BLOCK)
+            return DEM_BLOCK_SIZE;
+        count -= FIELDS_IN_FIRST_BLOCK;
+        auto blocks = (count + FIELDS_PER_BLOCK - 1) / FIELDS_PER_BLOCK;
+        return (1 + blocks) * DEM_BLOCK_SIZE;
     }
 }
@@ -0,0 +1,122 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-06.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "ScaleElevations.hpp"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define DEMREADER_SSE2
+#endif
+
+namespace Dem
+{
+    namespace
+    {
+        template <typename T>
+        void scale_scalar(const T* values, size_t count,
+                          double factor, double* result)
+        {
+            for (size_t i = 0; i < count; ++i)
+                result[i] = values[i] * factor;
+        }
+    }
+
+#if defined(__AVX2__)
+
+    void scale_elevations(const int32_t* values, size_t count,
+                          double factor, double* result)
+    {
+        const auto f = _mm256_set1_pd(factor);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto lo = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(values + i));
+            auto hi = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(values + i + 4));
+            _mm256_storeu_pd(result + i,
+                             _mm256_mul_pd(_mm256_cvtepi32_pd(lo), f));
+            _mm256_storeu_pd(result + i + 4,
+                             _mm256_mul_pd(_mm256_cvtepi32_pd(hi), f));
+        }
+        scale_scalar(values + i, count - i, factor, result + i);
+    }
+
+    void scale_elevations(const int16_t* values, size_t count,
+                          double factor, double* result)
+    {
+        const auto f = _mm256_set1_pd(factor);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto v = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(values + i));
+            auto lo = _mm_cvtepi16_epi32(v);
+            auto hi = _mm_cvtepi16_epi32(_mm_unpackhi_epi64(v, v));
+            _mm256_storeu_pd(result + i,
+                             _mm256_mul_pd(_mm256_cvtepi32_pd(lo), f));
+            _mm256_storeu_pd(result + i + 4,
+                             _mm256_mul_pd(_mm256_cvtepi32_pd(hi), f));
+        }
+        scale_scalar(values + i, count - i, factor, result + i);
+    }
+
+#elif defined(DEMREADER_SSE2)
+
+    void scale_elevations(const int32_t* values, size_t count,
+                          double factor, double* result)
+    {
+        const auto f = _mm_set1_pd(factor);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            auto v = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(values + i));
+            _mm_storeu_pd(result + i, _mm_mul_pd(_mm_cvtepi32_pd(v), f));
+            v = _mm_unpackhi_epi64(v, v);
+            _mm_storeu_pd(result + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(v), f));
+        }
+        scale_scalar(values + i, count - i, factor, result + i);
+    }
+
+    void scale_elevations(const int16_t* values, size_t count,
+                          double factor, double* result)
+    {
+        const auto f = _mm_set1_pd(factor);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            // Sign-extend by placing each value in the upper half of a
+            // 32-bit lane and shifting it down.
+            auto v = _mm_loadl_epi64(
+                reinterpret_cast<const __m128i*>(values + i));
+            v = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            _mm_storeu_pd(result + i, _mm_mul_pd(_mm_cvtepi32_pd(v), f));
+            v = _mm_unpackhi_epi64(v, v);
+            _mm_storeu_pd(result + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(v), f));
+        }
+        scale_scalar(values + i, count - i, factor, result + i);
+    }
+
+#else
+
+    void scale_elevations(const int32_t* values, size_t count,
+                          double factor, double* result)
+    {
+        scale_scalar(values, count, factor, result);
+    }
+
+    void scale_elevations(const int16_t* values, size_t count,
+                          double factor, double* result)
+    {
+        scale_scalar(values, count, factor, result);
+    }
+
+#endif
+}
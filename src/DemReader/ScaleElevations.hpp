@@ -0,0 +1,23 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-06.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace Dem
+{
+    /**
+     * @brief Writes @a values[i] * @a factor to @a result[i] for
+     *  i in [0, count).
+     */
+    void scale_elevations(const int32_t* values, size_t count,
+                          double factor, double* result);
+
+    void scale_elevations(const int16_t* values, size_t count,
+                          double factor, double* result);
+}
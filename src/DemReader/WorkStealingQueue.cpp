@@ -0,0 +1,37 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-20.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "WorkStealingQueue.hpp"
+
+namespace Dem
+{
+    void WorkStealingQueue::push(Task task)
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Tasks.push_back(std::move(task));
+    }
+
+    std::optional<Task> WorkStealingQueue::pop()
+    {
+        std::lock_guard lock(m_Mutex);
+        if (m_Tasks.empty())
+            return {};
+        auto task = std::move(m_Tasks.back());
+        m_Tasks.pop_back();
+        return task;
+    }
+
+    std::optional<Task> WorkStealingQueue::steal()
+    {
+        std::lock_guard lock(m_Mutex);
+        if (m_Tasks.empty())
+            return {};
+        auto task = std::move(m_Tasks.front());
+        m_Tasks.pop_front();
+        return task;
+    }
+}
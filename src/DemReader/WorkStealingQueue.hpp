@@ -0,0 +1,38 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-20.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+
+namespace Dem
+{
+    using Task = std::function<void ()>;
+
+    /**
+     * @brief The task queue of a single worker thread in a pool where
+     *  idle workers take tasks from the queues of busy ones.
+     *
+     * The owner pushes and pops tasks at the back, which means it works
+     * on the most recently added tasks while their data are likely to
+     * still be in the cache. Other workers steal from the front.
+     */
+    class WorkStealingQueue
+    {
+    public:
+        void push(Task task);
+
+        std::optional<Task> pop();
+
+        std::optional<Task> steal();
+    private:
+        std::mutex m_Mutex;
+        std::deque<Task> m_Tasks;
+    };
+}
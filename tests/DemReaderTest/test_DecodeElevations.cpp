@@ -0,0 +1,165 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <random>
+#include <string>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "DecodeElevations.hpp"
+
+namespace
+{
+    /**
+     * @brief Returns @a field repeated @a count times, which makes the
+     *  string long enough for the SIMD code.
+     */
+    std::string repeat(const std::string& field, size_t count)
+    {
+        std::string result;
+        for (size_t i = 0; i < count; ++i)
+            result += field;
+        return result;
+    }
+
+    template <typename T>
+    void test_valid_field(const std::string& field, int32_t expected)
+    {
+        CAPTURE(field);
+        REQUIRE(field.size() == Dem::ELEVATION_FIELD_SIZE);
+        auto str = repeat(field, 40);
+        std::vector<T> values(40);
+        REQUIRE(Dem::decode_elevations(str, values.data(), 40) == 40);
+        for (auto value : values)
+            REQUIRE(value == expected);
+    }
+
+    void test_valid(const std::string& field, int32_t expected)
+    {
+        test_valid_field<int32_t>(field, expected);
+        test_valid_field<int16_t>(field, expected);
+    }
+
+    void test_invalid(const std::string& field)
+    {
+        CAPTURE(field);
+        REQUIRE(field.size() == Dem::ELEVATION_FIELD_SIZE);
+        // The malformed field is placed at every position, including
+        // those that are decoded by SIMD code.
+        for (size_t i = 0; i < 20; ++i)
+        {
+            auto str = repeat("   123", i) + field + repeat("   456", 19 - i);
+            std::vector<int32_t> values(20);
+            REQUIRE(Dem::decode_elevations(str, values.data(), 20) == i);
+        }
+    }
+
+    std::string make_random_field(std::mt19937& random)
+    {
+        static const std::vector<std::string> samples = {
+            "     0", "    -0", "    +0", " 32767", "-32768", " 32768",
+            "-32769", "999999", "     7", "7     ", "  -12 ", "-   12",
+            "  1 2 ", "      ", "     -", "  12a4", "+-1234", "--1234",
+            "  0012", "-00001", "+32767", " 1234 ", "12345 ", "\t   12"
+        };
+        std::uniform_int_distribution<size_t> pick(0, samples.size() - 1);
+        std::uniform_int_distribution<int> number(-32768, 32767);
+        if (random() % 2 == 0)
+            return samples[pick(random)];
+        auto text = std::to_string(number(random));
+        return std::string(Dem::ELEVATION_FIELD_SIZE - text.size(), ' ')
+               + text;
+    }
+}
+
+TEST_CASE("decode_elevations with right-justified fields")
+{
+    test_valid("     0", 0);
+    test_valid("     7", 7);
+    test_valid("  1234", 1234);
+    test_valid(" 12345", 12345);
+    test_valid("    -7", -7);
+    test_valid(" -1234", -1234);
+    test_valid("  0012", 12);
+}
+
+TEST_CASE("decode_elevations with left-justified and padded fields")
+{
+    test_valid("7     ", 7);
+    test_valid("-7    ", -7);
+    test_valid(" 1234 ", 1234);
+    test_valid("  -12 ", -12);
+}
+
+TEST_CASE("decode_elevations with signs")
+{
+    test_valid("    +7", 7);
+    test_valid("+32767", 32767);
+    test_valid("    -0", 0);
+    test_valid("    +0", 0);
+    test_invalid("-   12");
+    test_invalid("+-1234");
+    test_invalid("--1234");
+    test_invalid("  12- ");
+}
+
+TEST_CASE("decode_elevations at the limits of int16_t")
+{
+    test_valid(" 32767", 32767);
+    test_valid("-32768", -32768);
+    test_invalid(" 32768");
+    test_invalid("-32769");
+    test_invalid("999999");
+}
+
+TEST_CASE("decode_elevations with blank and malformed fields")
+{
+    test_invalid("      ");
+    test_invalid("     -");
+    test_invalid("     +");
+    test_invalid("  1 2 ");
+    test_invalid("  12a4");
+    test_invalid("\t   12");
+    test_invalid("  1.0 ");
+}
+
+TEST_CASE("decode_elevations stops at the end of the string")
+{
+    auto str = repeat("   123", 10) + "  12";
+    std::vector<int32_t> values(20);
+    REQUIRE(Dem::decode_elevations(str, values.data(), 20) == 10);
+    REQUIRE(values[9] == 123);
+}
+
+TEST_CASE("decode_elevations agrees with decoding one field at a time")
+{
+    // Single fields are always decoded by the scalar code, while long
+    // strings are mostly decoded by the SIMD code, if it is enabled.
+    std::mt19937 random(1234);
+    for (int iteration = 0; iteration < 1000; ++iteration)
+    {
+        std::string str;
+        for (size_t i = 0; i < 37; ++i)
+            str += make_random_field(random);
+
+        std::vector<int32_t> expected(37);
+        size_t expected_count = 0;
+        while (expected_count < 37
+               && Dem::decode_elevations(
+                   std::string_view(str).substr(expected_count * 6, 6),
+                   &expected[expected_count], 1) == 1)
+        {
+            ++expected_count;
+        }
+
+        std::vector<int32_t> values(37);
+        CAPTURE(str);
+        REQUIRE(Dem::decode_elevations(str, values.data(), 37)
+                == expected_count);
+        for (size_t i = 0; i < expected_count; ++i)
+            REQUIRE(values[i] == expected[i]);
+    }
+}
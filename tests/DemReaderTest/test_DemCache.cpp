@@ -0,0 +1,203 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <catch2/catch.hpp>
+#include "DemReader/DemCache.hpp"
+#include "DemReader/DemException.hpp"
+#include "DemReader/DemReader.hpp"
+#include "DemReader/ReadDemGrid.hpp"
+#include "SyntheticDem.hpp"
+
+namespace
+{
+    /// The offset of the version in the cache header.
+    constexpr size_t VERSION_OFFSET = 12;
+
+    std::string make_test_dem(uint32_t seed = 1)
+    {
+        SyntheticDemOptions options;
+        options.columns = 7;
+        options.rows = 300;
+        options.seed = seed;
+        return make_synthetic_dem(options);
+    }
+
+    void write_file(const std::string& path, const std::string& contents)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(contents.data(), std::streamsize(contents.size()));
+        REQUIRE(file);
+    }
+
+    std::string read_file(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>()};
+    }
+
+    void touch(const std::string& path)
+    {
+        auto time = std::filesystem::last_write_time(path);
+        std::filesystem::last_write_time(path,
+                                         time + std::chrono::hours(1));
+    }
+
+    void require_same_values(const Chorasmia::ArrayView2D<int16_t>& values,
+                             const Chorasmia::ArrayView2D<int16_t>& expected)
+    {
+        REQUIRE(values.rowCount() == expected.rowCount());
+        REQUIRE(values.columnCount() == expected.columnCount());
+        for (size_t i = 0; i < values.rowCount(); ++i)
+        {
+            for (size_t j = 0; j < values.columnCount(); ++j)
+            {
+                CAPTURE(i, j);
+                REQUIRE(values(i, j) == expected(i, j));
+            }
+        }
+    }
+
+    Dem::CompactGrid read_raw_grid(const std::string& path)
+    {
+        return Dem::read_compact_dem_grid(path, GridLib::Unit::UNDEFINED);
+    }
+}
+
+TEST_CASE("DemCache returns what write_dem_cache wrote")
+{
+    TemporaryFile dem(make_test_dem());
+    TemporaryFile cache_file;
+    Dem::write_dem_cache(cache_file.path(), dem.path());
+
+    Dem::DemCache cache(cache_file.path());
+    REQUIRE(cache.source() == Dem::get_dem_cache_source(dem.path()));
+    REQUIRE(cache.is_current(dem.path()));
+
+    auto expected = Dem::DemReader(dem.path()).record_a();
+    const auto& a = cache.record_a();
+    REQUIRE(a.ref_sys == expected.ref_sys);
+    REQUIRE(a.ref_sys_zone == expected.ref_sys_zone);
+    REQUIRE(a.horizontal_unit == expected.horizontal_unit);
+    REQUIRE(a.vertical_unit == expected.vertical_unit);
+    REQUIRE(a.horizontal_datum == expected.horizontal_datum);
+    REQUIRE(a.vertical_datum == expected.vertical_datum);
+    REQUIRE(a.x_resolution == expected.x_resolution);
+    REQUIRE(a.y_resolution == expected.y_resolution);
+    REQUIRE(a.z_resolution == expected.z_resolution);
+    REQUIRE(a.rotation_angle == expected.rotation_angle);
+    REQUIRE(a.longitude->degree == expected.longitude->degree);
+    REQUIRE(a.longitude->minute == expected.longitude->minute);
+    REQUIRE(a.longitude->second == expected.longitude->second);
+    REQUIRE(a.latitude->degree == expected.latitude->degree);
+    REQUIRE(a.latitude->minute == expected.latitude->minute);
+    REQUIRE(a.latitude->second == expected.latitude->second);
+    REQUIRE(a.quadrangle_corners[0]->easting
+            == expected.quadrangle_corners[0]->easting);
+    REQUIRE(a.quadrangle_corners[0]->northing
+            == expected.quadrangle_corners[0]->northing);
+    REQUIRE(a.columns == expected.columns);
+
+    require_same_values(cache.values(), read_raw_grid(dem.path()).values());
+}
+
+TEST_CASE("DemCache::is_current")
+{
+    TemporaryFile dem(make_test_dem());
+    TemporaryFile cache_file;
+    Dem::write_dem_cache(cache_file.path(), dem.path());
+    Dem::DemCache cache(cache_file.path());
+    REQUIRE(cache.is_current(dem.path()));
+
+    SECTION("The size changes")
+    {
+        auto time = std::filesystem::last_write_time(dem.path());
+        write_file(dem.path(), make_test_dem() + " ");
+        std::filesystem::last_write_time(dem.path(), time);
+        REQUIRE_FALSE(cache.is_current(dem.path()));
+    }
+
+    SECTION("The modification time changes")
+    {
+        touch(dem.path());
+        REQUIRE_FALSE(cache.is_current(dem.path()));
+    }
+
+    SECTION("The file is removed")
+    {
+        std::filesystem::remove(dem.path());
+        REQUIRE_FALSE(cache.is_current(dem.path()));
+    }
+}
+
+TEST_CASE("DemCache rejects invalid files")
+{
+    TemporaryFile dem(make_test_dem());
+    TemporaryFile cache_file;
+    Dem::write_dem_cache(cache_file.path(), dem.path());
+    auto contents = read_file(cache_file.path());
+    REQUIRE_NOTHROW(Dem::DemCache(cache_file.path()));
+
+    SECTION("Truncated values")
+    {
+        contents.pop_back();
+    }
+
+    SECTION("Truncated header")
+    {
+        contents.resize(50);
+    }
+
+    SECTION("Bad magic")
+    {
+        contents[0] = 'X';
+    }
+
+    SECTION("Wrong version")
+    {
+        ++contents[VERSION_OFFSET];
+    }
+
+    write_file(cache_file.path(), contents);
+    REQUIRE_THROWS_AS(Dem::DemCache(cache_file.path()), Dem::DemException);
+}
+
+TEST_CASE("read_cached_compact_dem_grid replaces a stale cache")
+{
+    TemporaryFile dem(make_test_dem(1));
+    TemporaryFile cache_file;
+    Dem::write_dem_cache(cache_file.path(), dem.path());
+
+    write_file(dem.path(), make_test_dem(2));
+    touch(dem.path());
+    REQUIRE_FALSE(Dem::DemCache(cache_file.path()).is_current(dem.path()));
+
+    auto expected = read_raw_grid(dem.path());
+    auto grid = Dem::read_cached_compact_dem_grid(dem.path(),
+                                                  cache_file.path(),
+                                                  GridLib::Unit::UNDEFINED);
+    require_same_values(grid.values(), expected.values());
+
+    Dem::DemCache cache(cache_file.path());
+    REQUIRE(cache.is_current(dem.path()));
+    require_same_values(cache.values(), expected.values());
+}
+
+TEST_CASE("read_cached_compact_dem_grid when the cache can't be written")
+{
+    TemporaryFile dem(make_test_dem());
+    // A file can't be used as a directory.
+    auto cache_path = dem.path() + "/cache";
+
+    auto grid = Dem::read_cached_compact_dem_grid(dem.path(), cache_path,
+                                                  GridLib::Unit::UNDEFINED);
+    require_same_values(grid.values(), read_raw_grid(dem.path()).values());
+    REQUIRE_FALSE(std::filesystem::exists(cache_path));
+}
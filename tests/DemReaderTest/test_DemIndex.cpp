@@ -0,0 +1,69 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <sstream>
+#include <catch2/catch.hpp>
+#include "DemReader/DemException.hpp"
+#include "DemReader/DemReader.hpp"
+#include "SyntheticDem.hpp"
+
+namespace
+{
+    std::string make_test_dem(int columns)
+    {
+        SyntheticDemOptions options;
+        options.columns = columns;
+        options.rows = 300;
+        return make_synthetic_dem(options);
+    }
+
+    std::string save_index(const std::string& dem)
+    {
+        Dem::DemReader reader(dem.data(), dem.size());
+        std::ostringstream stream;
+        Dem::save_dem_index(reader.index(), stream);
+        return stream.str();
+    }
+}
+
+TEST_CASE("Save and load index")
+{
+    auto dem = make_test_dem(5);
+    std::istringstream stream(save_index(dem));
+    auto index = Dem::load_dem_index(stream);
+    REQUIRE(index.size() == 5);
+    REQUIRE(index.source().size == dem.size());
+
+    Dem::DemReader reader(dem.data(), dem.size());
+    reader.set_index(index);
+    auto record = reader.read_record_b(3);
+    REQUIRE(record.column == 4);
+}
+
+TEST_CASE("Index from a different DEM file")
+{
+    auto dem = make_test_dem(5);
+    std::istringstream stream(save_index(make_test_dem(6)));
+    auto index = Dem::load_dem_index(stream);
+
+    Dem::DemReader reader(dem.data(), dem.size());
+    REQUIRE_THROWS_AS(reader.set_index(index), Dem::DemException);
+
+    stream.clear();
+    stream.seekg(0);
+    Dem::DemIndexSource source{dem.size()};
+    REQUIRE_THROWS_AS(Dem::load_dem_index(stream, source),
+                      Dem::DemException);
+}
+
+TEST_CASE("Index with more records than it contains")
+{
+    std::istringstream stream("DEMINDEX 2\n1000 0\n"
+                              "18446744073709551615\n"
+                              "0 1024 1 1 300 1\n");
+    REQUIRE_THROWS_AS(Dem::load_dem_index(stream), Dem::DemException);
+}
@@ -0,0 +1,222 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "DemReader/DemException.hpp"
+#include "DemReader/DemMosaic.hpp"
+#include "DemReader/DemReader.hpp"
+#include "SyntheticDem.hpp"
+
+namespace
+{
+    constexpr int16_t UNKNOWN = -32767;
+    constexpr double RESOLUTION = 30;
+    constexpr double EASTING = 500000;
+    constexpr double NORTHING = 5000000;
+
+    SyntheticDemOptions make_options(int column, int row, uint32_t seed)
+    {
+        SyntheticDemOptions options;
+        options.columns = 8;
+        options.rows = 10;
+        options.void_percentage = 20;
+        options.seed = seed;
+        options.easting = EASTING + column * RESOLUTION;
+        options.northing = NORTHING + row * RESOLUTION;
+        return options;
+    }
+
+    struct Mosaic
+    {
+        std::vector<std::unique_ptr<TemporaryFile>> files;
+        std::vector<std::string> paths;
+    };
+
+    Mosaic make_mosaic(const std::vector<SyntheticDemOptions>& options)
+    {
+        Mosaic result;
+        for (const auto& o : options)
+        {
+            result.files.push_back(
+                std::make_unique<TemporaryFile>(make_synthetic_dem(o)));
+            result.paths.push_back(result.files.back()->path());
+        }
+        return result;
+    }
+
+    /**
+     * @brief Places every elevation in @a paths by its coordinates in
+     *  the straightforward way, on a grid of @a rows x @a columns whose
+     *  south-west corner is at EASTING, NORTHING.
+     */
+    std::vector<int16_t> make_expected(const std::vector<std::string>& paths,
+                                       size_t rows, size_t columns,
+                                       Dem::MosaicOverlap overlap)
+    {
+        std::vector<int16_t> result(rows * columns, UNKNOWN);
+        for (const auto& path : paths)
+        {
+            Dem::DemReader reader(path);
+            Dem::RecordB b;
+            std::vector<int16_t> elevations;
+            while (reader.next_record_b(b, elevations))
+            {
+                auto row = size_t((b.x - EASTING) / RESOLUTION);
+                auto column = size_t((b.y - NORTHING) / RESOLUTION);
+                for (size_t i = 0; i < elevations.size(); ++i)
+                {
+                    auto& value = result[row * columns + column + i];
+                    if (elevations[i] == UNKNOWN)
+                        continue;
+                    if (overlap == Dem::MosaicOverlap::LAST
+                        || value == UNKNOWN)
+                    {
+                        value = elevations[i];
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    void require_values(const GridLib::Grid& grid,
+                        const std::vector<int16_t>& expected)
+    {
+        auto values = grid.elevations();
+        for (size_t i = 0; i < grid.rowCount(); ++i)
+        {
+            for (size_t j = 0; j < grid.columnCount(); ++j)
+            {
+                CAPTURE(i, j);
+                REQUIRE(values(i, j)
+                        == expected[i * grid.columnCount() + j]);
+            }
+        }
+    }
+
+    void test_mosaic(const std::vector<SyntheticDemOptions>& options,
+                     size_t rows, size_t columns)
+    {
+        auto mosaic = make_mosaic(options);
+        for (auto overlap : {Dem::MosaicOverlap::FIRST,
+                             Dem::MosaicOverlap::LAST})
+        {
+            CAPTURE(int(overlap));
+            Dem::MosaicOptions mosaic_options;
+            mosaic_options.overlap = overlap;
+            auto grid = Dem::build_dem_mosaic(mosaic.paths, mosaic_options);
+            REQUIRE(grid.rowCount() == rows);
+            REQUIRE(grid.columnCount() == columns);
+            REQUIRE(grid.planarCoords());
+            REQUIRE(grid.planarCoords()->easting == EASTING);
+            REQUIRE(grid.planarCoords()->northing == NORTHING);
+            REQUIRE(grid.planarCoords()->zone == 10);
+            require_values(grid, make_expected(mosaic.paths, rows, columns,
+                                               overlap));
+        }
+    }
+}
+
+TEST_CASE("build_dem_mosaic places the files by their profiles")
+{
+    // The second file overlaps the first, the third is further north
+    // and overlaps both.
+    test_mosaic({make_options(2, 0, 1),
+                 make_options(7, 3, 2),
+                 make_options(0, 6, 3)},
+                15, 16);
+}
+
+TEST_CASE("build_dem_mosaic with staggered profiles and unaligned corners")
+{
+    auto first = make_options(0, 0, 1);
+    auto second = make_options(6, 2, 2);
+    for (auto* options : {&first, &second})
+    {
+        options->stagger = 2;
+        options->corner_margin = 7.5;
+    }
+    test_mosaic({first, second}, 14, 12);
+}
+
+TEST_CASE("build_dem_mosaic FIRST and LAST overlap")
+{
+    auto mosaic = make_mosaic({make_options(0, 0, 1),
+                               make_options(0, 0, 2)});
+    Dem::DemReader first(mosaic.paths[0]);
+    Dem::DemReader last(mosaic.paths[1]);
+    auto expected_first = first.next_record_b();
+    auto expected_last = last.next_record_b();
+    REQUIRE(expected_first);
+    REQUIRE(expected_last);
+
+    // Find an elevation that is known in both files.
+    size_t i = 0;
+    while (expected_first->elevations[i] == UNKNOWN
+           || expected_last->elevations[i] == UNKNOWN
+           || expected_first->elevations[i] == expected_last->elevations[i])
+    {
+        ++i;
+    }
+
+    Dem::MosaicOptions options;
+    options.overlap = Dem::MosaicOverlap::FIRST;
+    auto grid = Dem::build_dem_mosaic(mosaic.paths, options);
+    REQUIRE(grid.elevations()(0, i) == expected_first->elevations[i]);
+
+    options.overlap = Dem::MosaicOverlap::LAST;
+    grid = Dem::build_dem_mosaic(mosaic.paths, options);
+    REQUIRE(grid.elevations()(0, i) == expected_last->elevations[i]);
+}
+
+TEST_CASE("build_dem_mosaic never replaces known values with voids")
+{
+    auto known = make_options(0, 0, 1);
+    known.void_percentage = 0;
+    auto voids = make_options(0, 0, 2);
+    voids.void_percentage = 100;
+
+    for (auto overlap : {Dem::MosaicOverlap::FIRST,
+                         Dem::MosaicOverlap::LAST})
+    {
+        CAPTURE(int(overlap));
+        Dem::MosaicOptions options;
+        options.overlap = overlap;
+        auto mosaic = make_mosaic({voids, known, voids});
+        auto grid = Dem::build_dem_mosaic(mosaic.paths, options);
+        auto expected = make_expected({mosaic.paths[1]}, 8, 10, overlap);
+        REQUIRE(std::count(expected.begin(), expected.end(), UNKNOWN) == 0);
+        require_values(grid, expected);
+    }
+}
+
+TEST_CASE("build_dem_mosaic rejects incompatible files")
+{
+    auto other = make_options(8, 0, 2);
+
+    SECTION("Different zones")
+    {
+        other.zone = 11;
+    }
+
+    SECTION("Different resolutions")
+    {
+        other.x_resolution = 10;
+    }
+
+    SECTION("Profiles that aren't on the same lattice")
+    {
+        other.easting += 10;
+    }
+
+    auto mosaic = make_mosaic({make_options(0, 0, 1), other});
+    REQUIRE_THROWS_AS(Dem::build_dem_mosaic(mosaic.paths),
+                      Dem::DemException);
+}
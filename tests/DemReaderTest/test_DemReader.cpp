@@ -0,0 +1,272 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <sstream>
+#include <streambuf>
+#include <catch2/catch.hpp>
+#include "DemReader/DemException.hpp"
+#include "DemReader/DemReader.hpp"
+#include "SyntheticDem.hpp"
+
+namespace
+{
+    std::string make_test_dem()
+    {
+        SyntheticDemOptions options;
+        options.columns = 5;
+        options.rows = 300;
+        return make_synthetic_dem(options);
+    }
+
+    /**
+     * @brief A stream buffer that can't seek, like the one of a pipe.
+     */
+    class PipeStreamBuf : public std::streambuf
+    {
+    public:
+        explicit PipeStreamBuf(std::string& data)
+        {
+            setg(data.data(), data.data(), data.data() + data.size());
+        }
+    };
+
+    void require_same_records(Dem::DemReader& reader,
+                              Dem::DemReader& expected)
+    {
+        size_t count = 0;
+        while (auto b = expected.next_record_b())
+        {
+            auto actual = reader.next_record_b();
+            REQUIRE(actual);
+            REQUIRE(actual->row == b->row);
+            REQUIRE(actual->column == b->column);
+            REQUIRE(actual->rows == b->rows);
+            REQUIRE(actual->columns == b->columns);
+            REQUIRE(actual->x == b->x);
+            REQUIRE(actual->y == b->y);
+            REQUIRE(actual->elevation_base == b->elevation_base);
+            REQUIRE(actual->elevation_min == b->elevation_min);
+            REQUIRE(actual->elevation_max == b->elevation_max);
+            REQUIRE(actual->elevations == b->elevations);
+            ++count;
+        }
+        REQUIRE(count != 0);
+        REQUIRE_FALSE(reader.next_record_b());
+    }
+
+    void require_same_record_c(const std::optional<Dem::RecordC>& c,
+                               const std::optional<Dem::RecordC>& expected)
+    {
+        REQUIRE(c.has_value() == expected.has_value());
+        if (!c)
+            return;
+        REQUIRE(c->has_datum_rmse == expected->has_datum_rmse);
+        REQUIRE(c->has_dem_rmse == expected->has_dem_rmse);
+        for (int i = 0; i < 3; ++i)
+        {
+            REQUIRE(c->datum_rmse[i] == expected->datum_rmse[i]);
+            REQUIRE(c->dem_rmse[i] == expected->dem_rmse[i]);
+        }
+        REQUIRE(c->datum_rmse_sample_size
+                == expected->datum_rmse_sample_size);
+        REQUIRE(c->dem_rmse_sample_size == expected->dem_rmse_sample_size);
+    }
+
+    void test_index_keeps_position(Dem::DemReader& reader)
+    {
+        REQUIRE(reader.next_record_b());
+        REQUIRE(reader.next_record_b());
+        REQUIRE(reader.index().size() == 5);
+        auto record = reader.next_record_b();
+        REQUIRE(record);
+        REQUIRE(record->column == 3);
+        REQUIRE(reader.next_record_b());
+        REQUIRE(reader.next_record_b());
+        REQUIRE_FALSE(reader.next_record_b());
+    }
+
+    void test_index_after_last_record_b(Dem::DemReader& reader)
+    {
+        size_t count = 0;
+        while (reader.next_record_b())
+            ++count;
+        REQUIRE(count == 5);
+        REQUIRE(reader.index().size() == 5);
+        REQUIRE_FALSE(reader.next_record_b());
+    }
+}
+
+TEST_CASE("Building the index doesn't change the next record B")
+{
+    auto dem = make_test_dem();
+
+    SECTION("Memory")
+    {
+        Dem::DemReader reader(dem.data(), dem.size());
+        test_index_keeps_position(reader);
+    }
+
+    SECTION("Stream")
+    {
+        std::istringstream stream(dem);
+        Dem::DemReader reader(stream);
+        test_index_keeps_position(reader);
+    }
+}
+
+TEST_CASE("Building the index after the last record B")
+{
+    auto dem = make_test_dem();
+
+    SECTION("Memory")
+    {
+        Dem::DemReader reader(dem.data(), dem.size());
+        test_index_after_last_record_b(reader);
+    }
+
+    SECTION("Stream")
+    {
+        std::istringstream stream(dem);
+        Dem::DemReader reader(stream);
+        test_index_after_last_record_b(reader);
+    }
+}
+
+TEST_CASE("Single-pass reader on a stream")
+{
+    auto dem = make_test_dem();
+    Dem::DemReader expected(dem.data(), dem.size());
+    REQUIRE(expected.record_c());
+
+    std::istringstream stream(dem);
+    Dem::DemReader reader(stream, Dem::StreamAccess::SINGLE_PASS);
+    REQUIRE_FALSE(reader.record_c());
+
+    SECTION("Reading to the end")
+    {
+        require_same_records(reader, expected);
+        require_same_record_c(reader.record_c(), expected.record_c());
+    }
+
+    SECTION("Random access requires seekable input")
+    {
+        REQUIRE(reader.next_record_b());
+        REQUIRE_THROWS_AS(reader.index(), Dem::DemException);
+        REQUIRE_THROWS_AS(reader.read_record_b(0), Dem::DemException);
+        REQUIRE_THROWS_AS(reader.seek_to_column(1), Dem::DemException);
+        // The reader hasn't moved.
+        auto record = reader.next_record_b();
+        REQUIRE(record);
+        REQUIRE(record->column == 2);
+    }
+}
+
+TEST_CASE("Reading a gzip-compressed stream")
+{
+    auto dem = make_test_dem();
+    auto compressed = gzip(dem);
+    REQUIRE(compressed.size() < dem.size());
+    Dem::DemReader expected(dem.data(), dem.size());
+
+    SECTION("Complete stream")
+    {
+        std::istringstream stream(compressed);
+        Dem::DemReader reader(stream);
+        // Compressed streams can't seek, record C follows the last
+        // record B.
+        REQUIRE_FALSE(reader.record_c());
+        require_same_records(reader, expected);
+        require_same_record_c(reader.record_c(), expected.record_c());
+    }
+
+    SECTION("Truncated stream")
+    {
+        std::istringstream stream(compressed.substr(0, compressed.size() / 2));
+        try
+        {
+            Dem::DemReader reader(stream);
+            while (reader.next_record_b())
+            {}
+            FAIL("The truncated stream was read without errors.");
+        }
+        catch (Dem::DemException& ex)
+        {
+            REQUIRE_THAT(ex.what(),
+                         Catch::Contains("Compressed data ends prematurely"));
+        }
+    }
+}
+
+TEST_CASE("Reading a stream that starts like zstd-compressed data")
+{
+    SECTION("zstd signature")
+    {
+        // Without zstd support the signature is reported, with it the
+        // invalid frame is.
+        std::string data = "\x28\xB5\x2F\xFD" + std::string(2000, 'x');
+        PipeStreamBuf buffer(data);
+        std::istream stream(&buffer);
+        REQUIRE_THROWS_WITH(
+            Dem::DemReader(stream, Dem::StreamAccess::SINGLE_PASS),
+            Catch::Contains("zstd"));
+    }
+
+    SECTION("DEM file that starts with '('")
+    {
+        auto dem = make_test_dem();
+        dem[0] = '(';
+        Dem::DemReader expected(dem.data(), dem.size());
+
+        std::istringstream seekable(dem);
+        Dem::DemReader seekable_reader(seekable);
+        REQUIRE(seekable_reader.record_a().file_name
+                == expected.record_a().file_name);
+        require_same_records(seekable_reader, expected);
+
+        Dem::DemReader expected2(dem.data(), dem.size());
+        PipeStreamBuf buffer(dem);
+        std::istream pipe(&buffer);
+        Dem::DemReader pipe_reader(pipe, Dem::StreamAccess::SINGLE_PASS);
+        REQUIRE(pipe_reader.record_a().file_name
+                == expected2.record_a().file_name);
+        require_same_records(pipe_reader, expected2);
+    }
+}
+
+TEST_CASE("Reading a file with read-ahead")
+{
+    auto dem = make_test_dem();
+    Dem::DemReader expected(dem.data(), dem.size());
+    Dem::ReadAheadOptions options;
+    options.buffer_size = 1000;
+
+    SECTION("Uncompressed file")
+    {
+        TemporaryFile file(dem);
+        Dem::DemReader reader(file.path(), options);
+        require_same_records(reader, expected);
+        require_same_record_c(reader.record_c(), expected.record_c());
+    }
+
+    SECTION("gzip-compressed file")
+    {
+        TemporaryFile file(gzip(dem));
+        Dem::DemReader reader(file.path(), options);
+        require_same_records(reader, expected);
+        require_same_record_c(reader.record_c(), expected.record_c());
+    }
+
+    SECTION("Missing file")
+    {
+        std::string path;
+        {
+            TemporaryFile file;
+            path = file.path();
+        }
+        REQUIRE_THROWS_AS(Dem::DemReader(path, options), Dem::DemException);
+    }
+}
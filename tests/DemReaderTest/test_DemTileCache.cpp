@@ -0,0 +1,142 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "DemReader/DemTileCache.hpp"
+#include "SyntheticDem.hpp"
+
+namespace
+{
+    constexpr size_t ROWS = 12;
+    constexpr size_t COLUMNS = 200;
+
+    std::string make_test_dem()
+    {
+        SyntheticDemOptions options;
+        options.columns = int(ROWS);
+        options.rows = int(COLUMNS);
+        return make_synthetic_dem(options);
+    }
+
+    size_t get_tile_size(size_t rows, size_t columns)
+    {
+        return sizeof(GridLib::Grid) + rows * columns * sizeof(double);
+    }
+
+    void require_statistics(const Dem::DemTileCache& cache,
+                            size_t hits, size_t misses, size_t evictions)
+    {
+        auto statistics = cache.statistics();
+        REQUIRE(statistics.hits == hits);
+        REQUIRE(statistics.misses == misses);
+        REQUIRE(statistics.evictions == evictions);
+    }
+}
+
+TEST_CASE("DemTileCache hits and misses")
+{
+    TemporaryFile file(make_test_dem());
+    Dem::DemTileCache cache(SIZE_MAX);
+
+    auto grid = cache.get(file.path());
+    REQUIRE(grid->rowCount() == ROWS);
+    REQUIRE(grid->columnCount() == COLUMNS);
+    require_statistics(cache, 0, 1, 0);
+
+    REQUIRE(cache.get(file.path()) == grid);
+    require_statistics(cache, 1, 1, 0);
+
+    SECTION("Windows that cover the entire grid")
+    {
+        REQUIRE(cache.get(file.path(), {0, 0, ROWS, COLUMNS}) == grid);
+        REQUIRE(cache.get(file.path(), {0, 0, ROWS + 5, SIZE_MAX}) == grid);
+        require_statistics(cache, 3, 1, 0);
+    }
+
+    SECTION("Other names for the same file")
+    {
+        std::filesystem::path path(file.path());
+        auto dotted = (path.parent_path() / "." / path.filename()).string();
+        REQUIRE(cache.get(dotted) == grid);
+        auto relative = std::filesystem::relative(path).string();
+        REQUIRE(cache.get(relative) == grid);
+        require_statistics(cache, 3, 1, 0);
+    }
+
+    SECTION("Windows that are clamped to the same tile")
+    {
+        auto tile = cache.get(file.path(), {5, 150, 10, 100});
+        REQUIRE(tile->rowCount() == ROWS - 5);
+        REQUIRE(tile->columnCount() == COLUMNS - 150);
+        require_statistics(cache, 1, 2, 0);
+        REQUIRE(cache.get(file.path(), {5, 150, ROWS - 5, COLUMNS - 150})
+                == tile);
+        REQUIRE(cache.get(file.path(), {5, 150, SIZE_MAX, SIZE_MAX})
+                == tile);
+        require_statistics(cache, 3, 2, 0);
+        REQUIRE(cache.statistics().tile_count == 2);
+    }
+}
+
+TEST_CASE("DemTileCache evicts the least recently used tiles")
+{
+    TemporaryFile file(make_test_dem());
+    auto tile_size = get_tile_size(2, 10);
+    Dem::DemTileCache cache(2 * tile_size);
+
+    auto tile1 = cache.get(file.path(), {0, 0, 2, 10});
+    auto tile2 = cache.get(file.path(), {2, 0, 2, 10});
+    REQUIRE(cache.statistics().memory_usage == 2 * tile_size);
+    REQUIRE(cache.get(file.path(), {0, 0, 2, 10}) == tile1);
+    require_statistics(cache, 1, 2, 0);
+
+    // Tile 2 is the least recently used.
+    auto tile3 = cache.get(file.path(), {4, 0, 2, 10});
+    require_statistics(cache, 1, 3, 1);
+    REQUIRE(cache.statistics().tile_count == 2);
+    REQUIRE(cache.statistics().memory_usage == 2 * tile_size);
+
+    REQUIRE(cache.get(file.path(), {0, 0, 2, 10}) == tile1);
+    require_statistics(cache, 2, 3, 1);
+    REQUIRE(cache.get(file.path(), {2, 0, 2, 10}) != tile2);
+    require_statistics(cache, 2, 4, 2);
+
+    cache.set_memory_budget(tile_size);
+    require_statistics(cache, 2, 4, 3);
+    REQUIRE(cache.statistics().tile_count == 1);
+}
+
+TEST_CASE("DemTileCache reads a tile once for concurrent requests")
+{
+    TemporaryFile file(make_test_dem());
+    Dem::DemTileCache cache(SIZE_MAX);
+
+    constexpr size_t THREADS = 8;
+    std::vector<std::shared_ptr<const GridLib::Grid>> tiles(THREADS);
+    std::atomic<size_t> waiting = THREADS;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+        threads.emplace_back([&, i]
+        {
+            --waiting;
+            while (waiting != 0)
+                std::this_thread::yield();
+            tiles[i] = cache.get(file.path(), {1, 0, 5, SIZE_MAX});
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    for (const auto& tile : tiles)
+        REQUIRE(tile == tiles[0]);
+    require_statistics(cache, THREADS - 1, 1, 0);
+}
@@ -0,0 +1,152 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "DemReader/ElevationStatistics.hpp"
+
+namespace
+{
+    constexpr int32_t UNKNOWN = -32767;
+
+    /// More values than the SIMD code adds up before it flushes its
+    /// lanes, and not a multiple of any vector size.
+    constexpr size_t LARGE_COUNT = 16384 * 16 * 2 + 13;
+
+    template <typename T>
+    void test_statistics(const std::vector<T>& values)
+    {
+        uint64_t count = 0;
+        uint64_t voids = 0;
+        int32_t min = INT32_MAX;
+        int32_t max = INT32_MIN;
+        int64_t sum = 0;
+        std::vector<uint64_t> histogram(65536 / 256);
+        for (auto value : values)
+        {
+            auto v = int32_t(value);
+            if (v == UNKNOWN)
+            {
+                ++voids;
+                continue;
+            }
+            ++count;
+            min = std::min(min, v);
+            max = std::max(max, v);
+            sum += v;
+            ++histogram[size_t(v + 32768) / 256];
+        }
+
+        Dem::ElevationStatistics statistics(256);
+        statistics.add(values.data(), values.size());
+        REQUIRE(statistics.count() == count);
+        REQUIRE(statistics.void_count() == voids);
+        REQUIRE(statistics.sum() == sum);
+        REQUIRE(statistics.histogram() == histogram);
+        if (count == 0)
+        {
+            REQUIRE_FALSE(statistics.min());
+            REQUIRE_FALSE(statistics.max());
+        }
+        else
+        {
+            REQUIRE(statistics.min() == min);
+            REQUIRE(statistics.max() == max);
+        }
+    }
+
+    template <typename T>
+    void test_both_types(const std::vector<T>& values)
+    {
+        test_statistics(values);
+        test_statistics(std::vector<int32_t>(values.begin(), values.end()));
+    }
+
+    std::vector<int16_t> make_random_values(size_t count, int void_percentage)
+    {
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int> percent(0, 99);
+        std::uniform_int_distribution<int> elevation(-32768, 32767);
+        std::vector<int16_t> result(count);
+        for (auto& value : result)
+        {
+            if (percent(random) < void_percentage)
+                value = int16_t(UNKNOWN);
+            else
+                value = int16_t(elevation(random));
+        }
+        return result;
+    }
+}
+
+TEST_CASE("ElevationStatistics with random values")
+{
+    for (size_t count : {size_t(0), size_t(1), size_t(7), size_t(8),
+                         size_t(9), size_t(15), size_t(16), size_t(17),
+                         size_t(33), size_t(1000), LARGE_COUNT})
+    {
+        CAPTURE(count);
+        test_both_types(make_random_values(count, 0));
+        test_both_types(make_random_values(count, 10));
+        test_both_types(make_random_values(count, 99));
+    }
+}
+
+TEST_CASE("ElevationStatistics with only voids")
+{
+    for (size_t count : {size_t(1), size_t(16), size_t(37), LARGE_COUNT})
+    {
+        CAPTURE(count);
+        test_both_types(std::vector<int16_t>(count, int16_t(UNKNOWN)));
+    }
+}
+
+TEST_CASE("ElevationStatistics with the extreme values")
+{
+    SECTION("Only 32767")
+    {
+        test_both_types(std::vector<int16_t>(LARGE_COUNT, 32767));
+    }
+
+    SECTION("Only -32768")
+    {
+        test_both_types(std::vector<int16_t>(LARGE_COUNT, -32768));
+    }
+
+    SECTION("Extremes and voids")
+    {
+        std::vector<int16_t> values(LARGE_COUNT);
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            switch (i % 5)
+            {
+            case 0:
+            case 3:
+                values[i] = 32767;
+                break;
+            case 1:
+                values[i] = -32768;
+                break;
+            default:
+                values[i] = int16_t(UNKNOWN);
+                break;
+            }
+        }
+        test_both_types(values);
+    }
+
+    SECTION("A single known value among voids")
+    {
+        std::vector<int16_t> values(LARGE_COUNT, int16_t(UNKNOWN));
+        values[LARGE_COUNT / 2] = 32767;
+        test_both_types(values);
+        values[LARGE_COUNT / 2] = -32768;
+        test_both_types(values);
+    }
+}
@@ -0,0 +1,66 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <vector>
+#include <catch2/catch.hpp>
+#include "DemReader/NorthUp.hpp"
+
+namespace
+{
+    template <typename T>
+    void test_north_up(const Chorasmia::ArrayView2D<T>& values)
+    {
+        auto rows = values.rowCount();
+        auto cols = values.columnCount();
+        CAPTURE(rows, cols);
+        auto result = Dem::to_north_up(values);
+        REQUIRE(result.rowCount() == cols);
+        REQUIRE(result.columnCount() == rows);
+        // The last value in each profile is the northernmost, it ends
+        // up in the first row.
+        for (size_t i = 0; i < rows; ++i)
+        {
+            for (size_t j = 0; j < cols; ++j)
+            {
+                CAPTURE(i, j);
+                REQUIRE(result(cols - 1 - j, i) == values(i, j));
+            }
+        }
+    }
+
+    template <typename T>
+    void test_sizes()
+    {
+        // The values are copied in blocks of 64 x 64.
+        for (size_t rows : {1, 2, 63, 64, 65, 130})
+        {
+            for (size_t cols : {1, 3, 64, 100, 129})
+            {
+                std::vector<T> values(rows * cols);
+                for (size_t i = 0; i < values.size(); ++i)
+                    values[i] = T(i % 30000);
+                test_north_up(Chorasmia::ArrayView2D<T>(values.data(),
+                                                        rows, cols));
+            }
+        }
+    }
+}
+
+TEST_CASE("to_north_up with sizes that aren't multiples of the block size")
+{
+    test_sizes<double>();
+    test_sizes<int16_t>();
+}
+
+TEST_CASE("to_north_up with a subarray")
+{
+    std::vector<double> values(100 * 150);
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = double(i);
+    Chorasmia::ArrayView2D<double> view(values.data(), 100, 150);
+    test_north_up(view.subarray(3, 7, 70, 130));
+}
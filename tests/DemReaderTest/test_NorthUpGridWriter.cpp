@@ -0,0 +1,175 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "DemReader/DemReader.hpp"
+#include "DemReader/NorthUp.hpp"
+#include "DemReader/NorthUpGridWriter.hpp"
+#include "DemReader/ReadDemGrid.hpp"
+#include "SyntheticDem.hpp"
+
+namespace
+{
+    std::string write_grid(const std::string& dem,
+                           Dem::GridFileFormat format,
+                           const Dem::NorthUpGridWriterOptions& options)
+    {
+        Dem::DemReader reader(dem.data(), dem.size());
+        std::ostringstream stream;
+        REQUIRE(Dem::write_north_up_grid(reader, stream, format,
+                                         GridLib::Unit::METERS, options));
+        return stream.str();
+    }
+
+    /**
+     * @brief Returns the grid in @a dem with rows from north to south.
+     */
+    Chorasmia::Array2D<double> read_north_up_grid(const std::string& dem)
+    {
+        Dem::DemReader reader(dem.data(), dem.size());
+        auto grid = Dem::read_dem_grid(reader, GridLib::Unit::METERS);
+        return Dem::to_north_up(grid.elevations());
+    }
+
+    template <typename T>
+    T read_binary_value(const std::string& data, size_t offset)
+    {
+        REQUIRE(offset + sizeof(T) <= data.size());
+        T value;
+        memcpy(&value, data.data() + offset, sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief Returns the numbers in the "elevations" member of @a json.
+     */
+    std::vector<double> read_json_elevations(const std::string& json)
+    {
+        auto start = json.find("\"elevations\":");
+        REQUIRE(start != std::string::npos);
+        auto values = json.substr(start + 13);
+        for (auto& c : values)
+        {
+            if (c == '[' || c == ']' || c == ',' || c == '}')
+                c = ' ';
+        }
+        std::istringstream stream(values);
+        std::vector<double> result;
+        double value;
+        while (stream >> value)
+            result.push_back(value);
+        REQUIRE(stream.eof());
+        return result;
+    }
+
+    void require_binary_grid(const std::string& output,
+                             const Chorasmia::Array2D<double>& expected)
+    {
+        constexpr size_t HEADER_SIZE = 32;
+        REQUIRE(output.size() >= HEADER_SIZE);
+        REQUIRE(output.compare(0, sizeof(Dem::BINARY_GRID_MAGIC),
+                               Dem::BINARY_GRID_MAGIC,
+                               sizeof(Dem::BINARY_GRID_MAGIC)) == 0);
+        REQUIRE(read_binary_value<uint64_t>(output, 8)
+                == expected.rowCount());
+        REQUIRE(read_binary_value<uint64_t>(output, 16)
+                == expected.columnCount());
+        REQUIRE(read_binary_value<double>(output, 24) == -32767.0);
+        REQUIRE(output.size() == HEADER_SIZE + expected.rowCount()
+                                               * expected.columnCount()
+                                               * sizeof(double));
+        for (size_t i = 0; i < expected.rowCount(); ++i)
+        {
+            for (size_t j = 0; j < expected.columnCount(); ++j)
+            {
+                CAPTURE(i, j);
+                auto offset = HEADER_SIZE
+                              + (i * expected.columnCount() + j)
+                                * sizeof(double);
+                REQUIRE(read_binary_value<double>(output, offset)
+                        == expected(i, j));
+            }
+        }
+    }
+
+    void require_json_grid(const std::string& output,
+                           const Chorasmia::Array2D<double>& expected)
+    {
+        auto header = output.substr(0, output.find("\"elevations\""));
+        CAPTURE(header);
+        auto require_member = [&](const std::string& member)
+        {
+            REQUIRE(header.find(member) != std::string::npos);
+        };
+        require_member("\"row_count\": "
+                       + std::to_string(expected.rowCount()));
+        require_member("\"column_count\": "
+                       + std::to_string(expected.columnCount()));
+        // The values in each row are one profile apart.
+        require_member("\"row_axis\": {\"resolution\": 30,"
+                       " \"unit\": \"METERS\"}");
+        require_member("\"column_axis\": {\"resolution\": 10,"
+                       " \"unit\": \"METERS\"}");
+        require_member("\"planar_coords\": {\"easting\": 500000,"
+                       " \"northing\": 5000000, \"zone\": 10}");
+        require_member("\"unknown_elevation\": -32767");
+
+        auto values = read_json_elevations(output);
+        REQUIRE(values.size() == expected.rowCount()
+                                 * expected.columnCount());
+        for (size_t i = 0; i < expected.rowCount(); ++i)
+        {
+            for (size_t j = 0; j < expected.columnCount(); ++j)
+            {
+                CAPTURE(i, j);
+                REQUIRE(values[i * expected.columnCount() + j]
+                        == expected(i, j));
+            }
+        }
+    }
+
+    void test_memory_budget(const std::string& dem, size_t memory_budget)
+    {
+        CAPTURE(memory_budget);
+        TemporaryDirectory directory;
+        Dem::NorthUpGridWriterOptions options;
+        options.scratch_directory = directory.path().string();
+        options.memory_budget = memory_budget;
+        auto expected = read_north_up_grid(dem);
+
+        require_binary_grid(write_grid(dem, Dem::GridFileFormat::BINARY,
+                                       options),
+                            expected);
+        require_json_grid(write_grid(dem, Dem::GridFileFormat::JSON,
+                                     options),
+                          expected);
+        // The scratch file has been removed.
+        REQUIRE(std::filesystem::is_empty(directory.path()));
+    }
+}
+
+TEST_CASE("NorthUpGridWriter with profiles in a scratch file")
+{
+    SyntheticDemOptions options;
+    options.columns = 9;
+    options.rows = 300;
+    // Different resolutions reveal swapped axes.
+    options.x_resolution = 30;
+    options.y_resolution = 10;
+    auto dem = make_synthetic_dem(options);
+    auto profile_size = size_t(options.rows) * sizeof(int16_t);
+
+    test_memory_budget(dem, SIZE_MAX);
+    test_memory_budget(dem, 1);
+    test_memory_budget(dem, profile_size);
+    test_memory_budget(dem, 2 * profile_size);
+    test_memory_budget(dem, 2 * profile_size + 100);
+}
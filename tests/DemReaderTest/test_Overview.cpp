@@ -0,0 +1,172 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "DemReader/Overview.hpp"
+
+namespace
+{
+    constexpr int16_t UNKNOWN = -32767;
+
+    /**
+     * @brief Reduces the block of up to 2x2 values at @a row, @a column
+     *  in the straightforward way.
+     */
+    int16_t reduce_block(const std::vector<int16_t>& values,
+                         size_t rows, size_t cols,
+                         size_t row, size_t column,
+                         Dem::OverviewReducer reducer)
+    {
+        if (reducer == Dem::OverviewReducer::NEAREST)
+            return values[row * cols + column];
+
+        std::vector<int32_t> known;
+        for (size_t i = row; i < std::min(row + 2, rows); ++i)
+        {
+            for (size_t j = column; j < std::min(column + 2, cols); ++j)
+            {
+                if (values[i * cols + j] != UNKNOWN)
+                    known.push_back(values[i * cols + j]);
+            }
+        }
+        if (known.empty())
+            return UNKNOWN;
+
+        switch (reducer)
+        {
+        case Dem::OverviewReducer::MEAN:
+        {
+            int32_t sum = 0;
+            for (auto v : known)
+                sum += v;
+            // nearbyint rounds ties to even with the default rounding
+            // mode.
+            return int16_t(std::nearbyint(double(sum) / known.size()));
+        }
+        case Dem::OverviewReducer::MIN:
+            return int16_t(*std::min_element(known.begin(), known.end()));
+        case Dem::OverviewReducer::MAX:
+            return int16_t(*std::max_element(known.begin(), known.end()));
+        default:
+            return 0;
+        }
+    }
+
+    void test_overview(const std::vector<int16_t>& values,
+                       size_t rows, size_t cols,
+                       Dem::OverviewReducer reducer)
+    {
+        CAPTURE(rows, cols, int(reducer));
+        auto overview = Dem::make_overview({values.data(), rows, cols},
+                                           reducer);
+        REQUIRE(overview.rowCount() == (rows + 1) / 2);
+        REQUIRE(overview.columnCount() == (cols + 1) / 2);
+        for (size_t i = 0; i < overview.rowCount(); ++i)
+        {
+            for (size_t j = 0; j < overview.columnCount(); ++j)
+            {
+                CAPTURE(i, j);
+                REQUIRE(overview(i, j) == reduce_block(values, rows, cols,
+                                                       2 * i, 2 * j,
+                                                       reducer));
+            }
+        }
+    }
+
+    void test_all_reducers(const std::vector<int16_t>& values,
+                           size_t rows, size_t cols)
+    {
+        for (auto reducer : {Dem::OverviewReducer::MEAN,
+                             Dem::OverviewReducer::MIN,
+                             Dem::OverviewReducer::MAX,
+                             Dem::OverviewReducer::NEAREST})
+        {
+            test_overview(values, rows, cols, reducer);
+        }
+    }
+
+    /**
+     * @brief Returns random elevations where @a special_percentage of
+     *  the values are unknown, INT16_MIN or INT16_MAX.
+     */
+    std::vector<int16_t> make_values(std::mt19937& random, size_t count,
+                                     int special_percentage)
+    {
+        std::uniform_int_distribution<int> percent(0, 99);
+        std::uniform_int_distribution<int> special(0, 2);
+        std::uniform_int_distribution<int> elevation(-1000, 9000);
+        std::vector<int16_t> result(count);
+        for (auto& value : result)
+        {
+            if (percent(random) >= special_percentage)
+                value = int16_t(elevation(random));
+            else if (auto s = special(random); s == 0)
+                value = UNKNOWN;
+            else
+                value = s == 1 ? INT16_MIN : INT16_MAX;
+        }
+        return result;
+    }
+}
+
+TEST_CASE("make_overview matches a straightforward reduction")
+{
+    std::mt19937 random(1);
+    // The SIMD code handles 16 values at a time.
+    for (size_t cols : {1, 2, 3, 14, 15, 16, 17, 18, 31, 32, 33, 47, 50})
+    {
+        for (size_t rows : {1, 2, 3, 6, 7})
+        {
+            for (int special_percentage : {0, 30, 90})
+            {
+                auto values = make_values(random, rows * cols,
+                                          special_percentage);
+                test_all_reducers(values, rows, cols);
+            }
+        }
+    }
+}
+
+TEST_CASE("make_overview with only unknown values")
+{
+    for (size_t cols : {3, 16, 33})
+    {
+        std::vector<int16_t> values(5 * cols, UNKNOWN);
+        test_all_reducers(values, 5, cols);
+    }
+}
+
+TEST_CASE("make_overview with unknown values and the int16_t limits")
+{
+    // Each block of 2x2 values mixes unknown values with INT16_MIN and
+    // INT16_MAX in a different way.
+    std::vector<int16_t> patterns = {
+        UNKNOWN, UNKNOWN, UNKNOWN, INT16_MIN,
+        UNKNOWN, UNKNOWN, UNKNOWN, INT16_MAX,
+        UNKNOWN, INT16_MIN, INT16_MAX, UNKNOWN,
+        INT16_MIN, INT16_MIN, INT16_MIN, UNKNOWN,
+        INT16_MAX, INT16_MAX, UNKNOWN, INT16_MAX,
+        INT16_MIN, INT16_MAX, INT16_MIN, INT16_MAX,
+        INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN,
+        INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX,
+    };
+    constexpr size_t COLS = 40;
+    std::vector<int16_t> values(2 * COLS);
+    for (size_t j = 0; j < COLS / 2; ++j)
+    {
+        auto p = &patterns[(j % 8) * 4];
+        values[2 * j] = p[0];
+        values[2 * j + 1] = p[1];
+        values[COLS + 2 * j] = p[2];
+        values[COLS + 2 * j + 1] = p[3];
+    }
+    test_all_reducers(values, 2, COLS);
+}
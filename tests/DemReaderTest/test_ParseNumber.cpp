@@ -0,0 +1,135 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <catch2/catch.hpp>
+#include "ParseNumber.hpp"
+
+namespace
+{
+    /**
+     * @brief Returns the result of strtod for @a str, where D is
+     *  accepted as exponent character.
+     */
+    double reference_value(std::string str)
+    {
+        for (auto& c : str)
+        {
+            if (c == 'D' || c == 'd')
+                c = 'E';
+        }
+        return std::strtod(str.c_str(), nullptr);
+    }
+
+    void test_double(const std::string& str)
+    {
+        CAPTURE(str);
+        double value = 0;
+        REQUIRE(Dem::parse(str, value));
+        auto expected = reference_value(str);
+        REQUIRE(value == expected);
+        REQUIRE(std::signbit(value) == std::signbit(expected));
+    }
+
+    void test_invalid_double(const std::string& str)
+    {
+        CAPTURE(str);
+        double value = 0;
+        REQUIRE_FALSE(Dem::parse(str, value));
+    }
+
+    /**
+     * @brief Formats @a value as Fortran's D24.15 does, i.e. as
+     *  0.ddddddddddddddd with an exponent, without the leading spaces.
+     */
+    std::string format_d24_15(double value)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.14E", std::abs(value));
+        std::string text = buffer;
+        auto e = text.find('E');
+        auto exponent = std::stoi(text.substr(e + 1)) + 1;
+        std::string result = value < 0 ? "-0." : "0.";
+        result += text.substr(0, 1) + text.substr(2, e - 2);
+        snprintf(buffer, sizeof(buffer), "D%+03d", exponent);
+        return result + buffer;
+    }
+}
+
+TEST_CASE("Parse D24.15 values")
+{
+    test_double("0.123456789012345D+04");
+    test_double("-0.500000000000000D+00");
+    test_double("0.100000000000000D+01");
+    test_double("0.299999999999999D-05");
+
+    std::mt19937_64 random(4321);
+    std::uniform_real_distribution<double> mantissa(-1.0, 1.0);
+    std::uniform_int_distribution<int> exponent(-30, 30);
+    for (int i = 0; i < 10000; ++i)
+    {
+        auto value = mantissa(random) * std::pow(10.0, exponent(random));
+        test_double(format_d24_15(value));
+    }
+}
+
+TEST_CASE("Parse doubles with more than 19 significant digits")
+{
+    test_double("12345678901234567890");
+    test_double("123456789012345678901234567890");
+    test_double("1.2345678901234567890123456789");
+    test_double("9007199254740993");
+    test_double("9007199254740993.000000000000000000001");
+    test_double("0.30000000000000000000000000000001");
+    test_double("179769313486231570000000000000000000000D+270");
+}
+
+TEST_CASE("Parse doubles with leading zeros in the fraction")
+{
+    test_double("0.000001");
+    test_double("0.0000000000000000000001234567890123456789");
+    test_double("0.000000000000000000000000000000000000000001D+42");
+    test_double("000.00012345");
+}
+
+TEST_CASE("Parse doubles at the exponent limits")
+{
+    test_double("1D308");
+    test_double("1.7976931348623157D+308");
+    test_double("1D-307");
+    test_double("2.2250738585072014E-308");
+    test_double("0.1D+23");
+    test_double("1E22");
+    test_double("1E23");
+    test_invalid_double("1D309");
+    test_invalid_double("1D+1000");
+}
+
+TEST_CASE("Parse negative zero")
+{
+    test_double("-0.0");
+    test_double("-0.000000000000000D+00");
+    test_double("0.0");
+}
+
+TEST_CASE("Reject malformed doubles")
+{
+    test_invalid_double("");
+    test_invalid_double("-");
+    test_invalid_double("1D");
+    test_invalid_double("1D+");
+    test_invalid_double("1_");
+    test_invalid_double("1.5x");
+    test_invalid_double("1.5D+0x");
+    test_invalid_double("1__0");
+    test_invalid_double("D5");
+    test_invalid_double(" 1.5");
+}
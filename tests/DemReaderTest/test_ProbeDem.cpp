@@ -0,0 +1,133 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <catch2/catch.hpp>
+#include "DemReader/ProbeDem.hpp"
+#include "DemReader/RecordB.hpp"
+#include "SyntheticDem.hpp"
+
+namespace
+{
+    constexpr int COLUMNS = 6;
+    constexpr int ROWS = 300;
+
+    SyntheticDemOptions make_options()
+    {
+        SyntheticDemOptions options;
+        options.columns = COLUMNS;
+        options.rows = ROWS;
+        return options;
+    }
+
+    void require_record_a(const Dem::DemProbe& probe)
+    {
+        REQUIRE(probe.record_a.columns == COLUMNS);
+        REQUIRE(probe.record_a.ref_sys_zone == 10);
+        REQUIRE(probe.profile_count == size_t(COLUMNS));
+    }
+}
+
+TEST_CASE("probe_dem with record C")
+{
+    auto dem = make_synthetic_dem(make_options());
+    TemporaryFile file(dem);
+
+    auto probe = Dem::probe_dem(file.path());
+    require_record_a(probe);
+    REQUIRE(probe.file_size == dem.size());
+    REQUIRE(probe.profile_length == size_t(ROWS));
+
+    // The values written by make_synthetic_dem.
+    REQUIRE(probe.record_c);
+    REQUIRE(probe.record_c->has_datum_rmse == 1);
+    REQUIRE(probe.record_c->datum_rmse[2] == 3);
+    REQUIRE(probe.record_c->datum_rmse_sample_size == 100);
+    REQUIRE(probe.record_c->has_dem_rmse == 1);
+    REQUIRE(probe.record_c->dem_rmse[0] == 4);
+    REQUIRE(probe.record_c->dem_rmse_sample_size == 200);
+}
+
+TEST_CASE("probe_dem without record C")
+{
+    auto options = make_options();
+    options.record_c = false;
+    auto dem = make_synthetic_dem(options);
+    TemporaryFile file(dem);
+
+    auto probe = Dem::probe_dem(file.path());
+    require_record_a(probe);
+    REQUIRE(probe.file_size == dem.size());
+    REQUIRE(probe.profile_length == size_t(ROWS));
+    REQUIRE_FALSE(probe.record_c);
+}
+
+TEST_CASE("probe_dem with a compressed file")
+{
+    auto compressed = gzip(make_synthetic_dem(make_options()));
+    TemporaryFile file(compressed);
+
+    auto probe = Dem::probe_dem(file.path());
+    require_record_a(probe);
+    REQUIRE(probe.file_size == compressed.size());
+    REQUIRE(probe.profile_length == size_t(ROWS));
+    // Record C is at the end of the decompressed data.
+    REQUIRE_FALSE(probe.record_c);
+}
+
+TEST_CASE("probe_dem with a size that doesn't match the first profile")
+{
+    auto options = make_options();
+
+    SECTION("Profiles of different lengths")
+    {
+        // Every other profile has one elevation less, which is one
+        // block less when the first profile ends at the start of its
+        // second block.
+        options.rows = int((Dem::DEM_BLOCK_SIZE
+                            - Dem::RECORD_B_HEADER_SIZE) / 6) + 1;
+        options.stagger = 1;
+        TemporaryFile file(make_synthetic_dem(options));
+        auto probe = Dem::probe_dem(file.path());
+        require_record_a(probe);
+        REQUIRE(probe.record_c);
+        REQUIRE(probe.profile_length == 0);
+    }
+
+    SECTION("An extra block at the end")
+    {
+        options.record_c = false;
+        auto dem = make_synthetic_dem(options);
+        dem.append(Dem::DEM_BLOCK_SIZE, ' ');
+        TemporaryFile file(dem);
+        auto probe = Dem::probe_dem(file.path());
+        require_record_a(probe);
+        REQUIRE(probe.profile_length == 0);
+    }
+}
+
+TEST_CASE("probe_dems returns the results in the order of the files")
+{
+    TemporaryFile dem(make_synthetic_dem(make_options()));
+    TemporaryFile compressed(gzip(make_synthetic_dem(make_options())));
+    TemporaryFile empty;
+    std::vector<std::string> paths = {dem.path(), empty.path(),
+                                      compressed.path(), dem.path()};
+
+    auto results = Dem::probe_dems(paths, 3);
+    REQUIRE(results.size() == paths.size());
+    for (size_t i : {0, 2, 3})
+    {
+        CAPTURE(i);
+        REQUIRE(results[i].probe);
+        REQUIRE(results[i].error.empty());
+        require_record_a(*results[i].probe);
+    }
+    REQUIRE(results[0].probe->record_c);
+    REQUIRE_FALSE(results[2].probe->record_c);
+    REQUIRE_FALSE(results[1].probe);
+    REQUIRE(results[1].error.find(empty.path()) != std::string::npos);
+}
@@ -0,0 +1,143 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <catch2/catch.hpp>
+#include "ReadAheadStreamBuf.hpp"
+
+namespace
+{
+    constexpr size_t BUFFER_SIZE = 7;
+    constexpr size_t DEPTH = 2;
+
+    std::string make_data(size_t size)
+    {
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int> distribution(0, 255);
+        std::string result(size, '\0');
+        for (auto& c : result)
+            c = char(distribution(random));
+        return result;
+    }
+
+    std::string read(std::istream& stream, size_t size)
+    {
+        std::string result(size, '\0');
+        stream.read(result.data(), std::streamsize(size));
+        result.resize(size_t(stream.gcount()));
+        return result;
+    }
+
+    /**
+     * @brief A stream buffer that throws when it's asked for more than
+     *  the first @a size bytes of @a data.
+     */
+    class FailingStreamBuf : public std::streambuf
+    {
+    public:
+        FailingStreamBuf(std::string& data, size_t size)
+        {
+            setg(data.data(), data.data(), data.data() + size);
+        }
+    protected:
+        int_type underflow() override
+        {
+            throw std::runtime_error("Read error.");
+        }
+    };
+}
+
+TEST_CASE("ReadAheadStreamBuf returns the same bytes as the source")
+{
+    auto data = make_data(1000);
+    std::istringstream source(data);
+    Dem::ReadAheadStreamBuf buffer(source, BUFFER_SIZE, DEPTH);
+    std::istream stream(&buffer);
+    REQUIRE(read(stream, 2000) == data);
+    REQUIRE(stream.eof());
+}
+
+TEST_CASE("ReadAheadStreamBuf reports the position at buffer boundaries")
+{
+    auto data = make_data(100);
+    std::istringstream source(data);
+    Dem::ReadAheadStreamBuf buffer(source, BUFFER_SIZE, DEPTH);
+    std::istream stream(&buffer);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        CAPTURE(i);
+        REQUIRE(stream.tellg() == std::streamoff(i));
+        REQUIRE(stream.get() == int(uint8_t(data[i])));
+    }
+    REQUIRE(stream.tellg() == std::streamoff(data.size()));
+    REQUIRE(stream.get() == std::char_traits<char>::eof());
+}
+
+TEST_CASE("Seeking in ReadAheadStreamBuf")
+{
+    auto data = make_data(1000);
+    std::istringstream source(data);
+    Dem::ReadAheadStreamBuf buffer(source, BUFFER_SIZE, DEPTH);
+    std::istream stream(&buffer);
+    REQUIRE(read(stream, 3) == data.substr(0, 3));
+
+    SECTION("Inside the current buffer")
+    {
+        REQUIRE(stream.seekg(1));
+        REQUIRE(stream.tellg() == 1);
+        REQUIRE(read(stream, 20) == data.substr(1, 20));
+        REQUIRE(stream.seekg(-5, std::ios_base::cur));
+        REQUIRE(stream.tellg() == 16);
+        REQUIRE(read(stream, 5) == data.substr(16, 5));
+    }
+
+    SECTION("Outside the current buffer")
+    {
+        REQUIRE(stream.seekg(500));
+        REQUIRE(stream.tellg() == 500);
+        REQUIRE(read(stream, 30) == data.substr(500, 30));
+        REQUIRE(stream.seekg(100, std::ios_base::cur));
+        REQUIRE(stream.tellg() == 630);
+        REQUIRE(read(stream, 30) == data.substr(630, 30));
+        REQUIRE(stream.seekg(-10, std::ios_base::end));
+        REQUIRE(stream.tellg() == 990);
+        REQUIRE(read(stream, 30) == data.substr(990));
+    }
+
+    SECTION("Back to the start")
+    {
+        REQUIRE(read(stream, 300) == data.substr(3, 300));
+        REQUIRE(stream.seekg(0));
+        REQUIRE(stream.tellg() == 0);
+        REQUIRE(read(stream, 2000) == data);
+    }
+
+    SECTION("Past the end")
+    {
+        REQUIRE_FALSE(stream.seekg(2000));
+        stream.clear();
+        REQUIRE(stream.tellg() == 3);
+        REQUIRE(read(stream, 20) == data.substr(3, 20));
+    }
+}
+
+TEST_CASE("ReadAheadStreamBuf passes on errors from the source")
+{
+    auto data = make_data(100);
+    FailingStreamBuf failing(data, 50);
+    std::istream source(&failing);
+    source.exceptions(std::ios::badbit);
+    Dem::ReadAheadStreamBuf buffer(source, BUFFER_SIZE, DEPTH);
+    std::istream stream(&buffer);
+    stream.exceptions(std::ios::badbit);
+
+    REQUIRE(read(stream, 49) == data.substr(0, 49));
+    REQUIRE_THROWS_WITH(read(stream, 10), "Read error.");
+}
@@ -0,0 +1,311 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <catch2/catch.hpp>
+#include "DemReader/DemException.hpp"
+#include "DemReader/DemReader.hpp"
+#include "DemReader/ReadDemGrid.hpp"
+#include "SyntheticDem.hpp"
+
+namespace
+{
+    void test_compact_window(const std::string& dem,
+                             const Dem::DemWindow& window)
+    {
+        CAPTURE(window.row, window.column, window.row_count,
+                window.column_count);
+        Dem::DemReader full_reader(dem.data(), dem.size());
+        auto full = Dem::read_compact_dem_grid(full_reader,
+                                               GridLib::Unit::METERS);
+        Dem::DemReader reader(dem.data(), dem.size());
+        auto grid = Dem::read_compact_dem_grid(reader, GridLib::Unit::METERS,
+                                               window);
+
+        auto row0 = std::min(window.row, full.row_count());
+        auto col0 = std::min(window.column, full.column_count());
+        REQUIRE(grid.row_count()
+                == std::min(window.row_count, full.row_count() - row0));
+        REQUIRE(grid.column_count()
+                == std::min(window.column_count,
+                            full.column_count() - col0));
+        REQUIRE(grid.factor() == full.factor());
+        for (size_t i = 0; i < grid.row_count(); ++i)
+        {
+            for (size_t j = 0; j < grid.column_count(); ++j)
+                REQUIRE(grid.values()(i, j) == full.values()(row0 + i,
+                                                             col0 + j));
+        }
+    }
+
+    void require_window(const GridLib::Grid& grid,
+                        const GridLib::Grid& full,
+                        const Dem::DemWindow& window)
+    {
+        auto row0 = std::min(window.row, full.rowCount());
+        auto col0 = std::min(window.column, full.columnCount());
+        auto expected = full.elevations().subarray(row0, col0,
+                                                   window.row_count,
+                                                   window.column_count);
+        REQUIRE(grid.rowCount() == expected.rowCount());
+        REQUIRE(grid.columnCount() == expected.columnCount());
+        for (size_t i = 0; i < grid.rowCount(); ++i)
+        {
+            for (size_t j = 0; j < grid.columnCount(); ++j)
+                REQUIRE(grid.elevations()(i, j) == expected(i, j));
+        }
+
+        // Grid rows are profiles, which are x_resolution apart, the
+        // elevations in each profile are y_resolution apart.
+        REQUIRE(grid.planarCoords());
+        REQUIRE(grid.planarCoords()->easting
+                == full.planarCoords()->easting + double(row0) * 30);
+        REQUIRE(grid.planarCoords()->northing
+                == full.planarCoords()->northing + double(col0) * 10);
+        REQUIRE(grid.planarCoords()->zone == full.planarCoords()->zone);
+    }
+
+    void test_window(const std::string& dem, const std::string& path,
+                     const Dem::DemWindow& window)
+    {
+        CAPTURE(window.row, window.column, window.row_count,
+                window.column_count);
+        auto full = Dem::read_dem_grid(path, GridLib::Unit::METERS);
+
+        require_window(Dem::read_dem_grid(path, GridLib::Unit::METERS,
+                                          window),
+                       full, window);
+
+        Dem::DemReader reader(dem.data(), dem.size());
+        require_window(Dem::read_dem_grid(reader, GridLib::Unit::METERS,
+                                          window),
+                       full, window);
+    }
+
+    void require_same_grid(const GridLib::Grid& grid,
+                           const GridLib::Grid& expected)
+    {
+        REQUIRE(grid.rowCount() == expected.rowCount());
+        REQUIRE(grid.columnCount() == expected.columnCount());
+        for (size_t i = 0; i < grid.rowCount(); ++i)
+        {
+            for (size_t j = 0; j < grid.columnCount(); ++j)
+                REQUIRE(grid.elevations()(i, j)
+                        == expected.elevations()(i, j));
+        }
+    }
+
+    void test_parallel_read(const SyntheticDemOptions& options)
+    {
+        TemporaryFile file(make_synthetic_dem(options));
+
+        auto compact = Dem::read_compact_dem_grid(file.path(),
+                                                  GridLib::Unit::METERS, 1);
+        auto parallel_compact = Dem::read_compact_dem_grid(
+            file.path(), GridLib::Unit::METERS, 4);
+        REQUIRE(compact.row_count() == size_t(options.columns));
+        REQUIRE(compact.column_count() == size_t(options.rows));
+        REQUIRE(parallel_compact.row_count() == compact.row_count());
+        REQUIRE(parallel_compact.column_count() == compact.column_count());
+        REQUIRE(parallel_compact.factor() == compact.factor());
+        for (size_t i = 0; i < compact.row_count(); ++i)
+        {
+            for (size_t j = 0; j < compact.column_count(); ++j)
+                REQUIRE(parallel_compact.values()(i, j)
+                        == compact.values()(i, j));
+        }
+
+        auto grid = Dem::read_dem_grid(file.path(),
+                                       GridLib::Unit::METERS, 1);
+        auto parallel_grid = Dem::read_dem_grid(file.path(),
+                                                GridLib::Unit::METERS, 4);
+        REQUIRE(grid.rowCount() == compact.row_count());
+        REQUIRE(grid.columnCount() == compact.column_count());
+        require_same_grid(parallel_grid, grid);
+    }
+
+    std::vector<std::unique_ptr<TemporaryFile>> make_dem_files(size_t count)
+    {
+        std::vector<std::unique_ptr<TemporaryFile>> result;
+        for (size_t i = 0; i < count; ++i)
+        {
+            SyntheticDemOptions options;
+            options.columns = 10 + int(i) * 7;
+            options.rows = 300 + int(i) * 50;
+            options.seed = uint32_t(i + 1);
+            result.push_back(std::make_unique<TemporaryFile>(
+                make_synthetic_dem(options)));
+        }
+        return result;
+    }
+
+    std::vector<std::string>
+    get_paths(const std::vector<std::unique_ptr<TemporaryFile>>& files)
+    {
+        std::vector<std::string> result;
+        for (const auto& file : files)
+            result.push_back(file->path());
+        return result;
+    }
+}
+
+TEST_CASE("read_dem_grids returns the grids in file order")
+{
+    auto files = make_dem_files(6);
+    auto paths = get_paths(files);
+
+    Dem::ReadDemGridsOptions options;
+    options.thread_count = 4;
+    SECTION("No memory budget")
+    {
+        options.memory_budget = 0;
+    }
+    SECTION("Memory budget smaller than one grid")
+    {
+        options.memory_budget = 1;
+    }
+
+    auto grids = Dem::read_dem_grids(paths, options);
+    REQUIRE(grids.size() == paths.size());
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        CAPTURE(i);
+        require_same_grid(grids[i],
+                          Dem::read_dem_grid(paths[i], GridLib::Unit::METERS));
+    }
+}
+
+TEST_CASE("read_dem_grids stops when a callback returns false")
+{
+    auto files = make_dem_files(6);
+    auto paths = get_paths(files);
+
+    Dem::ReadDemGridsOptions options;
+    options.thread_count = 4;
+    options.memory_budget = 1;
+
+    SECTION("Grid callback")
+    {
+        std::atomic<size_t> calls = 0;
+        auto result = Dem::read_dem_grids(
+            paths, options,
+            [&](size_t, GridLib::Grid&&) {return ++calls < 2;});
+        REQUIRE_FALSE(result);
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("Progress callback")
+    {
+        std::atomic<size_t> grids = 0;
+        auto result = Dem::read_dem_grids(
+            paths, options,
+            [&](size_t, GridLib::Grid&&) {++grids; return true;},
+            [&](size_t file_index, size_t, size_t) {return file_index < 2;});
+        REQUIRE_FALSE(result);
+        REQUIRE(grids < paths.size());
+    }
+}
+
+TEST_CASE("read_dem_grids throws the error from a missing file")
+{
+    auto files = make_dem_files(5);
+    auto paths = get_paths(files);
+    auto missing = files[2]->path() + ".missing";
+    paths.insert(paths.begin() + 3, missing);
+
+    Dem::ReadDemGridsOptions options;
+    options.thread_count = 4;
+
+    std::atomic<bool> returned = false;
+    std::atomic<bool> called_after_return = false;
+    auto callback = [&](size_t, GridLib::Grid&&)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        if (returned)
+            called_after_return = true;
+        return true;
+    };
+
+    try
+    {
+        Dem::read_dem_grids(paths, options, callback);
+        FAIL("read_dem_grids didn't throw");
+    }
+    catch (Dem::DemException& ex)
+    {
+        REQUIRE_THAT(ex.what(), Catch::Contains(missing));
+    }
+    returned = true;
+
+    // The worker threads have been joined, nothing calls the callback
+    // after read_dem_grids has returned.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE_FALSE(called_after_return);
+}
+
+TEST_CASE("Parallel reading gives the same grid as serial reading")
+{
+    SyntheticDemOptions options;
+    options.columns = 37;
+    options.rows = 450;
+
+    SECTION("With record C")
+    {
+        test_parallel_read(options);
+    }
+
+    SECTION("Without record C")
+    {
+        options.record_c = false;
+        test_parallel_read(options);
+    }
+
+    SECTION("Blank fields")
+    {
+        options.blank_fields = true;
+        options.void_percentage = 10;
+        test_parallel_read(options);
+    }
+}
+
+TEST_CASE("read_compact_dem_grid with a window")
+{
+    SyntheticDemOptions options;
+    options.columns = 20;
+    options.rows = 700;
+    auto dem = make_synthetic_dem(options);
+
+    test_compact_window(dem, {0, 0, 5, 10});
+    test_compact_window(dem, {3, 140, 7, 300});
+    test_compact_window(dem, {19, 699, 10, 10});
+    test_compact_window(dem, {15, 500, SIZE_MAX, SIZE_MAX});
+    test_compact_window(dem, {25, 800, 10, 10});
+    test_compact_window(dem, {});
+}
+
+TEST_CASE("read_dem_grid with a window")
+{
+    SyntheticDemOptions options;
+    options.columns = 20;
+    options.rows = 700;
+    options.x_resolution = 30;
+    options.y_resolution = 10;
+    auto dem = make_synthetic_dem(options);
+    TemporaryFile file(dem);
+
+    test_window(dem, file.path(), {0, 0, 5, 10});
+    test_window(dem, file.path(), {3, 140, 7, 300});
+    test_window(dem, file.path(), {19, 699, 10, 10});
+    test_window(dem, file.path(), {15, 500, SIZE_MAX, SIZE_MAX});
+    test_window(dem, file.path(), {25, 800, 10, 10});
+    test_window(dem, file.path(), {});
+}
@@ -0,0 +1,72 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-04-02.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "ScaleElevations.hpp"
+
+namespace
+{
+    constexpr int16_t UNKNOWN = -32767;
+
+    template <typename T>
+    std::vector<T> make_values(size_t count)
+    {
+        // Unknown values and the limits of int16_t between ordinary
+        // elevations.
+        const T special[] = {UNKNOWN, INT16_MIN, INT16_MAX, 0, -1};
+        std::vector<T> result(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (i % 3 == 0)
+                result[i] = special[(i / 3) % std::size(special)];
+            else
+                result[i] = T(int(i * 37 % 9000) - 500);
+        }
+        return result;
+    }
+
+    template <typename T>
+    void test_scale_elevations(size_t count, double factor)
+    {
+        CAPTURE(count, factor);
+        auto values = make_values<T>(count);
+        // A value after the end reveals writes beyond count.
+        std::vector<double> result(count + 1, 12345.0);
+        Dem::scale_elevations(values.data(), count, factor, result.data());
+        for (size_t i = 0; i < count; ++i)
+        {
+            CAPTURE(i);
+            REQUIRE(result[i] == values[i] * factor);
+        }
+        REQUIRE(result[count] == 12345.0);
+    }
+
+    template <typename T>
+    void test_counts()
+    {
+        // The SIMD code handles two, four or eight values at a time.
+        for (size_t count = 0; count <= 33; ++count)
+        {
+            for (double factor : {1.0, 0.3048, 1 / 3.0})
+                test_scale_elevations<T>(count, factor);
+        }
+        test_scale_elevations<T>(1001, 0.3048);
+    }
+}
+
+TEST_CASE("scale_elevations with int16_t")
+{
+    test_counts<int16_t>();
+}
+
+TEST_CASE("scale_elevations with int32_t")
+{
+    test_counts<int32_t>();
+}
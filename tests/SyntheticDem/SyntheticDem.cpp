@@ -0,0 +1,322 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-27.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#include "SyntheticDem.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace
+{
+    constexpr size_t BLOCK_SIZE = 1024;
+    constexpr int UNKNOWN = -32767;
+
+    /**
+     * @brief A linear congruential generator. Unlike the distributions
+     *  in <random>, it gives the same numbers with every compiler.
+     */
+    class Random
+    {
+    public:
+        explicit Random(uint32_t seed)
+            : m_State(seed)
+        {}
+
+        uint32_t next()
+        {
+            m_State = m_State * 6364136223846793005ULL
+                      + 1442695040888963407ULL;
+            return uint32_t(m_State >> 33u);
+        }
+
+        int next(int min, int max)
+        {
+            return min + int(next() % uint32_t(max - min + 1));
+        }
+    private:
+        uint64_t m_State;
+    };
+
+    class RecordWriter
+    {
+    public:
+        explicit RecordWriter(std::string& output)
+            : m_Output(output),
+              m_Start(output.size())
+        {}
+
+        void text(const std::string& str, size_t width)
+        {
+            auto s = str.substr(0, width);
+            s.resize(width, ' ');
+            m_Output += s;
+        }
+
+        void blank(size_t width)
+        {
+            m_Output.append(width, ' ');
+        }
+
+        void integer(std::optional<long> value, size_t width)
+        {
+            if (!value)
+                return blank(width);
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%*ld", int(width), *value);
+            m_Output += buffer;
+        }
+
+        void real(std::optional<double> value, size_t width = 24)
+        {
+            if (!value)
+                return blank(width);
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), "%*.15E", int(width), *value);
+            std::string s = buffer;
+            std::replace(s.begin(), s.end(), 'E', 'D');
+            m_Output += s;
+        }
+
+        void real32(std::optional<double> value)
+        {
+            if (!value)
+                return blank(12);
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%12.6E", *value);
+            m_Output += buffer;
+        }
+
+        [[nodiscard]]
+        size_t position() const
+        {
+            return (m_Output.size() - m_Start) % BLOCK_SIZE;
+        }
+
+        /**
+         * @brief Pads the current block with spaces.
+         */
+        void end_block()
+        {
+            if (auto pos = position(); pos != 0)
+                blank(BLOCK_SIZE - pos);
+        }
+    private:
+        std::string& m_Output;
+        size_t m_Start;
+    };
+
+    void write_record_a(std::string& output,
+                        const SyntheticDemOptions& options)
+    {
+        std::optional<long> zero;
+        std::optional<double> zero_d;
+        if (!options.blank_fields)
+        {
+            zero = 0;
+            zero_d = 0.0;
+        }
+
+        auto margin = options.corner_margin;
+        auto west = options.easting - margin;
+        auto south = options.northing - margin;
+        auto east = options.easting
+                    + (options.columns - 1) * options.x_resolution + margin;
+        auto north = options.northing
+                     + (options.rows - 1) * options.y_resolution + margin;
+        RecordWriter w(output);
+        w.text("SYNTHETIC.DEM", 40);
+        w.text("Synthetic DEM for benchmarks", 40);
+        w.blank(29);
+        // Longitude and latitude of the south-east corner.
+        w.integer(-122, 4);
+        w.integer(30, 2);
+        w.text(" 0.0000", 7);
+        w.integer(45, 4);
+        w.integer(0, 2);
+        w.text(" 0.0000", 7);
+        w.text("1", 1);
+        w.blank(1);
+        w.text("", 3);
+        w.text("SYN", 4);
+        w.integer(1, 6);   // DEM level
+        w.integer(1, 6);   // Elevation pattern
+        w.integer(1, 6);   // Reference system: UTM
+        w.integer(options.zone, 6);
+        for (int i = 0; i < 15; ++i)
+            w.real(zero_d);
+        w.integer(2, 6);   // Horizontal unit: meters
+        w.integer(2, 6);   // Vertical unit: meters
+        w.integer(4, 6);   // Polygon sides
+        double corners[4][2] = {{west, south},
+                                {west, north},
+                                {east, north},
+                                {east, south}};
+        for (auto& corner : corners)
+        {
+            w.real(corner[0]);
+            w.real(corner[1]);
+        }
+        w.real(-500.0);
+        w.real(32000.0);
+        w.real(zero_d);    // Rotation angle
+        w.integer(zero, 6);
+        w.real32(options.x_resolution);
+        w.real32(options.y_resolution);
+        w.real32(1.0);
+        w.integer(1, 6);
+        w.integer(options.columns, 6);
+        w.blank(12);      // Contour intervals
+        w.integer(2000, 4);
+        w.integer(2001, 4);
+        w.blank(1);
+        w.integer(options.record_c ? 1 : 0, 1);
+        w.integer(zero, 2);
+        w.integer(2, 2);  // Vertical datum
+        w.integer(4, 2);  // Horizontal datum
+        w.integer(1, 4);
+        w.integer(zero, 4);
+        w.integer(zero, 8);
+        w.blank(7);
+        w.end_block();
+    }
+
+    void write_record_b(std::string& output,
+                        const SyntheticDemOptions& options,
+                        int column, Random& random)
+    {
+        std::optional<double> zero_d;
+        if (!options.blank_fields)
+            zero_d = 0.0;
+
+        auto shift = column % (options.stagger + 1);
+        auto rows = options.rows - shift;
+        RecordWriter w(output);
+        w.integer(1, 6);
+        w.integer(column + 1, 6);
+        w.integer(rows, 6);
+        w.integer(1, 6);
+        w.real(options.easting + column * options.x_resolution);
+        w.real(options.northing + shift * options.y_resolution);
+        w.real(0.0);
+        w.real(zero_d);
+        w.real(zero_d);
+
+        // A random walk gives values of varying length, like real
+        // terrain.
+        int elevation = random.next(0, 3000);
+        for (int i = 0; i < rows; ++i)
+        {
+            if (w.position() + 6 > BLOCK_SIZE)
+                w.end_block();
+            elevation = std::clamp(elevation + random.next(-25, 25),
+                                   -500, 32000);
+            if (random.next(0, 99) < options.void_percentage)
+                w.integer(UNKNOWN, 6);
+            else
+                w.integer(elevation, 6);
+        }
+        w.end_block();
+    }
+
+    std::filesystem::path make_temporary_path(const char* extension)
+    {
+        std::random_device device;
+        std::uniform_int_distribution<uint64_t> distribution;
+        char name[40];
+        snprintf(name, sizeof(name), "SyntheticDem-%016llx%s",
+                 static_cast<unsigned long long>(distribution(device)),
+                 extension);
+        return std::filesystem::temp_directory_path() / name;
+    }
+
+    void write_record_c(std::string& output)
+    {
+        RecordWriter w(output);
+        for (int value : {1, 1, 2, 3, 100, 1, 4, 5, 6, 200})
+            w.integer(value, 6);
+        w.end_block();
+    }
+}
+
+std::string make_synthetic_dem(const SyntheticDemOptions& options)
+{
+    Random random(options.seed);
+    std::string result;
+    write_record_a(result, options);
+    for (int i = 0; i < options.columns; ++i)
+        write_record_b(result, options, i, random);
+    if (options.record_c)
+        write_record_c(result);
+    return result;
+}
+
+std::string gzip(const std::string& data)
+{
+    z_stream zstream = {};
+    // 15 + 16 selects the gzip format.
+    if (deflateInit2(&zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                     15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw std::runtime_error("Can not initialize zlib.");
+    }
+    std::string result(deflateBound(&zstream, uLong(data.size())), '\0');
+    zstream.next_in = reinterpret_cast<Bytef*>(
+        const_cast<char*>(data.data()));
+    zstream.avail_in = uInt(data.size());
+    zstream.next_out = reinterpret_cast<Bytef*>(result.data());
+    zstream.avail_out = uInt(result.size());
+    auto status = deflate(&zstream, Z_FINISH);
+    result.resize(zstream.total_out);
+    deflateEnd(&zstream);
+    if (status != Z_STREAM_END)
+        throw std::runtime_error("Can not compress the data.");
+    return result;
+}
+
+TemporaryFile::TemporaryFile(const std::string& contents)
+    : m_Path(make_temporary_path(".tmp").string())
+{
+
+    std::ofstream file(m_Path, std::ios::binary);
+    file.write(contents.data(), std::streamsize(contents.size()));
+    if (!file)
+        throw std::runtime_error("Can not write " + m_Path);
+}
+
+TemporaryFile::~TemporaryFile()
+{
+    std::error_code ec;
+    std::filesystem::remove(m_Path, ec);
+}
+
+const std::string& TemporaryFile::path() const
+{
+    return m_Path;
+}
+
+TemporaryDirectory::TemporaryDirectory()
+    : m_Path(make_temporary_path(""))
+{
+    std::filesystem::create_directory(m_Path);
+}
+
+TemporaryDirectory::~TemporaryDirectory()
+{
+    std::error_code ec;
+    std::filesystem::remove_all(m_Path, ec);
+}
+
+const std::filesystem::path& TemporaryDirectory::path() const
+{
+    return m_Path;
+}
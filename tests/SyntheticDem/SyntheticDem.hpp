@@ -0,0 +1,99 @@
+//****************************************************************************
+// Copyright © 2021 Jan Erik Breimo. All rights reserved.
+// Created by Jan Erik Breimo on 2021-03-27.
+//
+// This file is distributed under the BSD License.
+// License text is included with the source distribution.
+//****************************************************************************
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+struct SyntheticDemOptions
+{
+    /// The number of profiles.
+    int columns = 1201;
+    /// The number of elevations in each profile.
+    int rows = 1201;
+    bool record_c = true;
+    /// Leave the optional fields in records A and B blank rather than
+    /// writing zeros in them.
+    bool blank_fields = false;
+    /// The percentage of elevations that are unknown (-32767).
+    int void_percentage = 1;
+    uint32_t seed = 1;
+    /// The UTM coordinates of the first elevation in the first profile.
+    double easting = 500000;
+    double northing = 5000000;
+    int zone = 10;
+    /// The distance between the profiles.
+    double x_resolution = 30;
+    /// The distance between the elevations in each profile.
+    double y_resolution = 30;
+    /// Profile i starts i % (stagger + 1) rows further north than the
+    /// first profile and is as many elevations shorter, like the
+    /// profiles in 7.5-minute quadrangles with UTM coordinates. Every
+    /// profile has 1 as its row number.
+    int stagger = 0;
+    /// The distance between the outermost elevations and the
+    /// quadrangle corners in record A.
+    double corner_margin = 0;
+};
+
+/**
+ * @brief Returns the contents of a DEM file with random terrain.
+ *
+ * The same options always produce the same file, on every platform.
+ */
+std::string make_synthetic_dem(const SyntheticDemOptions& options);
+
+/**
+ * @brief Returns @a data compressed in the gzip format.
+ */
+std::string gzip(const std::string& data);
+
+/**
+ * @brief A file with a unique name in the temporary directory that is
+ *  removed when the object is destroyed.
+ */
+class TemporaryFile
+{
+public:
+    /**
+     * @brief Creates the file and writes @a contents to it.
+     */
+    explicit TemporaryFile(const std::string& contents = {});
+
+    TemporaryFile(const TemporaryFile&) = delete;
+
+    ~TemporaryFile();
+
+    TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+    [[nodiscard]]
+    const std::string& path() const;
+private:
+    std::string m_Path;
+};
+
+/**
+ * @brief A directory with a unique name in the temporary directory that
+ *  is removed with its contents when the object is destroyed.
+ */
+class TemporaryDirectory
+{
+public:
+    TemporaryDirectory();
+
+    TemporaryDirectory(const TemporaryDirectory&) = delete;
+
+    ~TemporaryDirectory();
+
+    TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+    [[nodiscard]]
+    const std::filesystem::path& path() const;
+private:
+    std::filesystem::path m_Path;
+};